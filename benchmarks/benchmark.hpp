@@ -0,0 +1,108 @@
+/// \file
+/// \brief Minimal helpers shared by all benchmarks
+///
+/// Results are printed as one JSON object per line, e.g.
+///
+///     {"name":"io_dsv/csv_write","size":1024,"threads":1,"time_ns":...}
+///
+/// so they can be collected with standard tools and compared between
+/// releases.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// prevent the compiler from optimizing away the computation
+template<typename T>
+inline void
+do_not_optimize(const T& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Return the average time per iteration in nanoseconds.
+template<typename Function>
+inline double
+measure(std::size_t num_iterations, Function&& func)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < num_iterations; ++i) { func(); }
+  auto stop = std::chrono::steady_clock::now();
+  std::chrono::duration<double, std::nano> duration = stop - start;
+  return duration.count() / num_iterations;
+}
+
+// Return the average wall time per iteration in nanoseconds.
+//
+// Each thread calls `func(thread_index)` for every iteration. All threads
+// run concurrently and an iteration processes the combined work of all
+// threads.
+template<typename Function>
+inline double
+measure_threads(
+  std::size_t num_threads, std::size_t num_iterations, Function&& func)
+{
+  if (num_threads <= 1) {
+    return measure(num_iterations, [&]() { func(0u); });
+  }
+  return measure(num_iterations, [&]() {
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&func, t]() { func(t); });
+    }
+    for (auto& thread : threads) { thread.join(); }
+  });
+}
+
+// Powers of two up to and including the available hardware concurrency.
+inline std::vector<std::size_t>
+thread_counts()
+{
+  std::size_t available =
+    std::max<std::size_t>(std::thread::hardware_concurrency(), 1u);
+  std::vector<std::size_t> counts;
+  for (std::size_t n = 1; n < available; n *= 2) { counts.push_back(n); }
+  counts.push_back(available);
+  return counts;
+}
+
+// Size of a file in bytes or zero if it can not be read.
+inline std::size_t
+file_size(const std::string& path)
+{
+  std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+  return file.is_open() ? static_cast<std::size_t>(file.tellg()) : 0u;
+}
+
+// Print a single result as a JSON object on its own line.
+//
+// `time` is the average time per iteration in nanoseconds. Each iteration
+// processes `num_records` records, e.g. elements or entries, with a total of
+// `num_bytes` bytes. The throughput is omitted if the amount is zero.
+inline void
+report(
+  const std::string& name, std::size_t size, std::size_t num_threads,
+  double time, double num_records, double num_bytes = 0)
+{
+  double seconds = time * 1e-9;
+  std::cout << "{\"name\":\"" << name << "\"";
+  std::cout << ",\"size\":" << size;
+  std::cout << ",\"threads\":" << num_threads;
+  std::cout << ",\"time_ns\":" << time;
+  if (0 < num_records) {
+    std::cout << ",\"ns_per_record\":" << (time / num_records);
+    std::cout << ",\"records_per_s\":" << (num_records / seconds);
+  }
+  if (0 < num_bytes) {
+    std::cout << ",\"bytes_per_s\":" << (num_bytes / seconds);
+  }
+  std::cout << "}\n";
+}
@@ -0,0 +1,86 @@
+/// \file
+/// \brief Measure the overhead of calling commands via the dispatcher
+
+#include <cstdlib>
+#include <future>
+#include <string>
+#include <vector>
+
+#include <dfe/dfe_dispatcher.hpp>
+
+#include "benchmark.hpp"
+
+int
+compute(int x, double y, bool z)
+{
+  return z ? static_cast<int>(x + y) : x;
+}
+
+inline void
+benchmark(std::size_t num_commands)
+{
+  static constexpr std::size_t kNumIterations = 1u << 16;
+
+  // additional commands only change the cost of the name lookup
+  dfe::Dispatcher dispatcher;
+  for (std::size_t i = 1; i < num_commands; ++i) {
+    dispatcher.add("command" + std::to_string(i), compute);
+  }
+  dispatcher.add("compute", compute);
+  auto handle = dispatcher.find("compute");
+  std::vector<std::string> args = {"12", "0.25", "true"};
+
+  auto call = measure(kNumIterations, [&]() {
+    do_not_optimize(dispatcher.call("compute", 12, 0.25, true).as<int>());
+  });
+  auto call_handle = measure(kNumIterations, [&]() {
+    do_not_optimize(handle(12, 0.25, true).as<int>());
+  });
+  auto call_parsed = measure(kNumIterations, [&]() {
+    do_not_optimize(dispatcher.call_parsed("compute", args).as<int>());
+  });
+  auto call_parsed_range = measure(kNumIterations, [&]() {
+    do_not_optimize(handle.call_parsed(args.begin(), args.end()).as<int>());
+  });
+
+  report("dispatcher/call", num_commands, 1, call, 1);
+  report("dispatcher/call_handle", num_commands, 1, call_handle, 1);
+  report("dispatcher/call_parsed", num_commands, 1, call_parsed, 1);
+  report(
+    "dispatcher/call_parsed_range", num_commands, 1, call_parsed_range, 1);
+}
+
+inline void
+benchmark_async(std::size_t num_threads)
+{
+  static constexpr std::size_t kNumIterations = 16;
+  static constexpr std::size_t kNumCalls = 1u << 12;
+
+  dfe::Dispatcher dispatcher;
+  dispatcher.add("compute", compute);
+  dfe::AsyncDispatcher async(dispatcher);
+
+  // each thread submits its commands and waits for all results
+  auto submit = measure_threads(num_threads, kNumIterations, [&](std::size_t) {
+    std::vector<std::future<dfe::Variable>> results;
+    results.reserve(kNumCalls);
+    for (std::size_t i = 0; i < kNumCalls; ++i) {
+      results.push_back(async.submit("compute", 12, 0.25, true));
+    }
+    for (auto& result : results) { do_not_optimize(result.get().as<int>()); }
+  });
+
+  report(
+    "dispatcher/async_submit", kNumCalls, num_threads, submit,
+    num_threads * kNumCalls);
+}
+
+int
+main(int, char**)
+{
+  for (std::size_t num_commands : {1, 16, 256}) { benchmark(num_commands); }
+  for (std::size_t num_threads : thread_counts()) {
+    benchmark_async(num_threads);
+  }
+  return EXIT_SUCCESS;
+}
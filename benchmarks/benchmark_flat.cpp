@@ -0,0 +1,121 @@
+/// \file
+/// \brief Compare flat container construction and lookup to std containers
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <dfe/dfe_flat.hpp>
+
+#include "benchmark.hpp"
+
+// Keys in shuffled order with every other value missing from the container.
+inline std::vector<int32_t>
+make_keys(std::size_t n)
+{
+  std::vector<int32_t> keys(n);
+  uint64_t seed = 1;
+  for (std::size_t i = 0; i < n; ++i) { keys[i] = 2 * i; }
+  for (std::size_t i = n; 1 < i; --i) {
+    seed = 6364136223846793005u * seed + 1442695040888963407u;
+    std::swap(keys[i - 1], keys[(seed >> 33) % i]);
+  }
+  return keys;
+}
+
+// Measure the lookup of all inserted keys and as many missing keys.
+template<typename Contains>
+inline double
+measure_lookup(std::size_t size, Contains&& contains)
+{
+  std::size_t num_iterations = std::max<std::size_t>(1u, (1u << 20) / size);
+  return measure(num_iterations, [&]() {
+    std::size_t count = 0;
+    for (int32_t key = 0; key < static_cast<int32_t>(2 * size); ++key) {
+      count += contains(key) ? 1 : 0;
+    }
+    do_not_optimize(count);
+  });
+}
+
+template<typename Container, typename Elements>
+inline double
+measure_build(std::size_t size, const Elements& elements)
+{
+  std::size_t num_iterations = std::max<std::size_t>(1u, (1u << 18) / size);
+  return measure(num_iterations, [&]() {
+    Container c(elements.begin(), elements.end());
+    do_not_optimize(c.size());
+  });
+}
+
+inline void
+benchmark(std::size_t size)
+{
+  auto keys = make_keys(size);
+  std::vector<std::pair<int32_t, int32_t>> pairs;
+  for (auto key : keys) { pairs.emplace_back(key, -key); }
+
+  dfe::FlatSet<int32_t> flat_set(keys.begin(), keys.end());
+  std::set<int32_t> std_set(keys.begin(), keys.end());
+  dfe::FlatMap<int32_t, int32_t> flat_map(pairs.begin(), pairs.end());
+  dfe::FlatHashMap<int32_t, int32_t> flat_hash_map(pairs.begin(), pairs.end());
+  std::map<int32_t, int32_t> std_map(pairs.begin(), pairs.end());
+  std::unordered_map<int32_t, int32_t> std_unordered_map(
+    pairs.begin(), pairs.end());
+
+  double n = 2 * size;
+  report(
+    "flat/flat_set/lookup", size, 1,
+    measure_lookup(size, [&](int32_t k) { return flat_set.contains(k); }), n);
+  report(
+    "flat/std_set/lookup", size, 1,
+    measure_lookup(size, [&](int32_t k) { return std_set.count(k) != 0; }),
+    n);
+  report(
+    "flat/flat_map/lookup", size, 1,
+    measure_lookup(size, [&](int32_t k) { return flat_map.contains(k); }), n);
+  report(
+    "flat/flat_hash_map/lookup", size, 1,
+    measure_lookup(
+      size, [&](int32_t k) { return flat_hash_map.contains(k); }),
+    n);
+  report(
+    "flat/std_map/lookup", size, 1,
+    measure_lookup(size, [&](int32_t k) { return std_map.count(k) != 0; }),
+    n);
+  report(
+    "flat/std_unordered_map/lookup", size, 1,
+    measure_lookup(
+      size, [&](int32_t k) { return std_unordered_map.count(k) != 0; }),
+    n);
+
+  report(
+    "flat/flat_set/build", size, 1,
+    measure_build<dfe::FlatSet<int32_t>>(size, keys), size);
+  report(
+    "flat/std_set/build", size, 1, measure_build<std::set<int32_t>>(size, keys),
+    size);
+  report(
+    "flat/flat_map/build", size, 1,
+    measure_build<dfe::FlatMap<int32_t, int32_t>>(size, pairs), size);
+  report(
+    "flat/flat_hash_map/build", size, 1,
+    measure_build<dfe::FlatHashMap<int32_t, int32_t>>(size, pairs), size);
+  report(
+    "flat/std_map/build", size, 1,
+    measure_build<std::map<int32_t, int32_t>>(size, pairs), size);
+}
+
+int
+main(int, char**)
+{
+  for (std::size_t size : {16, 256, 4096, 65536}) { benchmark(size); }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+/// \file
+/// \brief Measure the fill rate of the different histogram types
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <dfe/dfe_histogram.hpp>
+
+#include "benchmark.hpp"
+
+using Axis = dfe::OverflowAxis<double>;
+using StaticAxis = dfe::StaticOverflowAxis<double, 64>;
+using Dense = dfe::Histogram<double, Axis, Axis>;
+using Static = dfe::StaticHistogram<double, StaticAxis, StaticAxis>;
+using Sparse = dfe::SparseHistogram<double, Axis, Axis>;
+using Concurrent = dfe::ConcurrentHistogram<double, Axis, Axis>;
+using Atomic = dfe::AtomicHistogram<double, Axis, Axis>;
+
+// Deterministic pseudo-random values within and around the axis range.
+inline std::vector<double>
+make_values(std::size_t n, uint64_t seed)
+{
+  std::vector<double> values(n);
+  for (auto& x : values) {
+    seed = 6364136223846793005u * seed + 1442695040888963407u;
+    x = -0.1 + 1.2 * static_cast<double>(seed >> 11) / (1ull << 53);
+  }
+  return values;
+}
+
+template<typename Histogram>
+inline void
+benchmark_single(
+  const char* name, Histogram&& h, const std::vector<double>& xs,
+  const std::vector<double>& ys)
+{
+  static constexpr std::size_t kNumIterations = 16;
+
+  std::size_t n = xs.size();
+  auto fill = measure(kNumIterations, [&]() {
+    for (std::size_t i = 0; i < n; ++i) { h.fill(xs[i], ys[i]); }
+  });
+  auto fill_n =
+    measure(kNumIterations, [&]() { h.fill_n(n, xs.data(), ys.data()); });
+  do_not_optimize(h.value({1, 1}));
+
+  report(std::string("histogram/") + name + "/fill", n, 1, fill, n);
+  report(std::string("histogram/") + name + "/fill_n", n, 1, fill_n, n);
+}
+
+inline void
+benchmark_threads(
+  std::size_t num_threads, const std::vector<double>& xs,
+  const std::vector<double>& ys)
+{
+  static constexpr std::size_t kNumIterations = 16;
+
+  std::size_t n = xs.size();
+  Concurrent concurrent({0.0, 1.0, 64}, {0.0, 1.0, 64});
+  auto fill_concurrent =
+    measure_threads(num_threads, kNumIterations, [&](std::size_t) {
+      auto& local = concurrent.local();
+      for (std::size_t i = 0; i < n; ++i) { local.fill(xs[i], ys[i]); }
+    });
+  do_not_optimize(concurrent.merge().value({1, 1}));
+  Atomic atomic({0.0, 1.0, 64}, {0.0, 1.0, 64});
+  auto fill_atomic =
+    measure_threads(num_threads, kNumIterations, [&](std::size_t) {
+      for (std::size_t i = 0; i < n; ++i) { atomic.fill(xs[i], ys[i]); }
+    });
+  do_not_optimize(atomic.value({1, 1}));
+
+  double total = num_threads * n;
+  report(
+    "histogram/concurrent/fill", n, num_threads, fill_concurrent, total);
+  report("histogram/atomic/fill", n, num_threads, fill_atomic, total);
+}
+
+int
+main(int, char**)
+{
+  for (std::size_t n : {1u << 10, 1u << 14, 1u << 18}) {
+    auto xs = make_values(n, 1);
+    auto ys = make_values(n, 2);
+    benchmark_single("dense", Dense({0.0, 1.0, 64}, {0.0, 1.0, 64}), xs, ys);
+    benchmark_single("static", Static({0.0, 1.0}, {0.0, 1.0}), xs, ys);
+    benchmark_single("sparse", Sparse({0.0, 1.0, 64}, {0.0, 1.0, 64}), xs, ys);
+    for (std::size_t num_threads : thread_counts()) {
+      benchmark_threads(num_threads, xs, ys);
+    }
+  }
+  return EXIT_SUCCESS;
+}
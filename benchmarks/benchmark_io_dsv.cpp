@@ -0,0 +1,74 @@
+/// \file
+/// \brief Measure the throughput of the delimiter-separated values i/o
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <dfe/dfe_io_dsv.hpp>
+
+#include "benchmark.hpp"
+#include "record.hpp"
+
+inline std::string
+make_path(std::size_t idx)
+{
+  return "benchmark_io_dsv_" + std::to_string(idx) + ".csv";
+}
+
+inline void
+benchmark(std::size_t num_records, std::size_t num_threads)
+{
+  static constexpr std::size_t kNumIterations = 4;
+
+  std::vector<Record> records;
+  for (std::size_t i = 0; i < num_records; ++i) {
+    records.push_back(make_record(i));
+  }
+
+  // each thread writes and reads its own file
+  auto write = measure_threads(num_threads, kNumIterations, [&](std::size_t t) {
+    dfe::NamedTupleCsvWriter<Record> writer(make_path(t));
+    for (const auto& record : records) { writer.append(record); }
+  });
+  auto read = measure_threads(num_threads, kNumIterations, [&](std::size_t t) {
+    dfe::NamedTupleCsvReader<Record> reader(make_path(t));
+    Record record;
+    while (reader.read(record)) { do_not_optimize(record); }
+  });
+  // one file decoded by multiple threads
+  auto parallel_read = measure(kNumIterations, [&]() {
+    dfe::NamedTupleCsvParallelReader<Record> reader(
+      make_path(0), {}, true, num_threads, 1u << 20);
+    std::vector<Record> batch;
+    while (reader.read(batch)) { do_not_optimize(batch.front()); }
+  });
+
+  double bytes = file_size(make_path(0));
+  double total = num_threads * num_records;
+  report(
+    "io_dsv/csv_write", num_records, num_threads, write, total,
+    num_threads * bytes);
+  report(
+    "io_dsv/csv_read", num_records, num_threads, read, total,
+    num_threads * bytes);
+  report(
+    "io_dsv/csv_parallel_read", num_records, num_threads, parallel_read,
+    num_records, bytes);
+
+  for (std::size_t t = 0; t < num_threads; ++t) {
+    std::remove(make_path(t).c_str());
+  }
+}
+
+int
+main(int, char**)
+{
+  for (std::size_t num_threads : thread_counts()) {
+    for (std::size_t num_records : {1u << 10, 1u << 14, 1u << 18}) {
+      benchmark(num_records, num_threads);
+    }
+  }
+  return EXIT_SUCCESS;
+}
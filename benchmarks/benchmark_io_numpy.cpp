@@ -0,0 +1,113 @@
+/// \file
+/// \brief Measure the throughput of the NumPy i/o
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <dfe/dfe_io_numpy.hpp>
+
+#include "benchmark.hpp"
+#include "record.hpp"
+
+// Same members as the record but without padding or unused members.
+struct PackedRecord {
+  int64_t z = 0;
+  uint64_t a = 0;
+  double c = 0;
+  int32_t y = 0;
+  float b = 0;
+  int16_t x = 0;
+  bool d = false;
+  bool e = false;
+
+  DFE_NAMEDTUPLE(PackedRecord, z, a, c, y, b, x, d, e)
+};
+
+inline PackedRecord
+make_packed_record(std::size_t i)
+{
+  auto r = make_record(i);
+  PackedRecord p;
+  p.z = r.z;
+  p.a = r.a;
+  p.c = r.c;
+  p.y = r.y;
+  p.b = r.b;
+  p.x = r.x;
+  p.d = r.d;
+  p.e = r.THIS_IS_UNUSED;
+  return p;
+}
+
+inline std::string
+make_path(std::size_t idx, const char* extension)
+{
+  return "benchmark_io_numpy_" + std::to_string(idx) + extension;
+}
+
+template<typename NamedTuple>
+inline void
+benchmark(
+  const std::string& name, const std::vector<NamedTuple>& records,
+  std::size_t num_threads)
+{
+  static constexpr std::size_t kNumIterations = 8;
+
+  // each thread writes and reads its own file
+  auto write = measure_threads(num_threads, kNumIterations, [&](std::size_t t) {
+    dfe::NamedTupleNumpyWriter<NamedTuple> writer(make_path(t, ".npy"));
+    for (const auto& record : records) { writer.append(record); }
+  });
+  auto write_batch =
+    measure_threads(num_threads, kNumIterations, [&](std::size_t t) {
+      dfe::NamedTupleNumpyWriter<NamedTuple> writer(make_path(t, ".npy"));
+      writer.append(records.data(), records.size());
+    });
+  auto read = measure_threads(num_threads, kNumIterations, [&](std::size_t t) {
+    dfe::NamedTupleNumpyReader<NamedTuple> reader(make_path(t, ".npy"));
+    NamedTuple record;
+    while (reader.read(record)) { do_not_optimize(record); }
+  });
+  auto write_columns =
+    measure_threads(num_threads, kNumIterations, [&](std::size_t t) {
+      dfe::NamedTupleNumpyColumnWriter<NamedTuple> writer(
+        make_path(t, ".npz"));
+      for (const auto& record : records) { writer.append(record); }
+    });
+
+  std::size_t size = records.size();
+  double total = num_threads * size;
+  double bytes = num_threads * file_size(make_path(0, ".npy"));
+  double bytes_columns = num_threads * file_size(make_path(0, ".npz"));
+  report(name + "/write", size, num_threads, write, total, bytes);
+  report(name + "/write_batch", size, num_threads, write_batch, total, bytes);
+  report(name + "/read", size, num_threads, read, total, bytes);
+  report(
+    name + "/write_columns", size, num_threads, write_columns, total,
+    bytes_columns);
+
+  for (std::size_t t = 0; t < num_threads; ++t) {
+    std::remove(make_path(t, ".npy").c_str());
+    std::remove(make_path(t, ".npz").c_str());
+  }
+}
+
+int
+main(int, char**)
+{
+  for (std::size_t num_threads : thread_counts()) {
+    for (std::size_t num_records : {1u << 10, 1u << 14, 1u << 18}) {
+      std::vector<Record> records;
+      std::vector<PackedRecord> packed;
+      for (std::size_t i = 0; i < num_records; ++i) {
+        records.push_back(make_record(i));
+        packed.push_back(make_packed_record(i));
+      }
+      benchmark("io_numpy/record", records, num_threads);
+      benchmark("io_numpy/packed", packed, num_threads);
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,67 @@
+/// \file
+/// \brief Measure the throughput of the ROOT i/o
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <dfe/dfe_io_root.hpp>
+
+#include "benchmark.hpp"
+#include "record.hpp"
+
+static constexpr const char* kPath = "benchmark_io_root.root";
+
+inline void
+benchmark(std::size_t num_records, std::size_t num_threads)
+{
+  static constexpr std::size_t kNumIterations = 4;
+
+  std::vector<Record> records;
+  for (std::size_t i = 0; i < num_records; ++i) {
+    records.push_back(make_record(i));
+  }
+
+  auto write = measure(kNumIterations, [&]() {
+    dfe::NamedTupleRootWriter<Record> writer(kPath, "records");
+    writer.append(records.begin(), records.end());
+  });
+  // ROOT decompresses the branches using its own thread pool
+  dfe::NamedTupleRootReaderOptions options;
+  options.implicit_mt = (1 < num_threads);
+  auto read = measure(kNumIterations, [&]() {
+    dfe::NamedTupleRootReader<Record> reader(kPath, "records", options);
+    Record record;
+    while (reader.read(record)) { do_not_optimize(record); }
+  });
+  auto read_batch = measure(kNumIterations, [&]() {
+    dfe::NamedTupleRootReader<Record> reader(kPath, "records", options);
+    std::vector<Record> batch(1024);
+    while (0 < reader.read(batch.data(), batch.size())) {
+      do_not_optimize(batch.front());
+    }
+  });
+
+  double bytes = file_size(kPath);
+  report("io_root/write", num_records, 1, write, num_records, bytes);
+  report("io_root/read", num_records, num_threads, read, num_records, bytes);
+  report(
+    "io_root/read_batch", num_records, num_threads, read_batch, num_records,
+    bytes);
+
+  std::remove(kPath);
+}
+
+int
+main(int, char**)
+{
+  // implicit multi-threading uses the maximum number of threads
+  std::vector<std::size_t> counts = {1};
+  if (1 < thread_counts().back()) { counts.push_back(thread_counts().back()); }
+  for (std::size_t num_threads : counts) {
+    for (std::size_t num_records : {1u << 10, 1u << 14, 1u << 18}) {
+      benchmark(num_records, num_threads);
+    }
+  }
+  return EXIT_SUCCESS;
+}
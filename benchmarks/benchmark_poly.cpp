@@ -0,0 +1,76 @@
+/// \file
+/// \brief Compare scalar and batch evaluation of polynomials
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <dfe/dfe_poly.hpp>
+
+#include "benchmark.hpp"
+
+template<typename T>
+inline void
+benchmark(std::size_t order)
+{
+  static constexpr std::size_t kNumIterations = 64;
+  static constexpr std::size_t kNumValues = 1 << 16;
+
+  std::vector<T> coeffs(order + 1);
+  for (std::size_t i = 0; i < coeffs.size(); ++i) {
+    coeffs[i] = T(1) / (1 + i);
+  }
+  std::vector<T> xs(kNumValues);
+  for (std::size_t i = 0; i < xs.size(); ++i) {
+    xs[i] = T(-1) + (T(2) / kNumValues) * i;
+  }
+  std::vector<T> val(kNumValues);
+  std::vector<T> der(kNumValues);
+
+  auto scalar = measure(kNumIterations, [&]() {
+    for (std::size_t i = 0; i < kNumValues; ++i) {
+      val[i] = dfe::polynomial_val(xs[i], coeffs);
+    }
+    do_not_optimize(val.front());
+  });
+  auto estrin = measure(kNumIterations, [&]() {
+    for (std::size_t i = 0; i < kNumValues; ++i) {
+      val[i] = dfe::polynomial_val_estrin(xs[i], coeffs);
+    }
+    do_not_optimize(val.front());
+  });
+  auto batch = measure(kNumIterations, [&]() {
+    dfe::polynomial_val(xs.data(), val.data(), kNumValues, coeffs);
+    do_not_optimize(val.front());
+  });
+  auto scalar_valder = measure(kNumIterations, [&]() {
+    for (std::size_t i = 0; i < kNumValues; ++i) {
+      auto vd = dfe::polynomial_valder(xs[i], coeffs);
+      val[i] = vd.first;
+      der[i] = vd.second;
+    }
+    do_not_optimize(val.front());
+  });
+  auto batch_valder = measure(kNumIterations, [&]() {
+    dfe::polynomial_valder(
+      xs.data(), val.data(), der.data(), kNumValues, coeffs);
+    do_not_optimize(val.front());
+  });
+
+  std::string prefix = (sizeof(T) == 4) ? "poly/float/" : "poly/double/";
+  report(prefix + "scalar", order, 1, scalar, kNumValues);
+  report(prefix + "estrin", order, 1, estrin, kNumValues);
+  report(prefix + "batch", order, 1, batch, kNumValues);
+  report(prefix + "scalar_valder", order, 1, scalar_valder, kNumValues);
+  report(prefix + "batch_valder", order, 1, batch_valder, kNumValues);
+}
+
+int
+main(int, char**)
+{
+  for (std::size_t order : {1, 3, 7, 15}) {
+    benchmark<float>(order);
+    benchmark<double>(order);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+/// \file
+/// \brief Compare dfe::SmallVector element access and growth to std::vector
+///
+/// The previous layout, that selects the storage on each access depending on
+/// the number of elements, is included as a reference.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dfe/dfe_flat.hpp>
+#include <dfe/dfe_smallvector.hpp>
+
+#include "benchmark.hpp"
+
+// Minimal small vector that chooses the storage on every access.
+template<typename T, std::size_t N>
+class BranchingSmallVector {
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  BranchingSmallVector() = default;
+  BranchingSmallVector(const BranchingSmallVector&) = delete;
+  BranchingSmallVector& operator=(const BranchingSmallVector&) = delete;
+  ~BranchingSmallVector() { clear(); }
+
+  T& operator[](size_type idx) { return begin()[idx]; }
+  iterator begin()
+  {
+    return (m_size <= N) ? reinterpret_cast<T*>(m_inplace) : m_onheap.data;
+  }
+  iterator end() { return begin() + m_size; }
+  const_iterator begin() const
+  {
+    return (m_size <= N) ? reinterpret_cast<const T*>(m_inplace)
+                         : m_onheap.data;
+  }
+  const_iterator end() const { return begin() + m_size; }
+  bool empty() const { return m_size == 0; }
+  size_type size() const { return m_size; }
+
+  void clear()
+  {
+    for (T& x : *this) { x.~T(); }
+    if (N < m_size) {
+      std::allocator<T>().deallocate(m_onheap.data, m_capacity);
+    }
+    m_size = 0;
+  }
+  template<typename... Args>
+  iterator emplace(const_iterator pos, Args&&... args)
+  {
+    size_type idx = pos - begin();
+    T element(std::forward<Args>(args)...);
+    emplace_back(std::move(element));
+    std::rotate(begin() + idx, end() - 1, end());
+    return begin() + idx;
+  }
+  template<typename... Args>
+  T& emplace_back(Args&&... args)
+  {
+    if (m_size == N) {
+      // move from in-place storage to the heap
+      T* storage = std::allocator<T>().allocate(2 * N);
+      relocate(storage);
+      m_onheap.data = storage;
+      m_capacity = 2 * N;
+    } else if ((N < m_size) and (m_size == m_capacity)) {
+      T* storage = std::allocator<T>().allocate(2 * m_capacity);
+      relocate(storage);
+      std::allocator<T>().deallocate(m_onheap.data, m_capacity);
+      m_onheap.data = storage;
+      m_capacity *= 2;
+    }
+    // the storage selection depends on the size; increase before access
+    m_size += 1;
+    T* e = end() - 1;
+    new (e) T(std::forward<Args>(args)...);
+    return *e;
+  }
+
+private:
+  void relocate(T* storage)
+  {
+    for (T& x : *this) {
+      new (storage++) T(std::move(x));
+      x.~T();
+    }
+  }
+
+  struct AllocatedStorage {
+    T* data;
+  };
+
+  size_type m_size = 0;
+  size_type m_capacity = N;
+  union {
+    AllocatedStorage m_onheap;
+    alignas(T) char m_inplace[N * sizeof(T)];
+  };
+};
+
+template<typename Container>
+inline void
+benchmark(const std::string& name, std::size_t size)
+{
+  static constexpr std::size_t kNumIterations = 4096;
+  static constexpr std::size_t kNumContainers = 256;
+
+  // many small containers to emulate e.g. per-hit storage
+  std::vector<Container> containers(kNumContainers);
+
+  auto fill = measure(kNumIterations, [&]() {
+    for (auto& c : containers) {
+      c.clear();
+      for (std::size_t i = 0; i < size; ++i) {
+        c.emplace_back(static_cast<int32_t>(i));
+      }
+    }
+    do_not_optimize(containers.front().size());
+  });
+  auto access = measure(kNumIterations, [&]() {
+    int32_t sum = 0;
+    for (auto& c : containers) {
+      for (std::size_t i = 0; i < size; ++i) { sum += c[i]; }
+    }
+    do_not_optimize(sum);
+  });
+  auto iterate = measure(kNumIterations, [&]() {
+    int32_t sum = 0;
+    for (const auto& c : containers) {
+      for (auto x : c) { sum += x; }
+    }
+    do_not_optimize(sum);
+  });
+  // lookups in a flat set that uses the container as storage
+  dfe::FlatSet<int32_t, std::less<int32_t>, Container> set;
+  for (std::size_t i = 0; i < size; ++i) {
+    set.insert_or_assign(static_cast<int32_t>(3 * i));
+  }
+  auto lookup = measure(kNumIterations, [&]() {
+    std::size_t count = 0;
+    for (int32_t x = 0; x < static_cast<int32_t>(3 * size); ++x) {
+      count += set.contains(x) ? 1 : 0;
+    }
+    do_not_optimize(count);
+  });
+
+  double n = kNumContainers * size;
+  report("smallvector/" + name + "/fill", size, 1, fill, n);
+  report("smallvector/" + name + "/access", size, 1, access, n);
+  report("smallvector/" + name + "/iterate", size, 1, iterate, n);
+  report("smallvector/" + name + "/lookup", size, 1, lookup, 3 * size);
+}
+
+int
+main(int, char**)
+{
+  for (std::size_t size : {4, 8, 16, 64}) {
+    benchmark<std::vector<int32_t>>("std::vector", size);
+    benchmark<BranchingSmallVector<int32_t, 8>>("branching", size);
+    benchmark<dfe::SmallVector<int32_t, 8>>("dfe::SmallVector", size);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,346 @@
+// Copyright 2015,2018-2020 Moritz Kiehn
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/// \file
+/// \brief   Internal helpers shared by multiple dfe libraries
+/// \author  Moritz Kiehn <msmk@cern.ch>
+///
+/// Nothing in here is part of the public interface.
+
+#pragma once
+
+#include <cctype>
+#include <cerrno>
+#include <cfloat>
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <locale>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+// memory-mapped input is only supported on POSIX systems
+#if defined(__unix__) or defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DFE_COMMON_USE_MMAP
+#endif
+
+namespace dfe {
+namespace common_impl {
+
+/// Read-only memory mapping of a complete file.
+///
+/// The mapping is only available on POSIX systems. On other systems or if the
+/// file can not be mapped, e.g. because it is empty or not a regular file,
+/// the mapping is not opened and users must fall back to regular i/o.
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) { *this = std::move(other); }
+  ~MappedFile() { close(); }
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile& operator=(MappedFile&& other);
+
+  /// Try to map the file at the given path.
+  ///
+  /// \returns true   if the file was successfully mapped
+  /// \returns false  if the file could not be mapped
+  bool open(const std::string& path);
+  /// Release the mapping.
+  void close();
+
+  bool is_open() const { return (m_data != nullptr); }
+  const char* data() const { return m_data; }
+  std::size_t size() const { return m_size; }
+
+private:
+  const char* m_data = nullptr;
+  std::size_t m_size = 0;
+};
+
+// locale-independent number conversion
+//
+// the input is the character range [first, last) and must not contain any
+// additional characters, e.g. leading or trailing whitespace. all functions
+// return false if the input has an unsupported format or is out of range and
+// leave the output unchanged in that case.
+
+// Convert a plain decimal integer w/ optional minus sign.
+template<typename T>
+inline bool
+parse_integer(const char* first, const char* last, T& value)
+{
+  const char* pos = first;
+
+  bool is_negative = false;
+  if ((pos != last) and (*pos == '-')) {
+    if (std::is_unsigned<T>::value) { return false; }
+    is_negative = true;
+    ++pos;
+  }
+  if (pos == last) { return false; }
+  // largest absolute value that can be represented
+  std::uintmax_t limit = std::numeric_limits<T>::max();
+  if (is_negative) { limit += 1; }
+  std::uintmax_t abs = 0;
+  for (; pos != last; ++pos) {
+    unsigned digit = static_cast<unsigned char>(*pos - '0');
+    if (9 < digit) { return false; }
+    if (((limit - digit) / 10) < abs) { return false; }
+    abs = 10 * abs + digit;
+  }
+  // negation in unsigned arithmetic is well-defined and wraps around
+  value = static_cast<T>(is_negative ? (0 - abs) : abs);
+  return true;
+}
+
+// Decompose a plain decimal number into sign, mantissa, and exponent.
+//
+// Also returns false if the significant digits do not fit into the mantissa.
+inline bool
+parse_decimal(
+  const char* first, const char* last, bool& is_negative,
+  std::uint64_t& mantissa, int& exponent)
+{
+  const char* pos = first;
+
+  is_negative = ((pos != last) and (*pos == '-'));
+  if (is_negative) { ++pos; }
+  mantissa = 0;
+  exponent = 0;
+  // integer and fractional digits; at most 19 digits always fit into 64bit
+  int num_digits = 0;
+  const char* first_digit = pos;
+  for (; (pos != last) and ('0' <= *pos) and (*pos <= '9'); ++pos) {
+    mantissa = 10 * mantissa + (*pos - '0');
+    num_digits += (0 < mantissa) ? 1 : 0;
+  }
+  bool has_digits = (pos != first_digit);
+  if ((pos != last) and (*pos == '.')) {
+    ++pos;
+    first_digit = pos;
+    for (; (pos != last) and ('0' <= *pos) and (*pos <= '9'); ++pos) {
+      mantissa = 10 * mantissa + (*pos - '0');
+      num_digits += (0 < mantissa) ? 1 : 0;
+      exponent -= 1;
+    }
+    has_digits = has_digits or (pos != first_digit);
+  }
+  if ((not has_digits) or (19 < num_digits)) { return false; }
+  // optional exponent
+  if ((pos != last) and ((*pos == 'e') or (*pos == 'E'))) {
+    ++pos;
+    bool is_exp_negative = ((pos != last) and (*pos == '-'));
+    if ((pos != last) and ((*pos == '-') or (*pos == '+'))) { ++pos; }
+    if (pos == last) { return false; }
+    int exp = 0;
+    for (; (pos != last) and ('0' <= *pos) and (*pos <= '9'); ++pos) {
+      // very large exponents are not supported by the fast path anyways
+      if (1000 < exp) { return false; }
+      exp = 10 * exp + (*pos - '0');
+    }
+    exponent += is_exp_negative ? -exp : exp;
+  }
+  return (pos == last);
+}
+
+// Convert a plain decimal number to double precision, if it can be exact.
+//
+// This implements the fast path described in W. D. Clinger, "How to read
+// floating point numbers accurately", PLDI 1990. If the mantissa and the
+// power of ten are both exactly representable, a single multiplication or
+// division yields the correctly rounded result.
+inline bool
+parse_double_exact(const char* first, const char* last, double& value)
+{
+#if defined(FLT_EVAL_METHOD) and (FLT_EVAL_METHOD == 0)
+  static constexpr double kPowers[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  bool is_negative;
+  std::uint64_t mantissa;
+  int exponent;
+  if (not parse_decimal(first, last, is_negative, mantissa, exponent)) {
+    return false;
+  }
+  if ((UINT64_C(1) << 53) < mantissa) { return false; }
+  if ((exponent < -22) or (22 < exponent)) { return false; }
+  double result = static_cast<double>(mantissa);
+  if (exponent < 0) {
+    result /= kPowers[-exponent];
+  } else {
+    result *= kPowers[exponent];
+  }
+  value = is_negative ? -result : result;
+  return true;
+#else
+  // excess precision for intermediate results breaks the exactness
+  (void)first;
+  (void)last;
+  (void)value;
+  return false;
+#endif
+}
+
+// Convert a plain decimal number to single precision, if it can be exact.
+inline bool
+parse_float_exact(const char* first, const char* last, float& value)
+{
+  double exact;
+  if (not parse_double_exact(first, last, exact)) { return false; }
+  // rounding the correctly rounded double to float gives the correctly
+  // rounded float, unless the double lies exactly in the middle of two floats.
+  // the midpoint is exactly representable as a double and would have been
+  // chosen as the closest double only if it is the closest value overall.
+  float result = static_cast<float>(exact);
+  if (static_cast<double>(result) != exact) {
+    float other = std::nextafter(
+      result, (exact < result) ? -std::numeric_limits<float>::infinity()
+                               : std::numeric_limits<float>::infinity());
+    double mid = 0.5 * static_cast<double>(result) + 0.5 * other;
+    if (mid == exact) { return false; }
+  }
+  value = result;
+  return true;
+}
+
+// Convert a floating point number w/o depending on the global locale.
+//
+// Plain decimal numbers that can be converted exactly use the fast path.
+// Everything else is converted by the C library after replacing the decimal
+// point with the one of the global locale. Inputs w/ less than 128
+// characters are copied onto the stack and do not allocate.
+inline bool
+parse_double(const char* first, const char* last, double& value)
+{
+  if (parse_double_exact(first, last, value)) { return true; }
+  // leading whitespace is not allowed, consistent w/ from_chars
+  if ((first == last) or std::isspace(static_cast<unsigned char>(*first))) {
+    return false;
+  }
+  char decimal_point = *std::localeconv()->decimal_point;
+  auto size = static_cast<std::size_t>(last - first);
+  char stack[128];
+  std::unique_ptr<char[]> heap;
+  char* buffer = stack;
+  if (sizeof(stack) <= size) {
+    heap.reset(new char[size + 1]);
+    buffer = heap.get();
+  }
+  for (std::size_t i = 0; i < size; ++i) {
+    char c = first[i];
+    // reject hexadecimal numbers and the decimal point of the global locale
+    if ((c == 'x') or (c == 'X') or ((c != '.') and (c == decimal_point))) {
+      return false;
+    }
+    buffer[i] = (c == '.') ? decimal_point : c;
+  }
+  buffer[size] = '\0';
+  char* end = nullptr;
+  errno = 0;
+  double result = std::strtod(buffer, &end);
+  if (end != (buffer + size)) { return false; }
+  // only overflow is an error; underflow to subnormal numbers or zero is not
+  if ((errno == ERANGE) and std::isinf(result)) { return false; }
+  value = result;
+  return true;
+}
+
+// Convert using the stream operator in the classic locale.
+//
+// Supports arbitrary types. Errors are handled as by the stream operator.
+template<typename T>
+inline void
+parse_stream(const char* first, const char* last, T& value)
+{
+  // re-use the stream to avoid repeated construction and locale lookup
+  static thread_local std::istringstream is = []() {
+    std::istringstream s;
+    s.imbue(std::locale::classic());
+    return s;
+  }();
+  is.clear();
+  is.str(std::string(first, last));
+  is >> value;
+}
+
+// implementation mapped file
+
+inline MappedFile&
+MappedFile::operator=(MappedFile&& other)
+{
+  if (this != &other) {
+    close();
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+  }
+  return *this;
+}
+
+inline bool
+MappedFile::open(const std::string& path)
+{
+  close();
+#if defined(DFE_COMMON_USE_MMAP)
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) { return false; }
+  struct stat info;
+  // only regular, non-empty files can be mapped
+  if ((::fstat(fd, &info) == 0) and S_ISREG(info.st_mode) and
+      (0 < info.st_size)) {
+    auto size = static_cast<std::size_t>(info.st_size);
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      // pure hint for the os; failure is not an error
+      (void)::madvise(addr, size, MADV_SEQUENTIAL);
+      m_data = static_cast<const char*>(addr);
+      m_size = size;
+    }
+  }
+  // the mapping stays valid after closing the file descriptor
+  ::close(fd);
+#else
+  (void)path;
+#endif
+  return is_open();
+}
+
+inline void
+MappedFile::close()
+{
+#if defined(DFE_COMMON_USE_MMAP)
+  if (m_data) { ::munmap(const_cast<char*>(m_data), m_size); }
+#endif
+  m_data = nullptr;
+  m_size = 0;
+}
+
+} // namespace common_impl
+} // namespace dfe
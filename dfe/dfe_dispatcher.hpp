@@ -25,35 +25,59 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <cstring>
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+// locale-independent, non-allocating number parsing requires C++17
+#if (201703L <= __cplusplus) and defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#if defined(__cpp_lib_to_chars) and (201611L <= __cpp_lib_to_chars)
+#define DFE_DISPATCHER_USE_FROM_CHARS
+#endif
+#endif
+#endif
+
+#include "dfe_common_impl.hpp"
+
 namespace dfe {
 
 /// Variable-type value object a.k.a. a poor mans std::variant.
+///
+/// Numeric values are stored directly. Strings are stored in a shared,
+/// reference-counted, immutable buffer such that copies do not allocate.
 class Variable final {
 public:
   /// Supported value types.
   enum class Type { Empty, Boolean, Integer, Float, String };
 
   Variable()
-    : m_type(Type::Empty)
+    : m_value{0}
+    , m_type(Type::Empty)
   {
   }
-  Variable(Variable&& v) { *this = std::move(v); }
-  Variable(const Variable& v) { *this = v; }
+  Variable(Variable&& v);
+  Variable(const Variable& v);
   explicit Variable(std::string&& s)
-    : m_string(std::move(s))
-    , m_type(Type::String)
+    : m_type(Type::String)
   {
+    m_value.string = new SharedString(std::move(s));
   }
   explicit Variable(const std::string& s)
     : Variable(std::string(s))
@@ -66,31 +90,46 @@ public:
   // suppport all possible integer types
   template<typename I, typename = std::enable_if_t<std::is_integral<I>::value>>
   explicit Variable(I integer)
-    : m_integer(static_cast<int64_t>(integer))
-    , m_type(Type::Integer)
+    : m_type(Type::Integer)
   {
+    m_value.integer = static_cast<int64_t>(integer);
   }
   explicit Variable(double d)
-    : m_float(d)
-    , m_type(Type::Float)
+    : m_type(Type::Float)
   {
+    m_value.real = d;
   }
   explicit Variable(float f)
     : Variable(static_cast<double>(f))
   {
   }
   explicit Variable(bool b)
-    : m_boolean(b)
-    , m_type(Type::Boolean)
+    : m_type(Type::Boolean)
   {
+    m_value.boolean = b;
   }
-  ~Variable() = default;
+  ~Variable() { release(); }
 
   Variable& operator=(Variable&& v);
   Variable& operator=(const Variable& v);
 
   /// Parse a string into a value of the requested type.
+  ///
+  /// \exception std::invalid_argument if the string has an invalid format
   static Variable parse_as(const std::string& str, Type type);
+  /// Parse a string into a value of the requested type without throwing.
+  ///
+  /// \returns false if the string has an invalid format or is out of range
+  ///
+  /// Numbers are parsed independent of the locale. Integers never allocate
+  /// and floating point numbers only if they have at least 128 characters.
+  /// String values are always stored in a new allocation.
+  static bool parse_as(
+    const char* str, std::size_t size, Type type, Variable& value);
+  /// Parse a string into a value of the requested type without throwing.
+  ///
+  /// String values are moved into place w/o copying.
+  static bool parse_as(std::string&& str, Type type, Variable& value);
 
   /// In a boolean context a variable is false if it does not contain a value.
   ///
@@ -102,9 +141,12 @@ public:
   constexpr Type type() const { return m_type; }
   /// Get value of the variable as a specific type.
   ///
+  /// Strings are returned by const reference to avoid copies. The reference
+  /// is only valid as long as the variable exists.
+  ///
   /// \exception std::invalid_argument if the requested type is incompatible
   template<typename T>
-  auto as() const;
+  decltype(auto) as() const;
 
 private:
   template<typename T>
@@ -112,14 +154,30 @@ private:
   template<typename I>
   struct IntegerConverter;
 
-  union {
-    int64_t m_integer;
-    double m_float;
-    bool m_boolean;
+  // strings are never modified and can be shared between variables
+  struct SharedString {
+    std::atomic<std::size_t> count;
+    std::string value;
+
+    SharedString(std::string&& s)
+      : count(1)
+      , value(std::move(s))
+    {
+    }
+  };
+
+  // named union to allow copying the active member w/o knowing which one
+  union Value {
+    int64_t integer;
+    double real;
+    bool boolean;
+    SharedString* string;
   };
-  // std::string has non-trivial constructor; cannot store by value in union
-  // TODO 2018-11-29 msmk: more space-efficient string storage
-  std::string m_string;
+
+  void retain();
+  void release();
+
+  Value m_value;
   Type m_type;
 
   friend std::ostream& operator<<(std::ostream& os, const Variable& v);
@@ -129,10 +187,44 @@ private:
 ///
 /// You can register commands and call them by name.
 class Dispatcher {
+private:
+  struct Command;
+
 public:
   /// The native dispatcher function interface.
   using Interface = std::function<Variable(const std::vector<Variable>&)>;
 
+  /// A pre-resolved command that can be called without a name lookup.
+  ///
+  /// The handle is valid as long as the dispatcher exists.
+  class Handle {
+  public:
+    /// Call the command with arbitrary arguments.
+    template<typename... Args>
+    Variable operator()(Args&&... args) const;
+    /// Call the command using the native argument encoding.
+    Variable call_native(const std::vector<Variable>& args) const;
+    /// Call the command with arguments parsed from strings.
+    Variable call_parsed(const std::vector<std::string>& args) const;
+    /// Call the command with arguments parsed from strings that are moved.
+    Variable call_parsed(std::vector<std::string>&& args) const;
+    /// Call the command with arguments parsed from a range of strings.
+    ///
+    /// Elements must provide `.data()` and `.size()`, e.g. `std::string_view`.
+    template<typename Iterator>
+    Variable call_parsed(Iterator first, Iterator last) const;
+
+  private:
+    Handle(const Command& cmd)
+      : m_cmd(&cmd)
+    {
+    }
+
+    const Command* m_cmd;
+
+    friend class Dispatcher;
+  };
+
   /// Register a native dispatcher function.
   ///
   /// \param name      Unique function name
@@ -157,15 +249,34 @@ public:
     std::string name, R (T::*member_func)(Args...), T* t,
     std::string help = std::string());
 
+  /// Find a command to call it repeatedly without a name lookup.
+  ///
+  /// \exception std::invalid_argument if the command does not exist
+  Handle find(const std::string& name) const;
   /// Call a command with arbitrary arguments.
   template<typename... Args>
   Variable call(const std::string& name, Args&&... args);
   /// Call a command with arguments parsed from strings into the expected types.
   Variable call_parsed(
     const std::string& name, const std::vector<std::string>& args);
+  /// Call a command with arguments parsed from strings that are moved.
+  Variable call_parsed(
+    const std::string& name, std::vector<std::string>&& args);
+  /// Call a command with arguments parsed from a range of strings.
+  ///
+  /// Elements must provide `.data()` and `.size()`, e.g. `std::string_view`.
+  template<typename Iterator>
+  Variable call_parsed(const std::string& name, Iterator first, Iterator last);
   /// Call a command using the native argument encoding.
   Variable call_native(
     const std::string& name, const std::vector<Variable>& args);
+  /// Call multiple commands with string arguments in the given order.
+  ///
+  /// Consecutive calls of the same command reuse the command lookup. All
+  /// calls share the same buffer for the parsed arguments.
+  std::vector<Variable> call_parsed(
+    const std::vector<std::pair<std::string, std::vector<std::string>>>&
+      commands);
 
   /// Return a list of registered commands.
   std::vector<std::string> commands() const;
@@ -173,105 +284,274 @@ public:
   const std::string& help(const std::string& name) const;
 
 private:
+  /// Call with a pointer to the expected number of arguments.
+  ///
+  /// Owns the type-erased function object and calls it through a plain
+  /// function pointer w/o the additional indirections of `std::function`.
+  class Invoker {
+  public:
+    Invoker() = default;
+    template<typename Func>
+    explicit Invoker(Func&& func);
+
+    explicit operator bool() const { return (m_call != nullptr); }
+    Variable operator()(const Variable* args) const
+    {
+      return m_call(m_func.get(), args);
+    }
+
+  private:
+    std::unique_ptr<void, void (*)(void*)> m_func{nullptr, nullptr};
+    Variable (*m_call)(void*, const Variable*) = nullptr;
+  };
+
   struct Command {
-    Interface func;
+    // either a native function or a typed function is set
+    Interface native;
+    Invoker func;
     std::vector<Variable::Type> argument_types;
     std::string help;
+
+    Variable invoke(const Variable* args, std::size_t n) const;
   };
+
+  void insert(
+    std::string name, Command&& cmd, std::vector<Variable::Type>&& arg_types,
+    std::string help);
+  const Command& lookup(const std::string& name) const;
+  template<typename Iterator>
+  static void parse(
+    const Command& cmd, Iterator first, Iterator last, Variable* parsed);
+  template<typename Iterator>
+  static void parse(
+    const Command& cmd, Iterator first, Iterator last,
+    std::vector<Variable>& parsed);
+
   std::unordered_map<std::string, Command> m_commands;
 };
 
+/// Execute dispatcher commands asynchronously on a dedicated thread.
+///
+/// Commands can be submitted from any number of threads without locking and
+/// are executed one after the other in submission order. Results and
+/// exceptions are available via the returned futures. Commands must not be
+/// added to the underlying dispatcher while the async dispatcher exists.
+class AsyncDispatcher {
+public:
+  /// Start the executor thread for the given dispatcher.
+  AsyncDispatcher(Dispatcher& dispatcher);
+  AsyncDispatcher(const AsyncDispatcher&) = delete;
+  AsyncDispatcher(AsyncDispatcher&&) = delete;
+  /// Finish all submitted commands and stop the executor thread.
+  ~AsyncDispatcher();
+  AsyncDispatcher& operator=(const AsyncDispatcher&) = delete;
+  AsyncDispatcher& operator=(AsyncDispatcher&&) = delete;
+
+  /// Submit a command with arbitrary arguments.
+  ///
+  /// \exception std::invalid_argument if the command does not exist
+  template<typename... Args>
+  std::future<Variable> submit(const std::string& name, Args&&... args);
+  /// Submit a command using the native argument encoding.
+  std::future<Variable> submit_native(
+    const std::string& name, std::vector<Variable> args);
+  /// Submit a command with arguments that are parsed on execution.
+  std::future<Variable> submit_parsed(
+    const std::string& name, std::vector<std::string> args);
+
+private:
+  struct Node {
+    std::atomic<Node*> next{nullptr};
+    std::packaged_task<Variable()> task;
+  };
+
+  std::future<Variable> push(std::packaged_task<Variable()>&& task);
+  Node* pop();
+  void run();
+
+  Dispatcher& m_dispatcher;
+  // intrusive multi-producer, single-consumer queue w/ a stub node. producers
+  // only modify the head; the executor is the only one accessing the tail.
+  std::atomic<Node*> m_head;
+  Node* m_tail;
+  // the executor only waits on the condition variable when idle
+  std::atomic<bool> m_idle;
+  std::atomic<bool> m_stop;
+  std::mutex m_mutex;
+  std::condition_variable m_wakeup;
+  std::thread m_executor;
+};
+
 // implementation Variable
 
+namespace dispatcher_impl {
+namespace {
+
+#if defined(DFE_DISPATCHER_USE_FROM_CHARS)
+template<typename T>
+inline bool
+parse_number(const char* str, std::size_t size, T& value)
+{
+  auto res = std::from_chars(str, str + size, value);
+  return (res.ec == std::errc()) and (res.ptr == (str + size));
+}
+#else
+// Convert a plain decimal integer w/ optional minus sign.
+inline bool
+parse_number(const char* str, std::size_t size, int64_t& value)
+{
+  return common_impl::parse_integer(str, str + size, value);
+}
+
+// Convert a floating point number independent of the global locale.
+inline bool
+parse_number(const char* str, std::size_t size, double& value)
+{
+  return common_impl::parse_double(str, str + size, value);
+}
+#endif
+
+} // namespace
+} // namespace dispatcher_impl
+
 inline Variable
 Variable::parse_as(const std::string& str, Type type)
+{
+  Variable value;
+  if (not parse_as(str.data(), str.size(), type, value)) {
+    throw std::invalid_argument("Could not parse '" + str + "'");
+  }
+  return value;
+}
+
+inline bool
+Variable::parse_as(
+  const char* str, std::size_t size, Type type, Variable& value)
 {
   if (type == Type::Boolean) {
-    return Variable((str == "true"));
+    value = Variable((size == 4) and (std::memcmp(str, "true", 4) == 0));
   } else if (type == Type::Integer) {
-    return Variable(std::stoll(str));
+    int64_t x;
+    if (not dispatcher_impl::parse_number(str, size, x)) { return false; }
+    value = Variable(x);
   } else if (type == Type::Float) {
-    return Variable(std::stod(str));
+    double x;
+    if (not dispatcher_impl::parse_number(str, size, x)) { return false; }
+    value = Variable(x);
   } else if (type == Type::String) {
-    return Variable(str);
+    value = Variable(std::string(str, size));
   } else {
-    return Variable();
+    value = Variable();
   }
+  return true;
+}
+
+inline bool
+Variable::parse_as(std::string&& str, Type type, Variable& value)
+{
+  if (type == Type::String) {
+    value = Variable(std::move(str));
+    return true;
+  }
+  return parse_as(str.data(), str.size(), type, value);
 }
 
 inline std::ostream&
 operator<<(std::ostream& os, const Variable& v)
 {
   if (v.type() == Variable::Type::Boolean) {
-    os << (v.m_boolean ? "true" : "false");
+    os << (v.m_value.boolean ? "true" : "false");
   } else if (v.m_type == Variable::Type::Integer) {
-    os << v.m_integer;
+    os << v.m_value.integer;
   } else if (v.m_type == Variable::Type::Float) {
-    os << v.m_float;
+    os << v.m_value.real;
   } else if (v.m_type == Variable::Type::String) {
-    os << v.m_string;
+    os << v.m_value.string->value;
   }
   return os;
 }
 
+inline void
+Variable::retain()
+{
+  if (m_type == Type::String) {
+    m_value.string->count.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+inline void
+Variable::release()
+{
+  if (m_type == Type::String) {
+    if (m_value.string->count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete m_value.string;
+    }
+  }
+  m_type = Type::Empty;
+}
+
+inline Variable::Variable(Variable&& v)
+  : m_value(v.m_value)
+  , m_type(v.m_type)
+{
+  // ownership of a shared string is transfered
+  v.m_type = Type::Empty;
+}
+
+inline Variable::Variable(const Variable& v)
+  : m_value(v.m_value)
+  , m_type(v.m_type)
+{
+  retain();
+}
+
 inline Variable&
 Variable::operator=(Variable&& v)
 {
   // handle `x = std::move(x)`
   if (this == &v) { return *this; }
-  if (v.m_type == Type::Boolean) {
-    m_boolean = v.m_boolean;
-  } else if (v.m_type == Type::Integer) {
-    m_integer = v.m_integer;
-  } else if (v.m_type == Type::Float) {
-    m_float = v.m_float;
-  } else if (v.m_type == Type::String) {
-    m_string = std::move(v.m_string);
-  }
+  release();
+  m_value = v.m_value;
   m_type = v.m_type;
+  v.m_type = Type::Empty;
   return *this;
 }
 
 inline Variable&
 Variable::operator=(const Variable& v)
 {
-  if (v.m_type == Type::Boolean) {
-    m_boolean = v.m_boolean;
-  } else if (v.m_type == Type::Integer) {
-    m_integer = v.m_integer;
-  } else if (v.m_type == Type::Float) {
-    m_float = v.m_float;
-  } else if (v.m_type == Type::String) {
-    m_string = v.m_string;
-  }
+  if (this == &v) { return *this; }
+  release();
+  m_value = v.m_value;
   m_type = v.m_type;
+  retain();
   return *this;
 }
 
 template<>
 struct Variable::Converter<bool> {
   static constexpr Type type() { return Type::Boolean; }
-  static constexpr bool as_t(const Variable& v) { return v.m_boolean; }
+  static constexpr bool as_t(const Variable& v) { return v.m_value.boolean; }
 };
 template<>
 struct Variable::Converter<float> {
   static constexpr Type type() { return Type::Float; }
   static constexpr float as_t(const Variable& v)
   {
-    return static_cast<float>(v.m_float);
+    return static_cast<float>(v.m_value.real);
   }
 };
 template<>
 struct Variable::Converter<double> {
   static constexpr Type type() { return Type::Float; }
-  static constexpr double as_t(const Variable& v) { return v.m_float; }
+  static constexpr double as_t(const Variable& v) { return v.m_value.real; }
 };
 template<>
 struct Variable::Converter<std::string> {
   static constexpr Type type() { return Type::String; }
-  static constexpr const std::string& as_t(const Variable& v)
+  static const std::string& as_t(const Variable& v)
   {
-    return v.m_string;
+    return v.m_value.string->value;
   }
 };
 template<typename I>
@@ -279,7 +559,7 @@ struct Variable::IntegerConverter {
   static constexpr Type type() { return Type::Integer; }
   static constexpr I as_t(const Variable& v)
   {
-    return static_cast<I>(v.m_integer);
+    return static_cast<I>(v.m_value.integer);
   }
 };
 template<>
@@ -308,7 +588,7 @@ struct Variable::Converter<uint64_t> : Variable::IntegerConverter<uint64_t> {
 };
 
 template<typename T>
-inline auto
+inline decltype(auto)
 Variable::as() const
 {
   if (m_type != Variable::Converter<T>::type()) {
@@ -324,48 +604,52 @@ namespace dispatcher_impl {
 namespace {
 
 // Wrap a function that returns a value
-template<typename R, typename... Args>
+//
+// Arguments are accessed w/o boundary checks; the number of arguments must be
+// checked beforehand.
+template<typename Func, typename R, typename... Args>
 struct InterfaceWrappper {
-  std::function<R(Args...)> func;
+  Func func;
 
-  Variable operator()(const std::vector<Variable>& args)
+  Variable operator()(const Variable* args)
   {
     return call(args, std::index_sequence_for<Args...>());
   }
   template<std::size_t... I>
-  Variable call(const std::vector<Variable>& args, std::index_sequence<I...>)
+  Variable call(const Variable* args, std::index_sequence<I...>)
   {
-    return Variable(func(args.at(I).as<typename std::decay_t<Args>>()...));
+    return Variable(func(args[I].as<typename std::decay_t<Args>>()...));
   }
 };
 
 // Wrap a function that does not return anything
-template<typename... Args>
-struct InterfaceWrappper<void, Args...> {
-  std::function<void(Args...)> func;
+template<typename Func, typename... Args>
+struct InterfaceWrappper<Func, void, Args...> {
+  Func func;
 
-  Variable operator()(const std::vector<Variable>& args)
+  Variable operator()(const Variable* args)
   {
     return call(args, std::index_sequence_for<Args...>());
   }
   template<std::size_t... I>
-  Variable call(const std::vector<Variable>& args, std::index_sequence<I...>)
+  Variable call(const Variable* args, std::index_sequence<I...>)
   {
-    func(args.at(I).as<typename std::decay_t<Args>>()...);
+    func(args[I].as<typename std::decay_t<Args>>()...);
     return Variable();
   }
 };
 
-template<typename R, typename... Args>
-inline Dispatcher::Interface
-make_wrapper(std::function<R(Args...)>&& function)
+// Store the function object directly to avoid an additional indirection
+template<typename R, typename... Args, typename Func>
+inline InterfaceWrappper<std::decay_t<Func>, R, Args...>
+make_wrapper(Func&& func)
 {
-  return InterfaceWrappper<R, Args...>{std::move(function)};
+  return {std::forward<Func>(func)};
 }
 
-template<typename R, typename... Args>
-std::vector<Variable::Type>
-make_types(const std::function<R(Args...)>&)
+template<typename... Args>
+inline std::vector<Variable::Type>
+make_types()
 {
   return {Variable(std::decay_t<Args>()).type()...};
 }
@@ -373,10 +657,31 @@ make_types(const std::function<R(Args...)>&)
 } // namespace
 } // namespace dispatcher_impl
 
+template<typename Func>
+inline Dispatcher::Invoker::Invoker(Func&& func)
+  : m_func(
+      new std::decay_t<Func>(std::forward<Func>(func)),
+      [](void* f) { delete static_cast<std::decay_t<Func>*>(f); })
+  , m_call([](void* f, const Variable* args) {
+    return (*static_cast<std::decay_t<Func>*>(f))(args);
+  })
+{
+}
+
+inline Variable
+Dispatcher::Command::invoke(const Variable* args, std::size_t n) const
+{
+  if (n != argument_types.size()) {
+    throw std::invalid_argument("Invalid number of arguments");
+  }
+  if (native) { return native(std::vector<Variable>(args, args + n)); }
+  return func(args);
+}
+
 inline void
-Dispatcher::add(
-  std::string name, Dispatcher::Interface&& func,
-  std::vector<Variable::Type>&& arg_types, std::string help)
+Dispatcher::insert(
+  std::string name, Command&& cmd, std::vector<Variable::Type>&& arg_types,
+  std::string help)
 {
   if (name.empty()) {
     throw std::invalid_argument("Can not register command with empty name");
@@ -385,8 +690,20 @@ Dispatcher::add(
     throw std::invalid_argument(
       "Can not register command '" + name + "' more than once");
   }
-  m_commands[std::move(name)] =
-    Command{std::move(func), std::move(arg_types), std::move(help)};
+  cmd.argument_types = std::move(arg_types);
+  cmd.help = std::move(help);
+  m_commands[std::move(name)] = std::move(cmd);
+}
+
+inline void
+Dispatcher::add(
+  std::string name, Dispatcher::Interface&& func,
+  std::vector<Variable::Type>&& arg_types, std::string help)
+{
+  Command cmd;
+  cmd.native = std::move(func);
+  insert(
+    std::move(name), std::move(cmd), std::move(arg_types), std::move(help));
 }
 
 template<typename R, typename... Args>
@@ -394,10 +711,12 @@ inline void
 Dispatcher::add(
   std::string name, std::function<R(Args...)>&& func, std::string help)
 {
-  auto args = dispatcher_impl::make_types(func);
-  add(
-    std::move(name), dispatcher_impl::make_wrapper(std::move(func)),
-    std::move(args), std::move(help));
+  Command cmd;
+  cmd.func =
+    Invoker(dispatcher_impl::make_wrapper<R, Args...>(std::move(func)));
+  insert(
+    std::move(name), std::move(cmd), dispatcher_impl::make_types<Args...>(),
+    std::move(help));
 }
 
 template<typename R, typename... Args>
@@ -405,7 +724,11 @@ inline void
 Dispatcher::add(std::string name, R (*func)(Args...), std::string help)
 {
   assert(func && "Function pointer must be non-null");
-  add(std::move(name), std::function<R(Args...)>(func), std::move(help));
+  Command cmd;
+  cmd.func = Invoker(dispatcher_impl::make_wrapper<R, Args...>(func));
+  insert(
+    std::move(name), std::move(cmd), dispatcher_impl::make_types<Args...>(),
+    std::move(help));
 }
 
 template<typename T, typename R, typename... Args>
@@ -415,53 +738,190 @@ Dispatcher::add(
 {
   assert(member_func && "Member function pointer must be non-null");
   assert(t && "Object pointer must be non-null");
-  add(
-    std::move(name), std::function<R(Args...)>([=](Args... args) {
-      return (t->*member_func)(args...);
-    }),
+  Command cmd;
+  auto bound = [=](Args... args) {
+    return (t->*member_func)(std::forward<Args>(args)...);
+  };
+  cmd.func = Invoker(dispatcher_impl::make_wrapper<R, Args...>(bound));
+  insert(
+    std::move(name), std::move(cmd), dispatcher_impl::make_types<Args...>(),
     std::move(help));
 }
 
-inline Variable
-Dispatcher::call_native(
-  const std::string& name, const std::vector<Variable>& args)
+inline const Dispatcher::Command&
+Dispatcher::lookup(const std::string& name) const
 {
   auto cmd = m_commands.find(name);
   if (cmd == m_commands.end()) {
     throw std::invalid_argument("Unknown command '" + name + "'");
   }
-  if (args.size() != cmd->second.argument_types.size()) {
+  return cmd->second;
+}
+
+inline Dispatcher::Handle
+Dispatcher::find(const std::string& name) const
+{
+  // references to map elements stay valid even if the map is rehashed
+  return Handle(lookup(name));
+}
+
+template<typename... Args>
+inline Variable
+Dispatcher::Handle::operator()(Args&&... args) const
+{
+  // arguments are stored on the stack; one extra element for zero arguments
+  Variable vargs[sizeof...(Args) + 1] = {Variable(std::forward<Args>(args))...};
+  return m_cmd->invoke(vargs, sizeof...(Args));
+}
+
+inline Variable
+Dispatcher::Handle::call_native(const std::vector<Variable>& args) const
+{
+  if (m_cmd->native and (args.size() == m_cmd->argument_types.size())) {
+    return m_cmd->native(args);
+  }
+  return m_cmd->invoke(args.data(), args.size());
+}
+
+inline Variable
+Dispatcher::call_native(
+  const std::string& name, const std::vector<Variable>& args)
+{
+  return Handle(lookup(name)).call_native(args);
+}
+
+namespace dispatcher_impl {
+namespace {
+
+template<typename String>
+inline bool
+parse_argument(const String& str, Variable::Type type, Variable& value)
+{
+  return Variable::parse_as(str.data(), str.size(), type, value);
+}
+
+inline bool
+parse_argument(std::string&& str, Variable::Type type, Variable& value)
+{
+  return Variable::parse_as(std::move(str), type, value);
+}
+
+} // namespace
+} // namespace dispatcher_impl
+
+// convert string arguments into Variable values of the expected types
+//
+// the number of arguments must be checked beforehand.
+template<typename Iterator>
+inline void
+Dispatcher::parse(
+  const Command& cmd, Iterator first, Iterator last, Variable* parsed)
+{
+  for (std::size_t i = 0; first != last; ++first, ++i) {
+    if (not dispatcher_impl::parse_argument(
+          *first, cmd.argument_types[i], parsed[i])) {
+      throw std::invalid_argument(
+        "Could not parse argument " + std::to_string(i));
+    }
+  }
+}
+
+template<typename Iterator>
+inline void
+Dispatcher::parse(
+  const Command& cmd, Iterator first, Iterator last,
+  std::vector<Variable>& parsed)
+{
+  std::size_t n = std::distance(first, last);
+  if (n != cmd.argument_types.size()) {
     throw std::invalid_argument("Invalid number of arguments");
   }
-  return cmd->second.func(args);
+  parsed.resize(n);
+  parse(cmd, first, last, parsed.data());
 }
 
+template<typename Iterator>
 inline Variable
-Dispatcher::call_parsed(
-  const std::string& name, const std::vector<std::string>& args)
+Dispatcher::Handle::call_parsed(Iterator first, Iterator last) const
 {
-  // dont reuse call_native since we need to have access to the command anyways
-  auto cmd = m_commands.find(name);
-  if (cmd == m_commands.end()) {
-    throw std::invalid_argument("Unknown command '" + name + "'");
+  // typed commands w/ few arguments store the arguments on the stack. native
+  // commands require a vector anyways.
+  static constexpr std::size_t kNumStackArgs = 8;
+
+  std::size_t n = std::distance(first, last);
+  if (m_cmd->native or (kNumStackArgs < n)) {
+    std::vector<Variable> vargs;
+    parse(*m_cmd, first, last, vargs);
+    return call_native(vargs);
   }
-  if (args.size() != cmd->second.argument_types.size()) {
+  if (n != m_cmd->argument_types.size()) {
     throw std::invalid_argument("Invalid number of arguments");
   }
-  // convert string arguments into Variable values
+  Variable vargs[kNumStackArgs];
+  parse(*m_cmd, first, last, vargs);
+  return m_cmd->func(vargs);
+}
+
+inline Variable
+Dispatcher::Handle::call_parsed(const std::vector<std::string>& args) const
+{
+  return call_parsed(args.begin(), args.end());
+}
+
+inline Variable
+Dispatcher::Handle::call_parsed(std::vector<std::string>&& args) const
+{
+  return call_parsed(
+    std::make_move_iterator(args.begin()), std::make_move_iterator(args.end()));
+}
+
+inline Variable
+Dispatcher::call_parsed(
+  const std::string& name, const std::vector<std::string>& args)
+{
+  return Handle(lookup(name)).call_parsed(args);
+}
+
+inline Variable
+Dispatcher::call_parsed(
+  const std::string& name, std::vector<std::string>&& args)
+{
+  return Handle(lookup(name)).call_parsed(std::move(args));
+}
+
+template<typename Iterator>
+inline Variable
+Dispatcher::call_parsed(const std::string& name, Iterator first, Iterator last)
+{
+  return Handle(lookup(name)).call_parsed(first, last);
+}
+
+inline std::vector<Variable>
+Dispatcher::call_parsed(
+  const std::vector<std::pair<std::string, std::vector<std::string>>>&
+    commands)
+{
+  std::vector<Variable> results;
   std::vector<Variable> vargs;
-  for (std::size_t i = 0; i < args.size(); ++i) {
-    vargs.push_back(Variable::parse_as(args[i], cmd->second.argument_types[i]));
+  results.reserve(commands.size());
+  const std::string* name = nullptr;
+  const Command* cmd = nullptr;
+  for (const auto& command : commands) {
+    if (not name or (*name != command.first)) {
+      name = &command.first;
+      cmd = &lookup(*name);
+    }
+    parse(*cmd, command.second.begin(), command.second.end(), vargs);
+    results.push_back(Handle(*cmd).call_native(vargs));
   }
-  return cmd->second.func(vargs);
+  return results;
 }
 
 template<typename... Args>
 inline Variable
 Dispatcher::call(const std::string& name, Args&&... args)
 {
-  return call_native(
-    name, std::vector<Variable>{Variable(std::forward<Args>(args))...});
+  return Handle(lookup(name))(std::forward<Args>(args)...);
 }
 
 inline std::vector<std::string>
@@ -476,7 +936,112 @@ Dispatcher::commands() const
 inline const std::string&
 Dispatcher::help(const std::string& name) const
 {
-  return m_commands.at(name).help;
+  return lookup(name).help;
+}
+
+// implementation AsyncDispatcher
+
+inline AsyncDispatcher::AsyncDispatcher(Dispatcher& dispatcher)
+  : m_dispatcher(dispatcher)
+  , m_head(new Node())
+  , m_idle(false)
+  , m_stop(false)
+{
+  m_tail = m_head.load();
+  m_executor = std::thread(&AsyncDispatcher::run, this);
+}
+
+inline AsyncDispatcher::~AsyncDispatcher()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wakeup.notify_one();
+  m_executor.join();
+  // the stub node is the only remaining node
+  delete m_tail;
+}
+
+template<typename... Args>
+inline std::future<Variable>
+AsyncDispatcher::submit(const std::string& name, Args&&... args)
+{
+  return submit_native(
+    name, std::vector<Variable>{Variable(std::forward<Args>(args))...});
+}
+
+inline std::future<Variable>
+AsyncDispatcher::submit_native(
+  const std::string& name, std::vector<Variable> args)
+{
+  // lookup on submission to report unknown commands immediately
+  auto cmd = m_dispatcher.find(name);
+  return push(std::packaged_task<Variable()>(
+    [cmd, args = std::move(args)]() { return cmd.call_native(args); }));
+}
+
+inline std::future<Variable>
+AsyncDispatcher::submit_parsed(
+  const std::string& name, std::vector<std::string> args)
+{
+  auto cmd = m_dispatcher.find(name);
+  return push(std::packaged_task<Variable()>(
+    [cmd, args = std::move(args)]() { return cmd.call_parsed(args); }));
+}
+
+inline std::future<Variable>
+AsyncDispatcher::push(std::packaged_task<Variable()>&& task)
+{
+  auto result = task.get_future();
+  Node* node = new Node();
+  node->task = std::move(task);
+  Node* prev = m_head.exchange(node, std::memory_order_acq_rel);
+  prev->next.store(node, std::memory_order_seq_cst);
+  // only notify if the executor is waiting. sequentially consistent accesses
+  // to the link and the idle flag, here and in run(), guarantee that either
+  // the executor sees the new node or the producer sees the idle flag.
+  if (m_idle.exchange(false)) {
+    { std::lock_guard<std::mutex> lock(m_mutex); }
+    m_wakeup.notify_one();
+  }
+  return result;
+}
+
+// remove the next node from the queue or return nullptr if it is empty.
+//
+// the returned node becomes the new stub node. its task must be used before
+// the next pop since the node is deleted then.
+inline AsyncDispatcher::Node*
+AsyncDispatcher::pop()
+{
+  Node* next = m_tail->next.load(std::memory_order_acquire);
+  if (not next) { return nullptr; }
+  delete m_tail;
+  m_tail = next;
+  return next;
+}
+
+inline void
+AsyncDispatcher::run()
+{
+  while (true) {
+    Node* node = pop();
+    if (node) {
+      node->task();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle = true;
+    // re-check for nodes that were added before the idle flag was visible
+    if (m_tail->next.load(std::memory_order_seq_cst)) {
+      m_idle = false;
+      continue;
+    }
+    if (m_stop) { return; }
+    m_wakeup.wait(lock, [this]() { return not m_idle or m_stop; });
+    m_idle = false;
+  }
 }
 
 } // namespace dfe
@@ -26,11 +26,27 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <initializer_list>
+#include <iterator>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace dfe {
+namespace flat_impl {
+
+template<typename... Ts>
+struct MakeVoid {
+  using type = void;
+};
+// Only valid if all function objects support heterogeneous arguments.
+template<typename... Functions>
+using Transparent =
+  typename MakeVoid<typename Functions::is_transparent...>::type;
+
+} // namespace flat_impl
 
 /// An container adaptor to store a set of elements in a sequential container.
 ///
@@ -57,6 +73,18 @@ public:
   using size_type = typename Container::size_type;
   using const_iterator = typename Container::const_iterator;
 
+  FlatSet() = default;
+  /// Construct the set from a range of elements.
+  ///
+  /// Equivalent elements are resolved as if they were added in order using
+  /// `insert_or_assign(...)`, i.e. only the last one is kept.
+  template<typename InputIt>
+  FlatSet(InputIt first, InputIt last);
+  FlatSet(std::initializer_list<T> elements)
+    : FlatSet(elements.begin(), elements.end())
+  {
+  }
+
   /// Access the equivalent element or throw if it does not exists.
   template<typename U>
   const value_type& at(U&& u) const;
@@ -78,6 +106,19 @@ public:
   /// function. Only one can be kept and this function replaces the existing
   /// element with the new one in such a case.
   void insert_or_assign(const T& t);
+  /// Add multiple elements or replace existing equivalent elements.
+  ///
+  /// Equivalent elements are resolved as if they were added in order using
+  /// `insert_or_assign(...)`. The new elements are sorted once and merged with
+  /// the existing ones, i.e. adding M elements to a set of size N requires
+  /// O(M log M + N) operations instead of O(M N).
+  template<typename InputIt>
+  void insert(InputIt first, InputIt last);
+  /// Add all elements from another set or replace existing ones.
+  ///
+  /// Equivalent elements from the other set replace the existing ones. Both
+  /// sets are already sorted and are merged in linear time.
+  void merge(const FlatSet& other);
 
   /// Return an interator to the equivalent element or `.end()` if not found.
   template<typename U>
@@ -87,6 +128,9 @@ public:
   bool contains(U&& u) const;
 
 private:
+  // merge the sorted and unique elements starting at the given position
+  void merge_sorted_tail(size_type pos);
+
   Container m_items;
 };
 
@@ -97,9 +141,14 @@ private:
 /// \tparam Compare Function satisfying the `Compare` name requirements for keys
 ///
 /// Supports access by key, clearing all elements, adding or replacing the
-/// stored value for a given key, and membership checks. Keys and values are
-/// stored in separate sequential containers to simplify allocation and benefit
-/// from greater memory locality.
+/// stored value for a given key, removing elements, and membership checks.
+/// Keys and values are stored in separate, parallel sequential containers that
+/// are both sorted by key. Lookups only search the compact key storage and
+/// then directly access the value at the same position.
+///
+/// If the `Compare` function is transparent, i.e. it defines an
+/// `is_transparent` member type as e.g. `std::less<>`, lookups accept any type
+/// that can be compared with the keys w/o constructing a temporary key.
 template<typename Key, typename T, typename Compare = std::less<Key>>
 class FlatMap {
 public:
@@ -107,10 +156,37 @@ public:
   using value_type = T;
   using size_type = std::size_t;
 
+  FlatMap() = default;
+  /// Construct the map from a range of key-value pairs.
+  ///
+  /// Duplicate keys are resolved as if the elements were added in order using
+  /// `emplace(...)`, i.e. only the last value is kept.
+  template<typename InputIt>
+  FlatMap(InputIt first, InputIt last);
+  FlatMap(std::initializer_list<std::pair<Key, T>> elements)
+    : FlatMap(elements.begin(), elements.end())
+  {
+  }
+
   /// Writable access to an element or throw if it does not exists.
-  value_type& at(const Key& key) { return m_items[m_keys.at(key).index]; }
+  value_type& at(const Key& key) { return m_items[checked_index(key)]; }
+  template<
+    typename K, typename C = Compare, typename = flat_impl::Transparent<C>>
+  value_type& at(const K& key)
+  {
+    return m_items[checked_index(key)];
+  }
   /// Read-only access to an element or throw if it does not exists.
-  const value_type& at(const Key& key) const { return m_items[m_keys.at(key).index]; }
+  const value_type& at(const Key& key) const
+  {
+    return m_items[checked_index(key)];
+  }
+  template<
+    typename K, typename C = Compare, typename = flat_impl::Transparent<C>>
+  const value_type& at(const K& key) const
+  {
+    return m_items[checked_index(key)];
+  }
 
   /// Return true if there are no elements in the map.
   bool empty() const { return m_keys.empty(); }
@@ -125,36 +201,210 @@ public:
   /// forwarded to a `T(...)` constructor call.
   template<typename... Params>
   void emplace(const Key& key, Params&&... params);
+  /// Add or replace multiple elements from a range of key-value pairs.
+  ///
+  /// Duplicate keys are resolved as if the elements were added in order using
+  /// `emplace(...)`.
+  template<typename InputIt>
+  void insert(InputIt first, InputIt last);
+  /// Add all elements from another map or replace existing ones.
+  void merge(const FlatMap& other);
+  /// Remove the element with the given key and return the number of removed
+  /// elements, i.e. zero or one.
+  size_type erase(const Key& key) { return erase_impl(key); }
+  template<
+    typename K, typename C = Compare, typename = flat_impl::Transparent<C>>
+  size_type erase(const K& key)
+  {
+    return erase_impl(key);
+  }
 
   /// Return true if an element exists for the given key
-  bool contains(const Key& key) const { return m_keys.contains(key); }
+  bool contains(const Key& key) const { return index(key) != m_keys.size(); }
+  template<
+    typename K, typename C = Compare, typename = flat_impl::Transparent<C>>
+  bool contains(const K& key) const
+  {
+    return index(key) != m_keys.size();
+  }
 
 private:
-  struct KeyIndex {
-    Key key;
-    size_type index;
-  };
-  struct KeyCompare {
-    constexpr bool operator()(const KeyIndex& lhs, const KeyIndex& rhs) const
-    {
-      return Compare()(lhs.key, rhs.key);
-    }
-    constexpr bool operator()(const KeyIndex& lhs, const Key& rhs_key) const
-    {
-      return Compare()(lhs.key, rhs_key);
-    }
-    constexpr bool operator()(const Key& lhs_key, const KeyIndex& rhs) const
-    {
-      return Compare()(lhs_key, rhs.key);
-    }
-  };
+  // position of the first key that is not less then the given key
+  template<typename K>
+  size_type lower_bound(const K& key) const;
+  // position of the equivalent key or the number of elements if not found
+  template<typename K>
+  size_type index(const K& key) const;
+  template<typename K>
+  size_type checked_index(const K& key) const;
+  template<typename K>
+  size_type erase_impl(const K& key);
+  // merge sorted keys and values w/ unique keys into the existing elements
+  void merge_sorted(std::vector<Key>&& keys, std::vector<T>&& items);
 
-  FlatSet<KeyIndex, KeyCompare> m_keys;
+  std::vector<Key> m_keys;
   std::vector<T> m_items;
 };
 
+/// A key-value map that uses open-addressing hashing w/ continous storage.
+///
+/// \tparam Key      Stored element key type
+/// \tparam T        Stored element value type
+/// \tparam Hash     Hash function object for keys
+/// \tparam KeyEqual Equality function object for keys
+///
+/// Provides the same interface as `FlatMap` using a hash table instead of a
+/// binary search for lookups. This should be preferred over `FlatMap` for a
+/// large number of keys.
+///
+/// Keys and values are stored in parallel sequential containers without a
+/// specific order and without holes. A separate, linear-probing table of
+/// positions into the key and value storage is used for lookups. If both
+/// `Hash` and `KeyEqual` are transparent, lookups accept any type that can be
+/// hashed and compared with the keys w/o constructing a temporary key.
+template<
+  typename Key, typename T, typename Hash = std::hash<Key>,
+  typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap {
+public:
+  using key_type = Key;
+  using value_type = T;
+  using size_type = std::size_t;
+
+  FlatHashMap() = default;
+  /// Construct the map from a range of key-value pairs.
+  ///
+  /// Duplicate keys are resolved as if the elements were added in order using
+  /// `emplace(...)`, i.e. only the last value is kept.
+  template<typename InputIt>
+  FlatHashMap(InputIt first, InputIt last);
+  FlatHashMap(std::initializer_list<std::pair<Key, T>> elements)
+    : FlatHashMap(elements.begin(), elements.end())
+  {
+  }
+
+  /// Writable access to an element or throw if it does not exists.
+  value_type& at(const Key& key) { return m_items[checked_index(key)]; }
+  template<
+    typename K, typename H = Hash, typename E = KeyEqual,
+    typename = flat_impl::Transparent<H, E>>
+  value_type& at(const K& key)
+  {
+    return m_items[checked_index(key)];
+  }
+  /// Read-only access to an element or throw if it does not exists.
+  const value_type& at(const Key& key) const
+  {
+    return m_items[checked_index(key)];
+  }
+  template<
+    typename K, typename H = Hash, typename E = KeyEqual,
+    typename = flat_impl::Transparent<H, E>>
+  const value_type& at(const K& key) const
+  {
+    return m_items[checked_index(key)];
+  }
+
+  /// Return true if there are no elements in the map.
+  bool empty() const { return m_keys.empty(); }
+  /// Return the number of elements in the container.
+  size_type size() const { return m_keys.size(); }
+
+  /// Remove all elements from the container.
+  void clear();
+  /// Ensure that the given number of elements can be stored w/o rehashing.
+  void reserve(size_type size);
+  /// Add the element under the given key or replace an existing element.
+  ///
+  /// New elements are constructed or assigned in-place with the parameters
+  /// forwarded to a `T(...)` constructor call.
+  template<typename... Params>
+  void emplace(const Key& key, Params&&... params);
+  /// Add or replace multiple elements from a range of key-value pairs.
+  ///
+  /// Duplicate keys are resolved as if the elements were added in order using
+  /// `emplace(...)`.
+  template<typename InputIt>
+  void insert(InputIt first, InputIt last);
+  /// Add all elements from another map or replace existing ones.
+  void merge(const FlatHashMap& other);
+  /// Remove the element with the given key and return the number of removed
+  /// elements, i.e. zero or one.
+  size_type erase(const Key& key) { return erase_impl(key); }
+  template<
+    typename K, typename H = Hash, typename E = KeyEqual,
+    typename = flat_impl::Transparent<H, E>>
+  size_type erase(const K& key)
+  {
+    return erase_impl(key);
+  }
+
+  /// Return true if an element exists for the given key
+  bool contains(const Key& key) const { return find_slot(key).second; }
+  template<
+    typename K, typename H = Hash, typename E = KeyEqual,
+    typename = flat_impl::Transparent<H, E>>
+  bool contains(const K& key) const
+  {
+    return find_slot(key).second;
+  }
+
+private:
+  static constexpr size_type kEmpty = SIZE_MAX;
+
+  // initial slot for the given key
+  template<typename K>
+  size_type home_slot(const K& key) const;
+  // slot w/ the equivalent key or the empty slot where it would be inserted
+  template<typename K>
+  std::pair<size_type, bool> find_slot(const K& key) const;
+  template<typename K>
+  size_type checked_index(const K& key) const;
+  template<typename K>
+  size_type erase_impl(const K& key);
+  void rehash(size_type num_slots);
+
+  std::vector<Key> m_keys;
+  std::vector<T> m_items;
+  // positions into the key and value storage; size is always a power of two
+  std::vector<size_type> m_slots;
+};
+
+namespace flat_impl {
+namespace {
+
+// Remove consecutive equivalent elements in a sorted range except the last one.
+//
+// Returns the new end of the range of unique elements.
+template<typename Iterator, typename Compare>
+inline Iterator
+unique_keep_last(Iterator first, Iterator last, Compare compare)
+{
+  if (first == last) { return last; }
+  Iterator out = first;
+  for (Iterator next = std::next(first); next != last; ++first, ++next) {
+    // the element is the last one of its equivalence group
+    if (compare(*first, *next)) {
+      if (out != first) { *out = std::move(*first); }
+      ++out;
+    }
+  }
+  if (out != first) { *out = std::move(*first); }
+  return ++out;
+}
+
+} // namespace
+} // namespace flat_impl
+
 // implementation FlatSet
 
+template<typename T, typename Compare, typename Container>
+template<typename InputIt>
+inline FlatSet<T, Compare, Container>::FlatSet(InputIt first, InputIt last)
+{
+  insert(first, last);
+}
+
 template<typename T, typename Compare, typename Container>
 template<typename U>
 inline const typename FlatSet<T, Compare, Container>::value_type&
@@ -179,6 +429,44 @@ FlatSet<T, Compare, Container>::insert_or_assign(const T& t)
   }
 }
 
+template<typename T, typename Compare, typename Container>
+template<typename InputIt>
+inline void
+FlatSet<T, Compare, Container>::insert(InputIt first, InputIt last)
+{
+  size_type pos = m_items.size();
+  for (; first != last; ++first) { m_items.emplace_back(*first); }
+  // stable sorting keeps the insertion order for equivalent elements
+  auto tail = std::next(m_items.begin(), pos);
+  std::stable_sort(tail, m_items.end(), Compare());
+  m_items.erase(
+    flat_impl::unique_keep_last(tail, m_items.end(), Compare()),
+    m_items.end());
+  merge_sorted_tail(pos);
+}
+
+template<typename T, typename Compare, typename Container>
+inline void
+FlatSet<T, Compare, Container>::merge(const FlatSet& other)
+{
+  size_type pos = m_items.size();
+  for (const auto& t : other.m_items) { m_items.emplace_back(t); }
+  merge_sorted_tail(pos);
+}
+
+template<typename T, typename Compare, typename Container>
+inline void
+FlatSet<T, Compare, Container>::merge_sorted_tail(size_type pos)
+{
+  auto middle = std::next(m_items.begin(), pos);
+  if ((middle == m_items.begin()) or (middle == m_items.end())) { return; }
+  // merging is stable, i.e. the equivalent new element follows the old one
+  std::inplace_merge(m_items.begin(), middle, m_items.end(), Compare());
+  m_items.erase(
+    flat_impl::unique_keep_last(m_items.begin(), m_items.end(), Compare()),
+    m_items.end());
+}
+
 template<typename T, typename Compare, typename Container>
 template<typename U>
 inline typename FlatSet<T, Compare, Container>::const_iterator
@@ -201,17 +489,323 @@ FlatSet<T, Compare, Container>::contains(U&& u) const
 
 // implementation FlatMap
 
+template<typename Key, typename T, typename Compare>
+template<typename InputIt>
+inline FlatMap<Key, T, Compare>::FlatMap(InputIt first, InputIt last)
+{
+  insert(first, last);
+}
+
+template<typename Key, typename T, typename Compare>
+template<typename K>
+inline typename FlatMap<Key, T, Compare>::size_type
+FlatMap<Key, T, Compare>::lower_bound(const K& key) const
+{
+  return std::lower_bound(m_keys.begin(), m_keys.end(), key, Compare()) -
+         m_keys.begin();
+}
+
+template<typename Key, typename T, typename Compare>
+template<typename K>
+inline typename FlatMap<Key, T, Compare>::size_type
+FlatMap<Key, T, Compare>::index(const K& key) const
+{
+  size_type idx = lower_bound(key);
+  if ((idx != m_keys.size()) and not Compare()(key, m_keys[idx])) {
+    return idx;
+  }
+  return m_keys.size();
+}
+
+template<typename Key, typename T, typename Compare>
+template<typename K>
+inline typename FlatMap<Key, T, Compare>::size_type
+FlatMap<Key, T, Compare>::checked_index(const K& key) const
+{
+  size_type idx = index(key);
+  if (idx == m_keys.size()) {
+    throw std::out_of_range("The requested element does not exists");
+  }
+  return idx;
+}
+
 template<typename Key, typename T, typename Compare>
 template<typename... Params>
 inline void
 FlatMap<Key, T, Compare>::emplace(const Key& key, Params&&... params)
 {
-  auto idx = m_keys.find(key);
-  if (idx != m_keys.end()) {
-    m_items[idx->index] = T(std::forward<Params>(params)...);
+  size_type idx = lower_bound(key);
+  if ((idx != m_keys.size()) and not Compare()(key, m_keys[idx])) {
+    m_items[idx] = T(std::forward<Params>(params)...);
   } else {
-    m_items.emplace_back(std::forward<Params>(params)...);
-    m_keys.insert_or_assign(KeyIndex{key, m_items.size() - 1});
+    auto pos = m_keys.emplace(std::next(m_keys.begin(), idx), key);
+    try {
+      m_items.emplace(
+        std::next(m_items.begin(), idx), std::forward<Params>(params)...);
+    } catch (...) {
+      // keep keys and values consistent
+      m_keys.erase(pos);
+      throw;
+    }
+  }
+}
+
+template<typename Key, typename T, typename Compare>
+template<typename InputIt>
+inline void
+FlatMap<Key, T, Compare>::insert(InputIt first, InputIt last)
+{
+  using Element = std::pair<Key, T>;
+
+  auto compare = [](const Element& lhs, const Element& rhs) {
+    return Compare()(lhs.first, rhs.first);
+  };
+
+  std::vector<Element> elements;
+  for (; first != last; ++first) {
+    elements.emplace_back(first->first, first->second);
+  }
+  std::stable_sort(elements.begin(), elements.end(), compare);
+  elements.erase(
+    flat_impl::unique_keep_last(elements.begin(), elements.end(), compare),
+    elements.end());
+  // split into the parallel storage layout
+  std::vector<Key> keys;
+  std::vector<T> items;
+  keys.reserve(elements.size());
+  items.reserve(elements.size());
+  for (auto& element : elements) {
+    keys.push_back(std::move(element.first));
+    items.push_back(std::move(element.second));
+  }
+  merge_sorted(std::move(keys), std::move(items));
+}
+
+template<typename Key, typename T, typename Compare>
+inline void
+FlatMap<Key, T, Compare>::merge(const FlatMap& other)
+{
+  merge_sorted(std::vector<Key>(other.m_keys), std::vector<T>(other.m_items));
+}
+
+template<typename Key, typename T, typename Compare>
+template<typename K>
+inline typename FlatMap<Key, T, Compare>::size_type
+FlatMap<Key, T, Compare>::erase_impl(const K& key)
+{
+  size_type idx = index(key);
+  if (idx == m_keys.size()) { return 0; }
+  m_keys.erase(std::next(m_keys.begin(), idx));
+  m_items.erase(std::next(m_items.begin(), idx));
+  return 1;
+}
+
+template<typename Key, typename T, typename Compare>
+inline void
+FlatMap<Key, T, Compare>::merge_sorted(
+  std::vector<Key>&& keys, std::vector<T>&& items)
+{
+  if (keys.empty()) { return; }
+  if (m_keys.empty()) {
+    m_keys = std::move(keys);
+    m_items = std::move(items);
+    return;
+  }
+
+  std::vector<Key> merged_keys;
+  std::vector<T> merged_items;
+  merged_keys.reserve(m_keys.size() + keys.size());
+  merged_items.reserve(m_items.size() + items.size());
+
+  // both key sets are sorted and can be processed in a single pass
+  size_type i = 0;
+  size_type j = 0;
+  while ((i < m_keys.size()) and (j < keys.size())) {
+    if (Compare()(m_keys[i], keys[j])) {
+      merged_keys.push_back(std::move(m_keys[i]));
+      merged_items.push_back(std::move(m_items[i]));
+      ++i;
+    } else {
+      // the new element replaces an equivalent existing one
+      if (not Compare()(keys[j], m_keys[i])) { ++i; }
+      merged_keys.push_back(std::move(keys[j]));
+      merged_items.push_back(std::move(items[j]));
+      ++j;
+    }
+  }
+  for (; i < m_keys.size(); ++i) {
+    merged_keys.push_back(std::move(m_keys[i]));
+    merged_items.push_back(std::move(m_items[i]));
+  }
+  for (; j < keys.size(); ++j) {
+    merged_keys.push_back(std::move(keys[j]));
+    merged_items.push_back(std::move(items[j]));
+  }
+  m_keys = std::move(merged_keys);
+  m_items = std::move(merged_items);
+}
+
+// implementation FlatHashMap
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+constexpr typename FlatHashMap<Key, T, Hash, KeyEqual>::size_type
+  FlatHashMap<Key, T, Hash, KeyEqual>::kEmpty;
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+template<typename InputIt>
+inline FlatHashMap<Key, T, Hash, KeyEqual>::FlatHashMap(
+  InputIt first, InputIt last)
+{
+  insert(first, last);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+template<typename K>
+inline typename FlatHashMap<Key, T, Hash, KeyEqual>::size_type
+FlatHashMap<Key, T, Hash, KeyEqual>::home_slot(const K& key) const
+{
+  // fibonacci hashing mixes the bits of simple hash functions, e.g. identity
+  uint64_t hash = static_cast<uint64_t>(Hash()(key));
+  return static_cast<size_type>((UINT64_C(11400714819323198485) * hash) >> 32) &
+         (m_slots.size() - 1);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+template<typename K>
+inline std::pair<typename FlatHashMap<Key, T, Hash, KeyEqual>::size_type, bool>
+FlatHashMap<Key, T, Hash, KeyEqual>::find_slot(const K& key) const
+{
+  if (m_slots.empty()) { return {kEmpty, false}; }
+  size_type mask = m_slots.size() - 1;
+  // load factor is always below one, i.e. there is at least one empty slot
+  for (size_type i = home_slot(key);; i = (i + 1) & mask) {
+    if (m_slots[i] == kEmpty) { return {i, false}; }
+    if (KeyEqual()(m_keys[m_slots[i]], key)) { return {i, true}; }
+  }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+template<typename K>
+inline typename FlatHashMap<Key, T, Hash, KeyEqual>::size_type
+FlatHashMap<Key, T, Hash, KeyEqual>::checked_index(const K& key) const
+{
+  auto slot = find_slot(key);
+  if (not slot.second) {
+    throw std::out_of_range("The requested element does not exists");
+  }
+  return m_slots[slot.first];
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+inline void
+FlatHashMap<Key, T, Hash, KeyEqual>::clear()
+{
+  m_keys.clear();
+  m_items.clear();
+  m_slots.clear();
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+inline void
+FlatHashMap<Key, T, Hash, KeyEqual>::reserve(size_type size)
+{
+  // keep the load factor below 1/2 to limit the probe lengths
+  size_type num_slots = 16;
+  while (num_slots < (2 * size)) { num_slots *= 2; }
+  if (m_slots.size() < num_slots) { rehash(num_slots); }
+  m_keys.reserve(size);
+  m_items.reserve(size);
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+template<typename... Params>
+inline void
+FlatHashMap<Key, T, Hash, KeyEqual>::emplace(
+  const Key& key, Params&&... params)
+{
+  auto slot = find_slot(key);
+  if (slot.second) {
+    m_items[m_slots[slot.first]] = T(std::forward<Params>(params)...);
+    return;
+  }
+  // the probe sequence changes w/ rehashing and the slot must be found again
+  if (m_slots.size() < (2 * (m_keys.size() + 1))) {
+    rehash(m_slots.empty() ? 16 : (2 * m_slots.size()));
+    slot = find_slot(key);
+  }
+  m_items.emplace_back(std::forward<Params>(params)...);
+  try {
+    m_keys.push_back(key);
+  } catch (...) {
+    // keep keys and values consistent
+    m_items.pop_back();
+    throw;
+  }
+  m_slots[slot.first] = m_keys.size() - 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+template<typename InputIt>
+inline void
+FlatHashMap<Key, T, Hash, KeyEqual>::insert(InputIt first, InputIt last)
+{
+  for (; first != last; ++first) { emplace(first->first, first->second); }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+inline void
+FlatHashMap<Key, T, Hash, KeyEqual>::merge(const FlatHashMap& other)
+{
+  reserve(m_keys.size() + other.m_keys.size());
+  for (size_type i = 0; i < other.m_keys.size(); ++i) {
+    emplace(other.m_keys[i], other.m_items[i]);
+  }
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+template<typename K>
+inline typename FlatHashMap<Key, T, Hash, KeyEqual>::size_type
+FlatHashMap<Key, T, Hash, KeyEqual>::erase_impl(const K& key)
+{
+  auto slot = find_slot(key);
+  if (not slot.second) { return 0; }
+
+  // move the last element into the hole to keep the storage continous
+  size_type idx = m_slots[slot.first];
+  size_type last = m_keys.size() - 1;
+  if (idx != last) {
+    m_slots[find_slot(m_keys[last]).first] = idx;
+    m_keys[idx] = std::move(m_keys[last]);
+    m_items[idx] = std::move(m_items[last]);
+  }
+  m_keys.pop_back();
+  m_items.pop_back();
+
+  // backward-shift deletion keeps all probe sequences intact w/o tombstones
+  size_type mask = m_slots.size() - 1;
+  size_type hole = slot.first;
+  for (size_type i = (hole + 1) & mask; m_slots[i] != kEmpty;
+       i = (i + 1) & mask) {
+    size_type home = home_slot(m_keys[m_slots[i]]);
+    // distance from the home slot, taking wrap-around into account
+    if (((i - home) & mask) < ((i - hole) & mask)) { continue; }
+    m_slots[hole] = m_slots[i];
+    hole = i;
+  }
+  m_slots[hole] = kEmpty;
+  return 1;
+}
+
+template<typename Key, typename T, typename Hash, typename KeyEqual>
+inline void
+FlatHashMap<Key, T, Hash, KeyEqual>::rehash(size_type num_slots)
+{
+  m_slots.assign(num_slots, kEmpty);
+  size_type mask = num_slots - 1;
+  for (size_type idx = 0; idx < m_keys.size(); ++idx) {
+    size_type i = home_slot(m_keys[idx]);
+    while (m_slots[i] != kEmpty) { i = (i + 1) & mask; }
+    m_slots[i] = idx;
   }
 }
 
@@ -27,11 +27,20 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <numeric>
 #include <stdexcept>
+#include <thread>
+#include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -39,6 +48,40 @@ namespace dfe {
 namespace histogram_impl {
 namespace {
 
+/// Allocate storage aligned to and padded to full cache lines.
+///
+/// Separate allocations never share a cache line, e.g. to avoid false sharing
+/// between arrays that are modified concurrently by different threads.
+template<typename T>
+class CacheLineAllocator {
+public:
+  using value_type = T;
+
+  static constexpr std::size_t kLineSize = 64;
+
+  CacheLineAllocator() = default;
+  template<typename U>
+  constexpr CacheLineAllocator(const CacheLineAllocator<U>&) noexcept
+  {
+  }
+
+  T* allocate(std::size_t n);
+  void deallocate(T* ptr, std::size_t n) noexcept;
+};
+
+template<typename T, typename U>
+constexpr bool
+operator==(const CacheLineAllocator<T>&, const CacheLineAllocator<U>&)
+{
+  return true;
+}
+template<typename T, typename U>
+constexpr bool
+operator!=(const CacheLineAllocator<T>&, const CacheLineAllocator<U>&)
+{
+  return false;
+}
+
 /// A simple n-dimensional array.
 ///
 /// Data must be accessed through n-dimensional indices. The internal
@@ -67,13 +110,176 @@ public:
   const T& at(Index idx) const;
   /// Access element with boundary check.
   T& at(Index idx);
+  /// Read-only access to the underlying linear storage.
+  const T* data() const { return m_data.data(); }
+  /// Access the underlying linear storage.
+  T* data() { return m_data.data(); }
+  /// Compute the index into the linear storage.
+  constexpr std::size_t linear(Index idx) const;
+  /// Add to the element at the given linear index without boundary check.
+  void add(std::size_t linear, const T& value) { m_data[linear] += value; }
+  /// Add all elements of an array with identical size.
+  NArray& operator+=(const NArray& other);
+  /// Return a dense array with the same content, i.e. a copy.
+  const NArray& dense() const { return *this; }
 
 private:
+  constexpr bool within_bounds(Index idx) const;
+
+  Index m_size;
+  std::vector<T, CacheLineAllocator<T>> m_data;
+};
+
+/// A sparse n-dimensional array that only stores touched elements.
+///
+/// Has the same interface as `NArray` and can be converted into it. Elements
+/// are stored in an open-addressing hash table keyed by the linear index.
+/// Elements are created on first non-const access and are never removed.
+template<typename T, std::size_t NDimensions>
+class SparseNArray {
+public:
+  using Index = std::array<std::size_t, NDimensions>;
+
+  /// Construct an empty array with given size along each dimension.
+  ///
+  /// \param value Value of all elements that have not been accessed yet
+  SparseNArray(Index size, const T& value = T());
+  SparseNArray(const SparseNArray&) = default;
+  SparseNArray(SparseNArray&&) = default;
+  SparseNArray& operator=(const SparseNArray&) = default;
+  SparseNArray& operator=(SparseNArray&&) = default;
+  ~SparseNArray() = default;
+
+  /// Size along all dimensions.
+  constexpr const Index& size() const { return m_size; }
+  /// Number of elements that are actually stored.
+  std::size_t num_stored() const { return m_num_stored; }
+  /// Read-only access element without boundary check.
+  const T& operator[](Index idx) const { return find(linear(idx)); }
+  /// Access element without boundary check. Stores it if necessary.
+  T& operator[](Index idx) { return insert(linear(idx)); }
+  /// Read-only access element with boundary check.
+  const T& at(Index idx) const;
+  /// Access element with boundary check. Stores it if necessary.
+  T& at(Index idx);
+  /// Compute the linear index, see `NArray::linear`.
   constexpr std::size_t linear(Index idx) const;
+  /// Add to the element at the given linear index without boundary check.
+  void add(std::size_t linear, const T& value) { insert(linear) += value; }
+  /// Add all elements of an array with identical size.
+  SparseNArray& operator+=(const SparseNArray& other);
+  /// Convert to a dense array with the same content.
+  NArray<T, NDimensions> dense() const;
+
+private:
+  // marks an empty slot. never a valid linear index since the sparse array
+  // would need to cover the full address space to reach it.
+  static constexpr std::size_t kEmpty = SIZE_MAX;
+
   constexpr bool within_bounds(Index idx) const;
+  std::size_t slot(std::size_t linear) const;
+  const T& find(std::size_t linear) const;
+  T& insert(std::size_t linear);
+  void grow();
 
   Index m_size;
-  std::vector<T> m_data;
+  T m_value;
+  std::size_t m_num_stored;
+  std::vector<std::size_t> m_keys;
+  std::vector<T> m_values;
+};
+
+/// Product of all values, e.g. the total number of elements.
+constexpr std::size_t
+product(std::initializer_list<std::size_t> values)
+{
+  std::size_t result = 1;
+  for (auto value : values) { result *= value; }
+  return result;
+}
+
+/// A n-dimensional array with the size fixed at compile time.
+///
+/// Has the same interface as `NArray` but stores all elements directly
+/// without additional allocations. The size given at construction must match
+/// the fixed size.
+template<typename T, std::size_t... Sizes>
+class FixedNArray {
+public:
+  using Index = std::array<std::size_t, sizeof...(Sizes)>;
+
+  /// Construct array w/ all elements set to the given value.
+  FixedNArray(Index size, const T& value = T());
+
+  /// Size along all dimensions.
+  constexpr const Index& size() const { return kSize; }
+  /// Read-only access element without boundary check.
+  constexpr const T& operator[](Index idx) const { return m_data[linear(idx)]; }
+  /// Access element without boundary check.
+  T& operator[](Index idx) { return m_data[linear(idx)]; }
+  /// Read-only access element with boundary check.
+  const T& at(Index idx) const;
+  /// Access element with boundary check.
+  T& at(Index idx);
+  /// Read-only access to the underlying linear storage.
+  const T* data() const { return m_data.data(); }
+  /// Access the underlying linear storage.
+  T* data() { return m_data.data(); }
+  /// Compute the linear index, see `NArray::linear`.
+  static constexpr std::size_t linear(Index idx);
+  /// Add to the element at the given linear index without boundary check.
+  void add(std::size_t linear, const T& value) { m_data[linear] += value; }
+  /// Add all elements of another array.
+  FixedNArray& operator+=(const FixedNArray& other);
+  /// Convert to a dense array with runtime size and the same content.
+  NArray<T, sizeof...(Sizes)> dense() const;
+
+private:
+  static constexpr Index kSize = {{Sizes...}};
+
+  static constexpr bool within_bounds(Index idx);
+
+  std::array<T, product({Sizes...})> m_data;
+};
+
+/// Fixed-size storage for the given sizes usable in `BasicHistogram`.
+template<std::size_t... Sizes>
+struct FixedStorage {
+  template<typename T, std::size_t NDimensions>
+  using Array = FixedNArray<T, Sizes...>;
+};
+
+/// Floating point type used to compute bin indices on uniform axes.
+template<typename T>
+using Scale =
+  std::conditional_t<std::is_floating_point<T>::value, T, double>;
+
+/// Number of entries that are processed at once by batch operations.
+constexpr std::size_t kBlockSize = 256;
+
+/// Upper bound search on sorted bin edges.
+///
+/// The edges are stored in the Eytzinger, i.e. breadth-first binary tree,
+/// layout. Each search step only selects the next child node without
+/// branching and the first levels of the tree share the same cache lines.
+template<typename T>
+class EdgeSearch {
+public:
+  /// \param edges Sorted bin edges
+  explicit EdgeSearch(const std::vector<T>& edges);
+
+  /// Return the number of edges that are smaller or equal to the value.
+  ///
+  /// Identical to the position found by `std::upper_bound`.
+  std::size_t upper_bound(T value) const;
+
+private:
+  void build(const std::vector<T>& edges, std::size_t& i, std::size_t k);
+
+  // tree nodes in 1-based breadth-first order; first node is unused
+  std::vector<T> m_nodes;
+  // sorted position of the edge in each node; first entry for no node
+  std::vector<std::size_t> m_positions;
 };
 
 } // namespace
@@ -92,13 +298,22 @@ public:
 
   /// Total number of bins along this axis including under/overflow bins.
   constexpr std::size_t nbins() const { return m_nbins; }
+  /// Bin edges of all bins.
+  std::vector<T> edges() const;
   /// Compute bin number for a test value.
   std::size_t index(T value) const;
+  /// Compute bin numbers for multiple test values.
+  ///
+  /// \returns Number of leading values that are within the axis range
+  ///
+  /// Computation stops at the first value outside the axis range.
+  std::size_t index(const T* values, std::size_t n, std::size_t* idx) const;
 
 private:
   std::size_t m_nbins;
   T m_lower;
   T m_upper;
+  histogram_impl::Scale<T> m_scale;
 };
 
 /// Uniform binning with under/overflow bins.
@@ -116,13 +331,80 @@ public:
 
   /// Total number of bins along this axis including under/overflow bins.
   constexpr std::size_t nbins() const { return 2 + m_ndatabins; }
+  /// Bin edges of the data bins. Excludes the implicit infinite edges.
+  std::vector<T> edges() const;
   /// Compute bin number for a test value.
+  ///
+  /// NaN values are sorted into the overflow bin.
   constexpr std::size_t index(T value) const;
+  /// Compute bin numbers for multiple test values.
+  ///
+  /// \returns Number of values, i.e. n, since all values are always valid.
+  std::size_t index(const T* values, std::size_t n, std::size_t* idx) const;
 
 private:
   std::size_t m_ndatabins;
   T m_lower;
   T m_upper;
+  histogram_impl::Scale<T> m_scale;
+};
+
+/// Uniform binning without under/overflow bins and a fixed number of bins.
+///
+/// Can be used in constant expressions and allows `StaticHistogram` to
+/// compute the storage layout at compile time.
+template<typename T, std::size_t NBins>
+class StaticUniformAxis {
+public:
+  using Value = T;
+
+  /// \param lower Lower inclusive boundary
+  /// \param upper Upper exclusive boundary
+  constexpr StaticUniformAxis(T lower, T upper);
+
+  /// Total number of bins along this axis including under/overflow bins.
+  static constexpr std::size_t nbins() { return NBins; }
+  /// Bin edges of all bins.
+  std::vector<T> edges() const;
+  /// Compute bin number for a test value.
+  std::size_t index(T value) const;
+  /// Compute bin numbers for multiple test values, see `UniformAxis`.
+  std::size_t index(const T* values, std::size_t n, std::size_t* idx) const;
+
+private:
+  T m_lower;
+  T m_upper;
+  histogram_impl::Scale<T> m_scale;
+};
+
+/// Uniform binning with under/overflow bins and a fixed number of data bins.
+///
+/// The first and last bin index correspond to the under/overflow bin. Can be
+/// used in constant expressions.
+template<typename T, std::size_t NDataBins>
+class StaticOverflowAxis {
+public:
+  using Value = T;
+
+  /// \param lower Lower inclusive boundary
+  /// \param upper Upper exclusive boundary
+  constexpr StaticOverflowAxis(T lower, T upper);
+
+  /// Total number of bins along this axis including under/overflow bins.
+  static constexpr std::size_t nbins() { return 2 + NDataBins; }
+  /// Bin edges of the data bins. Excludes the implicit infinite edges.
+  std::vector<T> edges() const;
+  /// Compute bin number for a test value.
+  ///
+  /// NaN values are sorted into the overflow bin.
+  constexpr std::size_t index(T value) const;
+  /// Compute bin numbers for multiple test values, see `OverflowAxis`.
+  std::size_t index(const T* values, std::size_t n, std::size_t* idx) const;
+
+private:
+  T m_lower;
+  T m_upper;
+  histogram_impl::Scale<T> m_scale;
 };
 
 /// Variable binninng defined by arbitrary bin edges.
@@ -138,29 +420,96 @@ public:
 
   /// Total number of bins along this axis including under/overflow bins.
   constexpr std::size_t nbins() const { return m_edges.size() - 1; }
+  /// Bin edges of all bins.
+  const std::vector<T>& edges() const { return m_edges; }
   /// Compute bin number for a test value.
   std::size_t index(T value) const;
+  /// Compute bin numbers for multiple test values.
+  ///
+  /// \returns Number of leading values that are within the axis range
+  ///
+  /// Computation stops at the first value outside the axis range.
+  std::size_t index(const T* values, std::size_t n, std::size_t* idx) const;
 
 private:
   std::vector<T> m_edges;
+  histogram_impl::EdgeSearch<T> m_search;
 };
 
-/// A generic histogram with configurable axes.
+/// Variable binninng with additional under/overflow bins.
 ///
-/// \tparam T    The type of the data stored per bin
-/// \tparam Axes Types must provide `::Value`, `.nbins()` and `.index(...)`
+/// The first and last bin index correspond to the under/overflow bin.
+template<typename T>
+class OverflowVariableAxis {
+public:
+  using Value = T;
+
+  /// \param edges Bin edges, lower ones inclusive, upper ones exclusive.
+  explicit OverflowVariableAxis(std::vector<T>&& edges);
+  /// \param edges Bin edges, lower ones inclusive, upper ones exclusive.
+  OverflowVariableAxis(std::initializer_list<T> edges);
+
+  /// Total number of bins along this axis including under/overflow bins.
+  constexpr std::size_t nbins() const { return m_edges.size() + 1; }
+  /// Bin edges of the data bins. Excludes the implicit infinite edges.
+  const std::vector<T>& edges() const { return m_edges; }
+  /// Compute bin number for a test value.
+  ///
+  /// NaN values are sorted into the overflow bin.
+  std::size_t index(T value) const { return m_search.upper_bound(value); }
+  /// Compute bin numbers for multiple test values.
+  ///
+  /// \returns Number of values, i.e. n, since all values are always valid.
+  std::size_t index(const T* values, std::size_t n, std::size_t* idx) const;
+
+private:
+  std::vector<T> m_edges;
+  histogram_impl::EdgeSearch<T> m_search;
+};
+
 template<typename T, typename... Axes>
-class Histogram {
+class ConcurrentHistogram;
+template<typename T, typename... Axes>
+class AtomicHistogram;
+
+/// A generic histogram with configurable axes and bin storage.
+///
+/// \tparam T       The type of the data stored per bin
+/// \tparam Storage N-dimensional array template, e.g. `NArray`
+/// \tparam Axes    Types must provide `::Value`, `.nbins()` and `.index(...)`
+///
+/// Batch filling additionally requires axes to provide the batch
+/// `.index(values, n, idx)` function.
+template<
+  typename T, template<typename, std::size_t> class Storage,
+  typename... Axes>
+class BasicHistogram {
 public:
-  using Data = dfe::histogram_impl::NArray<T, sizeof...(Axes)>;
+  using Data = Storage<T, sizeof...(Axes)>;
   using Index = typename Data::Index;
+  using Dense = BasicHistogram<T, histogram_impl::NArray, Axes...>;
 
-  Histogram(Axes&&... axes);
+  BasicHistogram(Axes&&... axes);
 
   /// Get the number of bins along all axes.
   constexpr const Index& size() const { return m_data.size(); }
   /// Get the current entry value in the given bin.
   const T& value(Index idx) const { return m_data.at(idx); }
+  /// Access the entry values of all bins as contiguous, column-major array.
+  ///
+  /// Only available for dense storage. Includes under/overflow bins.
+  const T* data() const { return m_data.data(); }
+  /// Access the axis with the given number.
+  template<std::size_t I>
+  constexpr const std::tuple_element_t<I, std::tuple<Axes...>>& axis() const
+  {
+    return std::get<I>(m_axes);
+  }
+  /// Compute the bin index for the given values.
+  constexpr Index index(typename Axes::Value... values) const
+  {
+    return index(std::index_sequence_for<Axes...>(), values...);
+  }
   /// Fill an entry into the histogram.
   ///
   /// \param values
@@ -170,6 +519,28 @@ public:
     // TODO 2018-11-28 how to typedef parameter pack Axes::Value...?
     m_data[index(std::index_sequence_for<Axes...>(), values...)] += weight;
   }
+  /// Fill multiple entries into the histogram.
+  ///
+  /// \param n       Number of entries
+  /// \param values  One array with n values for each axis
+  /// \param weights Optional array with n weights; counts entries if empty
+  ///
+  /// The result is identical to filling each entry separately. If a value is
+  /// outside the range of an axis without under/overflow bins, all previous
+  /// entries are filled before the exception is thrown.
+  void fill_n(
+    std::size_t n, const typename Axes::Value*... values,
+    const T* weights = nullptr)
+  {
+    fill_n_impl(std::index_sequence_for<Axes...>(), n, values..., weights);
+  }
+  /// Add the entries of another histogram with identical binning.
+  BasicHistogram& operator+=(const BasicHistogram& other);
+  /// Convert into a histogram with dense storage, e.g. for output.
+  Dense dense() const
+  {
+    return dense(std::index_sequence_for<Axes...>());
+  }
 
 private:
   template<std::size_t... Is>
@@ -178,9 +549,139 @@ private:
   {
     return Index{std::get<Is>(m_axes).index(values)...};
   }
+  template<std::size_t... Is>
+  void fill_n_impl(
+    std::index_sequence<Is...>, std::size_t n,
+    const typename Axes::Value*... values, const T* weights);
+  template<std::size_t... Is>
+  Dense dense(std::index_sequence<Is...>) const;
 
   Data m_data;
   std::tuple<Axes...> m_axes;
+
+  template<typename, template<typename, std::size_t> class, typename...>
+  friend class BasicHistogram;
+  friend class ConcurrentHistogram<T, Axes...>;
+  friend class AtomicHistogram<T, Axes...>;
+};
+
+/// A histogram with dense storage for all bins.
+template<typename T, typename... Axes>
+using Histogram = BasicHistogram<T, histogram_impl::NArray, Axes...>;
+/// A histogram that only stores memory for touched bins.
+///
+/// Well-suited for high-dimensional histograms with mostly empty bins.
+template<typename T, typename... Axes>
+using SparseHistogram =
+  BasicHistogram<T, histogram_impl::SparseNArray, Axes...>;
+/// A histogram with storage and strides fixed at compile time.
+///
+/// Requires axes with a static `nbins()`, e.g. `StaticOverflowAxis`. All bins
+/// are stored directly within the histogram w/o additional allocations.
+template<typename T, typename... Axes>
+using StaticHistogram = BasicHistogram<
+  T, histogram_impl::FixedStorage<Axes::nbins()...>::template Array, Axes...>;
+
+/// A histogram that can be filled from multiple threads w/o locking.
+///
+/// Each thread fills its own private copy of the histogram, i.e. a shard,
+/// that is created on first use by the thread. Filling does not require
+/// locks or atomic operations. The shards are only combined into a regular
+/// histogram by `snapshot()` or `merge()`, which must not be called while
+/// other threads are still filling.
+template<typename T, typename... Axes>
+class ConcurrentHistogram {
+public:
+  using Histogram = dfe::Histogram<T, Axes...>;
+  using Index = typename Histogram::Index;
+
+  ConcurrentHistogram(Axes&&... axes);
+  ConcurrentHistogram(const ConcurrentHistogram&) = delete;
+  ConcurrentHistogram(ConcurrentHistogram&&) = delete;
+  ConcurrentHistogram& operator=(const ConcurrentHistogram&) = delete;
+  ConcurrentHistogram& operator=(ConcurrentHistogram&&) = delete;
+  ~ConcurrentHistogram() = default;
+
+  /// Get the number of bins along all axes.
+  constexpr const Index& size() const { return m_prototype.size(); }
+  /// Access the shard of the calling thread.
+  ///
+  /// The shard is valid for the lifetime of the concurrent histogram. Filling
+  /// the returned shard directly avoids the per-call shard lookup.
+  Histogram& local();
+  /// Fill an entry into the shard of the calling thread.
+  void fill(typename Axes::Value... values, T weight = static_cast<T>(1))
+  {
+    local().fill(values..., weight);
+  }
+  /// Fill multiple entries into the shard of the calling thread.
+  void fill_n(
+    std::size_t n, const typename Axes::Value*... values,
+    const T* weights = nullptr)
+  {
+    local().fill_n(n, values..., weights);
+  }
+
+  /// Return the number of shards, i.e. the number of filling threads.
+  std::size_t num_shards() const;
+  /// Combine all shards into a regular histogram.
+  Histogram snapshot() const;
+  /// Combine all shards into a regular histogram and reset the shards.
+  Histogram merge();
+
+private:
+  // the dense bin storage of each shard is aligned to and padded to full
+  // cache lines, i.e. bins of different shards never share a cache line.
+  struct Shard {
+    Histogram histogram;
+    std::thread::id owner;
+  };
+
+  Histogram m_prototype;
+  std::uint64_t m_id;
+  mutable std::mutex m_mutex;
+  std::vector<std::unique_ptr<Shard>> m_shards;
+};
+
+/// A histogram with atomic bins that can be filled from multiple threads.
+///
+/// All threads fill the same bins using atomic operations. Compared to the
+/// sharded `ConcurrentHistogram`, this uses less memory and is well-suited
+/// for large, sparsely filled histograms with little contention.
+template<typename T, typename... Axes>
+class AtomicHistogram {
+public:
+  using Histogram = dfe::Histogram<T, Axes...>;
+  using Index = typename Histogram::Index;
+
+  AtomicHistogram(Axes&&... axes);
+
+  /// Get the number of bins along all axes.
+  constexpr const Index& size() const { return m_size; }
+  /// Get the current entry value in the given bin.
+  T value(Index idx) const;
+  /// Fill an entry into the histogram. Can be called concurrently.
+  void fill(typename Axes::Value... values, T weight = static_cast<T>(1));
+  /// Copy the current content into a regular histogram.
+  ///
+  /// Concurrent fills might or might not be part of the copy.
+  Histogram snapshot() const;
+
+private:
+  template<std::size_t... Is>
+  Index index(std::index_sequence<Is...>, typename Axes::Value... values) const
+  {
+    return Index{std::get<Is>(m_axes).index(values)...};
+  }
+  template<std::size_t... Is>
+  Histogram snapshot(std::index_sequence<Is...>) const;
+  std::size_t linear(Index idx) const;
+
+  // only the binning is kept; regular histograms are created on demand
+  Index m_size;
+  std::tuple<Axes...> m_axes;
+  std::size_t m_nbins;
+  std::unique_ptr<std::atomic<T>[]> m_bins;
 };
 
 // predefined histogram types
@@ -189,6 +690,37 @@ using Histogram1 = Histogram<double, OverflowAxis<double>>;
 using Histogram2 =
   Histogram<double, OverflowAxis<double>, OverflowAxis<double>>;
 
+// implementation CacheLineAllocator
+
+template<typename T>
+constexpr std::size_t histogram_impl::CacheLineAllocator<T>::kLineSize;
+
+template<typename T>
+inline T*
+histogram_impl::CacheLineAllocator<T>::allocate(std::size_t n)
+{
+  static_assert(alignof(T) <= kLineSize, "Alignment is larger than a line");
+
+  if (((SIZE_MAX - 2 * kLineSize) / sizeof(T)) < n) { throw std::bad_alloc(); }
+  // round up to full lines and add one line to align the start
+  std::size_t size = ((n * sizeof(T) + kLineSize - 1) / kLineSize) * kLineSize;
+  auto* raw = static_cast<unsigned char*>(::operator new(size + kLineSize));
+  // the offset is between 1 and the line size and is stored directly in front
+  // of the aligned storage to recover the original pointer.
+  auto offset = kLineSize - (reinterpret_cast<std::uintptr_t>(raw) % kLineSize);
+  unsigned char* aligned = raw + offset;
+  aligned[-1] = static_cast<unsigned char>(offset);
+  return reinterpret_cast<T*>(aligned);
+}
+
+template<typename T>
+inline void
+histogram_impl::CacheLineAllocator<T>::deallocate(T* ptr, std::size_t) noexcept
+{
+  auto* aligned = reinterpret_cast<unsigned char*>(ptr);
+  ::operator delete(aligned - aligned[-1]);
+}
+
 // implementation NArray
 
 template<typename T, std::size_t NDimensions>
@@ -247,67 +779,535 @@ histogram_impl::NArray<T, NDimensions>::at(Index idx)
   return m_data[linear(idx)];
 }
 
-// implementation UniformAxis
-
-template<typename T>
-inline UniformAxis<T>::UniformAxis(T lower, T upper, std::size_t nbins)
-  : m_nbins(nbins)
-  , m_lower(lower)
-  , m_upper(upper)
-{
-}
-
-template<typename T>
-inline std::size_t
-UniformAxis<T>::index(T value) const
+template<typename T, std::size_t NDimensions>
+inline histogram_impl::NArray<T, NDimensions>&
+histogram_impl::NArray<T, NDimensions>::operator+=(const NArray& other)
 {
-  if (value < this->m_lower) {
-    throw std::out_of_range("Value is smaller than lower axis limit");
+  if (m_size != other.m_size) {
+    throw std::invalid_argument("NArray sizes are inconsistent");
   }
-  if (m_upper <= value) {
-    throw std::out_of_range("Value is equal or larger than upper axis limit");
+  for (std::size_t i = 0; i < m_data.size(); ++i) {
+    m_data[i] += other.m_data[i];
   }
-  // cast truncates to integer part; should work since index is always > 0.
-  return static_cast<std::size_t>(
-    m_nbins * (value - m_lower) / (m_upper - m_lower));
+  return *this;
 }
 
-// implementation OverflowAxis
+// implementation SparseNArray
 
-template<typename T>
-inline OverflowAxis<T>::OverflowAxis(
-  Value lower, Value upper, std::size_t nbins)
-  : m_ndatabins(nbins)
-  , m_lower(lower)
-  , m_upper(upper)
+template<typename T, std::size_t NDimensions>
+constexpr std::size_t histogram_impl::SparseNArray<T, NDimensions>::kEmpty;
+
+template<typename T, std::size_t NDimensions>
+inline histogram_impl::SparseNArray<T, NDimensions>::SparseNArray(
+  Index size, const T& value)
+  : m_size(size)
+  , m_value(value)
+  , m_num_stored(0)
+  , m_keys(16, kEmpty)
+  , m_values(16, value)
 {
 }
 
-template<typename T>
+template<typename T, std::size_t NDimensions>
 constexpr std::size_t
-OverflowAxis<T>::index(T value) const
+histogram_impl::SparseNArray<T, NDimensions>::linear(Index idx) const
 {
-  if (value < m_lower) { return 0; }
-  if (m_upper <= value) { return m_ndatabins + 1; }
-  // cast truncates to integer part; should work since index is always > 0.
-  return 1 + static_cast<std::size_t>(
-               m_ndatabins * (value - m_lower) / (m_upper - m_lower));
+  std::size_t result = 0;
+  std::size_t step = 1;
+  for (std::size_t i = 0; i < NDimensions; ++i) {
+    result += step * idx[i];
+    step *= m_size[i];
+  }
+  return result;
 }
 
-// implementation VariableAxis
-
-template<typename T>
-inline VariableAxis<T>::VariableAxis(std::vector<Value>&& edges)
-  : m_edges(std::move(edges))
+template<typename T, std::size_t NDimensions>
+constexpr bool
+histogram_impl::SparseNArray<T, NDimensions>::within_bounds(Index idx) const
 {
-  if (m_edges.size() < 2) {
-    throw std::invalid_argument("Less than two bin edges");
-  }
+  for (std::size_t i = 0; i < NDimensions; ++i) {
+    if (m_size[i] <= idx[i]) { return false; }
+  }
+  return true;
+}
+
+// find the slot that contains the linear index or the empty slot to store it
+template<typename T, std::size_t NDimensions>
+inline std::size_t
+histogram_impl::SparseNArray<T, NDimensions>::slot(std::size_t linear) const
+{
+  // capacity is always a power of two
+  std::size_t mask = m_keys.size() - 1;
+  // fibonacci hashing spreads neighboring bins across the table
+  std::size_t i = static_cast<std::size_t>(
+                    (UINT64_C(11400714819323198485) * linear) >> 32) &
+                  mask;
+  // linear probing; terminates since the table is never full
+  while ((m_keys[i] != linear) and (m_keys[i] != kEmpty)) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+template<typename T, std::size_t NDimensions>
+inline const T&
+histogram_impl::SparseNArray<T, NDimensions>::find(std::size_t linear) const
+{
+  std::size_t i = slot(linear);
+  return (m_keys[i] == kEmpty) ? m_value : m_values[i];
+}
+
+template<typename T, std::size_t NDimensions>
+inline T&
+histogram_impl::SparseNArray<T, NDimensions>::insert(std::size_t linear)
+{
+  std::size_t i = slot(linear);
+  if (m_keys[i] == kEmpty) {
+    // keep the load factor below 1/2 for short probe sequences
+    if (m_keys.size() <= 2 * (m_num_stored + 1)) {
+      grow();
+      i = slot(linear);
+    }
+    m_keys[i] = linear;
+    m_num_stored += 1;
+  }
+  return m_values[i];
+}
+
+template<typename T, std::size_t NDimensions>
+inline void
+histogram_impl::SparseNArray<T, NDimensions>::grow()
+{
+  std::vector<std::size_t> keys(2 * m_keys.size(), kEmpty);
+  std::vector<T> values(2 * m_values.size(), m_value);
+  std::swap(keys, m_keys);
+  std::swap(values, m_values);
+  for (std::size_t j = 0; j < keys.size(); ++j) {
+    if (keys[j] == kEmpty) { continue; }
+    std::size_t i = slot(keys[j]);
+    m_keys[i] = keys[j];
+    m_values[i] = std::move(values[j]);
+  }
+}
+
+template<typename T, std::size_t NDimensions>
+inline const T&
+histogram_impl::SparseNArray<T, NDimensions>::at(Index idx) const
+{
+  if (!within_bounds(idx)) {
+    throw std::out_of_range("NArray index is out of valid range");
+  }
+  return find(linear(idx));
+}
+
+template<typename T, std::size_t NDimensions>
+inline T&
+histogram_impl::SparseNArray<T, NDimensions>::at(Index idx)
+{
+  if (!within_bounds(idx)) {
+    throw std::out_of_range("NArray index is out of valid range");
+  }
+  return insert(linear(idx));
+}
+
+template<typename T, std::size_t NDimensions>
+inline histogram_impl::SparseNArray<T, NDimensions>&
+histogram_impl::SparseNArray<T, NDimensions>::operator+=(
+  const SparseNArray& other)
+{
+  if (m_size != other.m_size) {
+    throw std::invalid_argument("NArray sizes are inconsistent");
+  }
+  for (std::size_t i = 0; i < other.m_keys.size(); ++i) {
+    if (other.m_keys[i] == kEmpty) { continue; }
+    insert(other.m_keys[i]) += other.m_values[i];
+  }
+  return *this;
+}
+
+template<typename T, std::size_t NDimensions>
+inline histogram_impl::NArray<T, NDimensions>
+histogram_impl::SparseNArray<T, NDimensions>::dense() const
+{
+  NArray<T, NDimensions> result(m_size, m_value);
+  T* data = result.data();
+  for (std::size_t i = 0; i < m_keys.size(); ++i) {
+    if (m_keys[i] == kEmpty) { continue; }
+    data[m_keys[i]] = m_values[i];
+  }
+  return result;
+}
+
+// implementation FixedNArray
+
+template<typename T, std::size_t... Sizes>
+constexpr typename histogram_impl::FixedNArray<T, Sizes...>::Index
+  histogram_impl::FixedNArray<T, Sizes...>::kSize;
+
+template<typename T, std::size_t... Sizes>
+inline histogram_impl::FixedNArray<T, Sizes...>::FixedNArray(
+  Index size, const T& value)
+{
+  if (size != kSize) {
+    throw std::invalid_argument("NArray size is inconsistent w/ fixed size");
+  }
+  m_data.fill(value);
+}
+
+// w/ the sizes known at compile time, this reduces to multiply-adds.
+template<typename T, std::size_t... Sizes>
+constexpr std::size_t
+histogram_impl::FixedNArray<T, Sizes...>::linear(Index idx)
+{
+  std::size_t result = 0;
+  std::size_t step = 1;
+  for (std::size_t i = 0; i < sizeof...(Sizes); ++i) {
+    result += step * idx[i];
+    step *= kSize[i];
+  }
+  return result;
+}
+
+template<typename T, std::size_t... Sizes>
+constexpr bool
+histogram_impl::FixedNArray<T, Sizes...>::within_bounds(Index idx)
+{
+  for (std::size_t i = 0; i < sizeof...(Sizes); ++i) {
+    if (kSize[i] <= idx[i]) { return false; }
+  }
+  return true;
+}
+
+template<typename T, std::size_t... Sizes>
+inline const T&
+histogram_impl::FixedNArray<T, Sizes...>::at(Index idx) const
+{
+  if (!within_bounds(idx)) {
+    throw std::out_of_range("NArray index is out of valid range");
+  }
+  return m_data[linear(idx)];
+}
+
+template<typename T, std::size_t... Sizes>
+inline T&
+histogram_impl::FixedNArray<T, Sizes...>::at(Index idx)
+{
+  if (!within_bounds(idx)) {
+    throw std::out_of_range("NArray index is out of valid range");
+  }
+  return m_data[linear(idx)];
+}
+
+template<typename T, std::size_t... Sizes>
+inline histogram_impl::FixedNArray<T, Sizes...>&
+histogram_impl::FixedNArray<T, Sizes...>::operator+=(const FixedNArray& other)
+{
+  for (std::size_t i = 0; i < m_data.size(); ++i) {
+    m_data[i] += other.m_data[i];
+  }
+  return *this;
+}
+
+template<typename T, std::size_t... Sizes>
+inline histogram_impl::NArray<T, sizeof...(Sizes)>
+histogram_impl::FixedNArray<T, Sizes...>::dense() const
+{
+  NArray<T, sizeof...(Sizes)> result(kSize);
+  std::copy(m_data.begin(), m_data.end(), result.data());
+  return result;
+}
+
+// implementation uniform binning helpers
+
+namespace histogram_impl {
+namespace {
+
+// Compute the uniform bin index clamped to [0, nbins).
+//
+// Only selects and no branches are used to enable auto-vectorization. Values
+// outside the range, including NaN, are mapped to a valid bin index without
+// undefined behaviour and must be handled separately.
+template<typename T>
+constexpr std::size_t
+clamped_index(T value, T lower, Scale<T> scale, std::size_t nbins)
+{
+  Scale<T> x = (value - lower) * scale;
+  Scale<T> last = static_cast<Scale<T>>(nbins - 1);
+  x = (static_cast<Scale<T>>(0) <= x) ? x : static_cast<Scale<T>>(0);
+  x = (x < last) ? x : last;
+  // cast truncates to integer part; works since x is always >= 0.
+  return static_cast<std::size_t>(x);
+}
+
+// Compute the uniform bin index and throw for values outside the range.
+template<typename T>
+inline std::size_t
+uniform_index(T value, T lower, T upper, Scale<T> scale, std::size_t nbins)
+{
+  if (value < lower) {
+    throw std::out_of_range("Value is smaller than lower axis limit");
+  }
+  if (upper <= value) {
+    throw std::out_of_range("Value is equal or larger than upper axis limit");
+  }
+  return clamped_index(value, lower, scale, nbins);
+}
+
+// Compute uniform bin indices and return the number of leading valid values.
+template<typename T>
+inline std::size_t
+uniform_index(
+  const T* values, std::size_t n, std::size_t* idx, T lower, T upper,
+  Scale<T> scale, std::size_t nbins)
+{
+  for (std::size_t i = 0; i < n; ++i) {
+    idx[i] = clamped_index(values[i], lower, scale, nbins);
+  }
+  // separate loop to keep the index computation free of early exits. uses
+  // exactly the conditions of the scalar version, i.e. NaN is accepted.
+  for (std::size_t i = 0; i < n; ++i) {
+    if ((values[i] < lower) or (upper <= values[i])) { return i; }
+  }
+  return n;
+}
+
+// Compute the uniform bin index w/ additional under/overflow bins.
+template<typename T>
+constexpr std::size_t
+overflow_index(T value, T lower, T upper, Scale<T> scale, std::size_t nbins)
+{
+  std::size_t idx = 1 + clamped_index(value, lower, scale, nbins);
+  idx = (value < lower) ? 0 : idx;
+  // NaN fails all comparisons and ends up in the overflow bin
+  idx = (value < upper) ? idx : (nbins + 1);
+  return idx;
+}
+
+// Compute the edges of uniform bins.
+template<typename T>
+inline std::vector<T>
+uniform_edges(T lower, T upper, Scale<T> scale, std::size_t nbins)
+{
+  std::vector<T> result(nbins + 1);
+  for (std::size_t i = 0; i < nbins; ++i) {
+    result[i] = static_cast<T>(lower + i / scale);
+  }
+  // avoid rounding errors on the upper edge
+  result[nbins] = upper;
+  return result;
+}
+
+} // namespace
+} // namespace histogram_impl
+
+// implementation UniformAxis
+
+template<typename T>
+inline UniformAxis<T>::UniformAxis(T lower, T upper, std::size_t nbins)
+  : m_nbins(nbins)
+  , m_lower(lower)
+  , m_upper(upper)
+  , m_scale(static_cast<histogram_impl::Scale<T>>(nbins) / (upper - lower))
+{
+}
+
+template<typename T>
+inline std::vector<T>
+UniformAxis<T>::edges() const
+{
+  return histogram_impl::uniform_edges(m_lower, m_upper, m_scale, m_nbins);
+}
+
+template<typename T>
+inline std::size_t
+UniformAxis<T>::index(T value) const
+{
+  return histogram_impl::uniform_index(
+    value, m_lower, m_upper, m_scale, m_nbins);
+}
+
+template<typename T>
+inline std::size_t
+UniformAxis<T>::index(const T* values, std::size_t n, std::size_t* idx) const
+{
+  return histogram_impl::uniform_index(
+    values, n, idx, m_lower, m_upper, m_scale, m_nbins);
+}
+
+// implementation OverflowAxis
+
+template<typename T>
+inline OverflowAxis<T>::OverflowAxis(
+  Value lower, Value upper, std::size_t nbins)
+  : m_ndatabins(nbins)
+  , m_lower(lower)
+  , m_upper(upper)
+  , m_scale(static_cast<histogram_impl::Scale<T>>(nbins) / (upper - lower))
+{
+}
+
+template<typename T>
+inline std::vector<T>
+OverflowAxis<T>::edges() const
+{
+  return histogram_impl::uniform_edges(
+    m_lower, m_upper, m_scale, m_ndatabins);
+}
+
+template<typename T>
+constexpr std::size_t
+OverflowAxis<T>::index(T value) const
+{
+  return histogram_impl::overflow_index(
+    value, m_lower, m_upper, m_scale, m_ndatabins);
+}
+
+template<typename T>
+inline std::size_t
+OverflowAxis<T>::index(const T* values, std::size_t n, std::size_t* idx) const
+{
+  for (std::size_t i = 0; i < n; ++i) { idx[i] = index(values[i]); }
+  return n;
+}
+
+// implementation StaticUniformAxis
+
+template<typename T, std::size_t NBins>
+constexpr StaticUniformAxis<T, NBins>::StaticUniformAxis(T lower, T upper)
+  : m_lower(lower)
+  , m_upper(upper)
+  , m_scale(static_cast<histogram_impl::Scale<T>>(NBins) / (upper - lower))
+{
+}
+
+template<typename T, std::size_t NBins>
+inline std::vector<T>
+StaticUniformAxis<T, NBins>::edges() const
+{
+  return histogram_impl::uniform_edges(m_lower, m_upper, m_scale, NBins);
+}
+
+template<typename T, std::size_t NBins>
+inline std::size_t
+StaticUniformAxis<T, NBins>::index(T value) const
+{
+  return histogram_impl::uniform_index(value, m_lower, m_upper, m_scale, NBins);
+}
+
+template<typename T, std::size_t NBins>
+inline std::size_t
+StaticUniformAxis<T, NBins>::index(
+  const T* values, std::size_t n, std::size_t* idx) const
+{
+  return histogram_impl::uniform_index(
+    values, n, idx, m_lower, m_upper, m_scale, NBins);
+}
+
+// implementation StaticOverflowAxis
+
+template<typename T, std::size_t NDataBins>
+constexpr StaticOverflowAxis<T, NDataBins>::StaticOverflowAxis(
+  T lower, T upper)
+  : m_lower(lower)
+  , m_upper(upper)
+  , m_scale(static_cast<histogram_impl::Scale<T>>(NDataBins) / (upper - lower))
+{
+}
+
+template<typename T, std::size_t NDataBins>
+inline std::vector<T>
+StaticOverflowAxis<T, NDataBins>::edges() const
+{
+  return histogram_impl::uniform_edges(m_lower, m_upper, m_scale, NDataBins);
+}
+
+template<typename T, std::size_t NDataBins>
+constexpr std::size_t
+StaticOverflowAxis<T, NDataBins>::index(T value) const
+{
+  return histogram_impl::overflow_index(
+    value, m_lower, m_upper, m_scale, NDataBins);
+}
+
+template<typename T, std::size_t NDataBins>
+inline std::size_t
+StaticOverflowAxis<T, NDataBins>::index(
+  const T* values, std::size_t n, std::size_t* idx) const
+{
+  for (std::size_t i = 0; i < n; ++i) { idx[i] = index(values[i]); }
+  return n;
+}
+
+// implementation EdgeSearch
+
+namespace histogram_impl {
+namespace {
+
+template<typename T>
+inline std::vector<T>&&
+check_edges(std::vector<T>&& edges)
+{
+  if (edges.size() < 2) {
+    throw std::invalid_argument("Less than two bin edges");
+  }
   // edges must be sorted and unique
-  if (!std::is_sorted(
-        m_edges.begin(), m_edges.end(), std::less_equal<Value>())) {
+  if (!std::is_sorted(edges.begin(), edges.end(), std::less_equal<T>())) {
     throw std::invalid_argument("Bin edges are not sorted or have duplicates");
   }
+  return std::move(edges);
+}
+
+template<typename T>
+inline EdgeSearch<T>::EdgeSearch(const std::vector<T>& edges)
+  : m_nodes(edges.size() + 1), m_positions(edges.size() + 1)
+{
+  std::size_t i = 0;
+  build(edges, i, 1);
+  m_nodes[0] = T();
+  m_positions[0] = edges.size();
+}
+
+// fill the subtree at node k w/ an in-order traversal of the sorted edges
+template<typename T>
+inline void
+EdgeSearch<T>::build(const std::vector<T>& edges, std::size_t& i, std::size_t k)
+{
+  if (edges.size() < k) { return; }
+  build(edges, i, 2 * k);
+  m_nodes[k] = edges[i];
+  m_positions[k] = i;
+  i += 1;
+  build(edges, i, 2 * k + 1);
+}
+
+template<typename T>
+inline std::size_t
+EdgeSearch<T>::upper_bound(T value) const
+{
+  const std::size_t n = m_nodes.size() - 1;
+  // descend to the right if the node is not larger than the value. uses the
+  // same comparison as std::upper_bound, i.e. NaN is larger than all edges.
+  std::size_t k = 1;
+  while (k <= n) {
+    k = 2 * k + static_cast<std::size_t>(not(value < m_nodes[k]));
+  }
+  // the result is the last node where the search descended to the left.
+  // remove the trailing right descents and the final left descent. results in
+  // k = 0 if there is no such node, i.e. all edges are smaller or equal.
+  while (k & 1u) { k >>= 1; }
+  k >>= 1;
+  return m_positions[k];
+}
+
+} // namespace
+} // namespace histogram_impl
+
+// implementation VariableAxis
+
+template<typename T>
+inline VariableAxis<T>::VariableAxis(std::vector<Value>&& edges)
+  : m_edges(histogram_impl::check_edges(std::move(edges))), m_search(m_edges)
+{
 }
 
 template<typename T>
@@ -321,24 +1321,366 @@ inline std::size_t
 VariableAxis<T>::index(T value) const
 {
   // find upper edge of the corresponding bin
-  auto it = std::upper_bound(m_edges.begin(), m_edges.end(), value);
-  if (it == m_edges.begin()) {
+  std::size_t upper = m_search.upper_bound(value);
+  if (upper == 0) {
     throw std::out_of_range("Value is smaller than lower axis limit");
   }
-  if (it == m_edges.end()) {
+  if (upper == m_edges.size()) {
     throw std::out_of_range("Value is equal or larger than upper axis limit");
   }
-  return std::distance(m_edges.begin(), it) - 1;
+  return upper - 1;
+}
+
+template<typename T>
+inline std::size_t
+VariableAxis<T>::index(const T* values, std::size_t n, std::size_t* idx) const
+{
+  // independent searches w/o early exits can overlap their memory accesses
+  for (std::size_t i = 0; i < n; ++i) {
+    // wraps around for values below the lower edge
+    idx[i] = m_search.upper_bound(values[i]) - 1;
+  }
+  for (std::size_t i = 0; i < n; ++i) {
+    if (nbins() <= idx[i]) { return i; }
+  }
+  return n;
+}
+
+// implementation OverflowVariableAxis
+
+template<typename T>
+inline OverflowVariableAxis<T>::OverflowVariableAxis(std::vector<Value>&& edges)
+  : m_edges(histogram_impl::check_edges(std::move(edges))), m_search(m_edges)
+{
+}
+
+template<typename T>
+inline OverflowVariableAxis<T>::OverflowVariableAxis(
+  std::initializer_list<Value> edges)
+  : OverflowVariableAxis(std::vector<Value>(edges))
+{
+}
+
+template<typename T>
+inline std::size_t
+OverflowVariableAxis<T>::index(
+  const T* values, std::size_t n, std::size_t* idx) const
+{
+  for (std::size_t i = 0; i < n; ++i) {
+    idx[i] = m_search.upper_bound(values[i]);
+  }
+  return n;
 }
 
 // implementation Histogram
 
-template<typename T, typename... Axes>
-inline Histogram<T, Axes...>::Histogram(Axes&&... axes)
+namespace histogram_impl {
+namespace {
+
+// Add the axis bin indices w/ the given stride to the linear indices.
+//
+// Returns the number of leading values that are within the axis range.
+template<typename Axis>
+inline std::size_t
+add_index(
+  const Axis& axis, const typename Axis::Value* values, std::size_t n,
+  std::size_t stride, std::size_t* idx, std::size_t* linear)
+{
+  std::size_t num_valid = axis.index(values, n, idx);
+  for (std::size_t i = 0; i < num_valid; ++i) { linear[i] += stride * idx[i]; }
+  return num_valid;
+}
+
+} // namespace
+} // namespace histogram_impl
+
+template<
+  typename T, template<typename, std::size_t> class Storage,
+  typename... Axes>
+inline BasicHistogram<T, Storage, Axes...>::BasicHistogram(Axes&&... axes)
   // access nbins *before* moving the axes, otherwise the axes are invalid.
   : m_data(Index{axes.nbins()...}, static_cast<T>(0))
   , m_axes(std::move(axes)...)
 {
 }
 
+template<
+  typename T, template<typename, std::size_t> class Storage,
+  typename... Axes>
+template<std::size_t... Is>
+inline void
+BasicHistogram<T, Storage, Axes...>::fill_n_impl(
+  std::index_sequence<Is...>, std::size_t n,
+  const typename Axes::Value*... values, const T* weights)
+{
+  using histogram_impl::kBlockSize;
+
+  // per-axis bin indices and the combined linear index for one block
+  std::array<std::size_t, kBlockSize> idx;
+  std::array<std::size_t, kBlockSize> linear;
+  // linear storage is column-major, see NArray::linear
+  Index strides;
+  std::size_t step = 1;
+  for (std::size_t i = 0; i < sizeof...(Axes); ++i) {
+    strides[i] = step;
+    step *= m_data.size()[i];
+  }
+
+  for (std::size_t offset = 0; offset < n; offset += kBlockSize) {
+    std::size_t m = std::min(kBlockSize, n - offset);
+    std::size_t first = 0;
+    while (first < m) {
+      std::size_t pos = offset + first;
+      std::size_t num_valid = m - first;
+      linear.fill(0);
+      // see namedtuple_impl::print_tuple for explanation
+      (void)(int[]){
+        0, (num_valid = histogram_impl::add_index(
+              std::get<Is>(m_axes), values + pos, num_valid, strides[Is],
+              idx.data(), linear.data()),
+            0)...};
+      // scatter into the bins
+      if (weights) {
+        for (std::size_t i = 0; i < num_valid; ++i) {
+          m_data.add(linear[i], weights[pos + i]);
+        }
+      } else {
+        for (std::size_t i = 0; i < num_valid; ++i) {
+          m_data.add(linear[i], static_cast<T>(1));
+        }
+      }
+      first += num_valid;
+      if (first == m) { break; }
+      // scalar index computation throws the appropriate exception. an entry
+      // that it accepts is filled individually and the block continues.
+      pos = offset + first;
+      m_data[index(std::index_sequence_for<Axes...>(), values[pos]...)] +=
+        weights ? weights[pos] : static_cast<T>(1);
+      first += 1;
+    }
+  }
+}
+
+template<
+  typename T, template<typename, std::size_t> class Storage,
+  typename... Axes>
+inline BasicHistogram<T, Storage, Axes...>&
+BasicHistogram<T, Storage, Axes...>::operator+=(const BasicHistogram& other)
+{
+  if (size() != other.size()) {
+    throw std::invalid_argument("Histograms have inconsistent sizes");
+  }
+  m_data += other.m_data;
+  return *this;
+}
+
+template<
+  typename T, template<typename, std::size_t> class Storage,
+  typename... Axes>
+template<std::size_t... Is>
+inline typename BasicHistogram<T, Storage, Axes...>::Dense
+BasicHistogram<T, Storage, Axes...>::dense(std::index_sequence<Is...>) const
+{
+  Dense result{Axes(std::get<Is>(m_axes))...};
+  result.m_data = m_data.dense();
+  return result;
+}
+
+// implementation ConcurrentHistogram
+
+namespace histogram_impl {
+
+// Unique identifier, e.g. to identify concurrent histograms across threads.
+//
+// Not in the anonymous namespace so all translation units share the counter.
+inline std::uint64_t
+next_unique_id()
+{
+  static std::atomic<std::uint64_t> s_id(0);
+  return ++s_id;
+}
+
+} // namespace histogram_impl
+
+template<typename T, typename... Axes>
+inline ConcurrentHistogram<T, Axes...>::ConcurrentHistogram(Axes&&... axes)
+  : m_prototype(std::move(axes)...)
+  , m_id(histogram_impl::next_unique_id())
+{
+}
+
+template<typename T, typename... Axes>
+inline typename ConcurrentHistogram<T, Axes...>::Histogram&
+ConcurrentHistogram<T, Axes...>::local()
+{
+  // each thread caches its shards of all instances it has filled, so the
+  // lock is only needed on first use. the unique id ensures that an entry is
+  // never used for a different instance, even if it reuses the memory of a
+  // destroyed one. entries of destroyed instances are kept until the thread
+  // exits but are never accessed again.
+  struct Entry {
+    std::uint64_t id;
+    Histogram* shard;
+  };
+  // recently used instances are checked first w/o hashing. trivial types
+  // avoid the thread-local initialization check on the fast path.
+  static constexpr std::size_t kNumRecent = 4;
+  static thread_local Entry s_recent[kNumRecent];
+  static thread_local std::size_t s_next;
+  static thread_local std::unordered_map<std::uint64_t, Histogram*> s_shards;
+
+  for (const auto& entry : s_recent) {
+    if (entry.id == m_id) { return *entry.shard; }
+  }
+  Histogram* shard = nullptr;
+  auto cached = s_shards.find(m_id);
+  if (cached != s_shards.end()) {
+    shard = cached->second;
+  } else {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto owner = std::this_thread::get_id();
+    auto it = std::find_if(
+      m_shards.begin(), m_shards.end(),
+      [=](const std::unique_ptr<Shard>& s) { return s->owner == owner; });
+    if (it == m_shards.end()) {
+      m_shards.emplace_back(new Shard{m_prototype, owner});
+      it = std::prev(m_shards.end());
+    }
+    shard = &(*it)->histogram;
+    s_shards.emplace(m_id, shard);
+  }
+  s_recent[s_next] = Entry{m_id, shard};
+  s_next = (s_next + 1) % kNumRecent;
+  return *shard;
+}
+
+template<typename T, typename... Axes>
+inline std::size_t
+ConcurrentHistogram<T, Axes...>::num_shards() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_shards.size();
+}
+
+template<typename T, typename... Axes>
+inline typename ConcurrentHistogram<T, Axes...>::Histogram
+ConcurrentHistogram<T, Axes...>::snapshot() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Histogram result = m_prototype;
+  for (const auto& shard : m_shards) { result += shard->histogram; }
+  return result;
+}
+
+template<typename T, typename... Axes>
+inline typename ConcurrentHistogram<T, Axes...>::Histogram
+ConcurrentHistogram<T, Axes...>::merge()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Histogram result = m_prototype;
+  for (auto& shard : m_shards) {
+    result += shard->histogram;
+    // shards stay registered since threads may still reference them
+    shard->histogram = m_prototype;
+  }
+  return result;
+}
+
+// implementation AtomicHistogram
+
+namespace histogram_impl {
+namespace {
+
+template<typename T>
+inline std::enable_if_t<std::is_integral<T>::value>
+atomic_add(std::atomic<T>& x, T value)
+{
+  x.fetch_add(value, std::memory_order_relaxed);
+}
+
+// atomic floating point addition is only available w/ C++20
+template<typename T>
+inline std::enable_if_t<not std::is_integral<T>::value>
+atomic_add(std::atomic<T>& x, T value)
+{
+  T expected = x.load(std::memory_order_relaxed);
+  while (not x.compare_exchange_weak(
+    expected, expected + value, std::memory_order_relaxed)) {
+  }
+}
+
+} // namespace
+} // namespace histogram_impl
+
+template<typename T, typename... Axes>
+inline AtomicHistogram<T, Axes...>::AtomicHistogram(Axes&&... axes)
+  // access nbins *before* moving the axes, otherwise the axes are invalid.
+  : m_size{axes.nbins()...}
+  , m_axes(std::move(axes)...)
+  , m_nbins(std::accumulate(
+      size().begin(), size().end(), static_cast<std::size_t>(1),
+      std::multiplies<std::size_t>()))
+  , m_bins(new std::atomic<T>[m_nbins])
+{
+  for (std::size_t i = 0; i < m_nbins; ++i) {
+    m_bins[i].store(static_cast<T>(0), std::memory_order_relaxed);
+  }
+}
+
+// same column-major layout as the dense storage
+template<typename T, typename... Axes>
+inline std::size_t
+AtomicHistogram<T, Axes...>::linear(Index idx) const
+{
+  std::size_t result = 0;
+  std::size_t step = 1;
+  for (std::size_t i = 0; i < idx.size(); ++i) {
+    result += step * idx[i];
+    step *= m_size[i];
+  }
+  return result;
+}
+
+template<typename T, typename... Axes>
+inline T
+AtomicHistogram<T, Axes...>::value(Index idx) const
+{
+  for (std::size_t i = 0; i < idx.size(); ++i) {
+    if (m_size[i] <= idx[i]) {
+      throw std::out_of_range("AtomicHistogram index is out of valid range");
+    }
+  }
+  return m_bins[linear(idx)].load(std::memory_order_relaxed);
+}
+
+template<typename T, typename... Axes>
+inline void
+AtomicHistogram<T, Axes...>::fill(typename Axes::Value... values, T weight)
+{
+  auto idx = index(std::index_sequence_for<Axes...>(), values...);
+  histogram_impl::atomic_add(m_bins[linear(idx)], weight);
+}
+
+template<typename T, typename... Axes>
+inline typename AtomicHistogram<T, Axes...>::Histogram
+AtomicHistogram<T, Axes...>::snapshot() const
+{
+  return snapshot(std::index_sequence_for<Axes...>());
+}
+
+template<typename T, typename... Axes>
+template<std::size_t... Is>
+inline typename AtomicHistogram<T, Axes...>::Histogram
+AtomicHistogram<T, Axes...>::snapshot(std::index_sequence<Is...>) const
+{
+  // the histogram takes ownership of its axes and needs separate copies
+  Histogram result(std::tuple_element_t<Is, std::tuple<Axes...>>(
+    std::get<Is>(m_axes))...);
+  T* data = result.m_data.data();
+  for (std::size_t i = 0; i < m_nbins; ++i) {
+    data[i] = m_bins[i].load(std::memory_order_relaxed);
+  }
+  return result;
+}
+
 } // namespace dfe
@@ -27,19 +27,76 @@
 
 #include <algorithm>
 #include <array>
+#include <clocale>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
 #include <fstream>
+#include <functional>
+#include <iterator>
 #include <limits>
-#include <sstream>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+// floating point std::from_chars might not be available even w/ C++17
+#if (201703L <= __cplusplus) and defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#if defined(__cpp_lib_to_chars) and (201611L <= __cpp_lib_to_chars)
+#define DFE_IO_DSV_USE_FROM_CHARS
+#endif
+#endif
+#endif
+
+#include "dfe_common_impl.hpp"
+
 namespace dfe {
 namespace io_dsv_impl {
 
+/// A non-owning, read-only reference to a contiguous sequence of characters.
+///
+/// Minimal replacement for `std::string_view` which requires C++17.
+class StringView {
+public:
+  constexpr StringView() = default;
+  constexpr StringView(const char* data, std::size_t size)
+    : m_data(data)
+    , m_size(size)
+  {
+  }
+
+  constexpr const char* data() const { return m_data; }
+  constexpr std::size_t size() const { return m_size; }
+  constexpr bool empty() const { return (m_size == 0); }
+  constexpr const char* begin() const { return m_data; }
+  constexpr const char* end() const { return m_data + m_size; }
+
+  /// Create an owning copy of the referenced characters.
+  std::string str() const { return std::string(m_data, m_size); }
+
+  friend bool operator==(StringView lhs, const std::string& rhs)
+  {
+    return (lhs.m_size == rhs.size()) and
+           std::equal(lhs.begin(), lhs.end(), rhs.begin());
+  }
+  friend bool operator==(const std::string& lhs, StringView rhs)
+  {
+    return (rhs == lhs);
+  }
+
+private:
+  const char* m_data = nullptr;
+  std::size_t m_size = 0;
+};
+
 /// Write arbitrary data as delimiter-separated values into a text file.
 template<char Delimiter>
 class DsvWriter {
@@ -47,18 +104,20 @@ public:
   DsvWriter() = delete;
   DsvWriter(const DsvWriter&) = delete;
   DsvWriter(DsvWriter&&) = default;
-  ~DsvWriter() = default;
+  ~DsvWriter();
   DsvWriter& operator=(const DsvWriter&) = delete;
-  DsvWriter& operator=(DsvWriter&&) = default;
+  DsvWriter& operator=(DsvWriter&& other);
 
   /// Create a file at the given path. Overwrites existing data.
   ///
-  /// \param columns    Column names, fixes the number of columns for the file
-  /// \param path       Path to the output file
-  /// \param precision  Output floating point precision
+  /// \param columns          Column names, fixes the number of columns
+  /// \param path             Path to the output file
+  /// \param precision        Output floating point precision
+  /// \param flush_threshold  Buffered bytes before they are written to file
   DsvWriter(
     const std::vector<std::string>& columns, const std::string& path,
-    int precision = std::numeric_limits<double>::max_digits10);
+    int precision = std::numeric_limits<double>::max_digits10,
+    std::size_t flush_threshold = 1u << 16);
 
   /// Append arguments as a new row to the file.
   ///
@@ -70,20 +129,26 @@ public:
   ///       is written as a separate column.
   template<typename Arg0, typename... Args>
   void append(Arg0&& arg0, Args&&... args);
+  /// Write all buffered rows to the file.
+  void flush();
 
 private:
   std::ofstream m_file;
   std::size_t m_num_columns;
+  int m_precision;
+  // formatted rows that have not yet been written to the file
+  std::string m_buffer;
+  std::size_t m_flush_threshold;
 
   // enable_if to prevent this overload to be used for std::vector<T> as well
   template<typename T>
-  static std::enable_if_t<
+  std::enable_if_t<
     std::is_arithmetic<std::decay_t<T>>::value or
       std::is_convertible<T, std::string>::value,
     unsigned>
-  write(T&& x, std::ostream& os);
+  write(T&& x);
   template<typename T, typename Allocator>
-  static unsigned write(const std::vector<T, Allocator>& xs, std::ostream& os);
+  unsigned write(const std::vector<T, Allocator>& xs);
 };
 
 /// Read arbitrary data as delimiter-separated values from a text file.
@@ -100,6 +165,10 @@ public:
   /// Open a file at the given path.
   ///
   /// \param path Path to the input file
+  ///
+  /// On POSIX systems, regular files are memory-mapped and lines are split
+  /// directly in the mapped memory. Otherwise, the file is read using the
+  /// standard library streams.
   DsvReader(const std::string& path);
 
   /// Read the next line from the file.
@@ -107,14 +176,33 @@ public:
   /// \returns true   if the line was successfully read
   /// \returns false  if no more lines are available
   bool read(std::vector<std::string>& columns);
+  /// Read the next line from the file without copying the columns.
+  ///
+  /// \returns true   if the line was successfully read
+  /// \returns false  if no more lines are available
+  ///
+  /// The column views reference an internal buffer and are only valid until
+  /// the next call to any of the read functions.
+  bool read(std::vector<StringView>& columns);
 
   /// Return the number of lines read so far.
+  ///
+  /// Lines read in blocks, e.g. by the parallel reader, are not included.
   std::size_t num_lines() const { return m_num_lines; }
 
 private:
+  // either the mapped file or the stream is used
+  common_impl::MappedFile m_map;
+  std::size_t m_map_pos = 0;
   std::ifstream m_file;
   std::string m_line;
   std::size_t m_num_lines = 0;
+
+  bool read_line(StringView& line);
+  bool read_lines(std::size_t nbytes, std::string& buffer, StringView& lines);
+
+  template<char D, typename NamedTuple>
+  friend class NamedTupleDsvParallelReader;
 };
 
 /// Write records as delimiter-separated values into a text file.
@@ -130,12 +218,14 @@ public:
 
   /// Create a file at the given path. Overwrites existing data.
   ///
-  /// \param path       Path to the output file
-  /// \param precision  Output floating point precision
+  /// \param path             Path to the output file
+  /// \param precision        Output floating point precision
+  /// \param flush_threshold  Buffered bytes before they are written to file
   NamedTupleDsvWriter(
     const std::string& path,
-    int precision = std::numeric_limits<double>::max_digits10)
-    : m_writer(colum_names(), path, precision)
+    int precision = std::numeric_limits<double>::max_digits10,
+    std::size_t flush_threshold = 1u << 16)
+    : m_writer(colum_names(), path, precision, flush_threshold)
   {
   }
 
@@ -146,6 +236,8 @@ public:
       record, std::make_index_sequence<
                 std::tuple_size<typename NamedTuple::Tuple>::value>{});
   }
+  /// Write all buffered records to the file.
+  void flush() { m_writer.flush(); }
 
 private:
   DsvWriter<Delimiter> m_writer;
@@ -163,15 +255,217 @@ private:
   }
 };
 
+// formatting helper functions
+//
+// values are formatted as by the stream operators w/ default flags in the
+// classic locale but written directly into a buffer. the only exception are
+// floating point values w/ a precision of at least max_digits10 if to_chars
+// is available. they use the shortest representation that round-trips, which
+// can have fewer digits than the stream output.
+
+inline void
+format(std::string& out, const char* str)
+{
+  out += str;
+}
+
+inline void
+format(std::string& out, const std::string& str)
+{
+  out += str;
+}
+
+// anything else that can be converted to a string
+template<typename T>
+inline std::enable_if_t<
+  not std::is_arithmetic<std::decay_t<T>>::value and
+  std::is_convertible<T, std::string>::value>
+format(std::string& out, T&& x)
+{
+  out += std::string(std::forward<T>(x));
+}
+
+// bool is written as 0/1 w/o std::boolalpha
+inline void
+format(std::string& out, bool x)
+{
+  out += (x ? '1' : '0');
+}
+
+// character types are written as the character itself. this includes
+// (u)int8_t on most systems.
+template<typename T>
+inline std::enable_if_t<
+  std::is_same<T, char>::value or std::is_same<T, signed char>::value or
+  std::is_same<T, unsigned char>::value>
+format(std::string& out, T x)
+{
+  out += static_cast<char>(x);
+}
+
+// integer types except bool and character types
+template<typename T>
+inline std::enable_if_t<
+  std::is_integral<T>::value and not std::is_same<T, bool>::value and
+  not std::is_same<T, char>::value and
+  not std::is_same<T, signed char>::value and
+  not std::is_same<T, unsigned char>::value>
+format(std::string& out, T x)
+{
+  // enough space for the digits of the largest 64bit number and a sign
+  char digits[24];
+  char* pos = digits + sizeof(digits);
+  // negation in unsigned arithmetic is well-defined and wraps around
+  std::uintmax_t abs = static_cast<std::uintmax_t>(x);
+  if (x < 0) { abs = 0 - abs; }
+  do {
+    *(--pos) = static_cast<char>('0' + (abs % 10));
+    abs /= 10;
+  } while (0 < abs);
+  if (x < 0) { *(--pos) = '-'; }
+  out.append(pos, digits + sizeof(digits));
+}
+
+// floating point types
+template<typename T>
+inline std::enable_if_t<std::is_floating_point<T>::value>
+format(std::string& out, T x, int precision)
+{
+  // enough space for the longest representation w/ 17 significant digits,
+  // a sign, a decimal point, and the exponent.
+  char buffer[64];
+#if defined(DFE_IO_DSV_USE_FROM_CHARS)
+  // shortest representation is guaranteed to round-trip the exact value and
+  // is used when the precision is sufficient for a round-trip anyways.
+  auto res =
+    (std::numeric_limits<T>::max_digits10 <= precision)
+      ? std::to_chars(buffer, buffer + sizeof(buffer), x)
+      : std::to_chars(
+          buffer, buffer + sizeof(buffer), x, std::chars_format::general,
+          precision);
+  if (res.ec == std::errc()) {
+    out.append(buffer, res.ptr);
+    return;
+  }
+#endif
+  // same %g conversion as used by the stream operators for the precision
+  auto y = static_cast<long double>(x);
+  int ret = std::snprintf(buffer, sizeof(buffer), "%.*Lg", precision, y);
+  if (ret < 0) {
+    throw std::runtime_error("Could not format floating point value");
+  }
+  auto size = static_cast<std::size_t>(ret);
+  auto first = out.size();
+  if (size < sizeof(buffer)) {
+    out.append(buffer, size);
+  } else {
+    // very large precision; format again directly into the output
+    out.resize(first + size + 1);
+    std::snprintf(&out[first], size + 1, "%.*Lg", precision, y);
+    out.resize(first + size);
+  }
+  // the C library uses the global locale and not the classic one
+  char decimal_point = *std::localeconv()->decimal_point;
+  if (decimal_point != '.') {
+    std::replace(out.begin() + first, out.end(), decimal_point, '.');
+  }
+}
+
+// only floating point types need the precision
+template<typename T>
+inline std::enable_if_t<not std::is_floating_point<std::decay_t<T>>::value>
+format(std::string& out, T&& x, int)
+{
+  format(out, std::forward<T>(x));
+}
+
 // string conversion helper functions
+//
+// fast conversion paths are selected at compile time depending on the target
+// type. input that does not fit the fast paths, e.g. because of leading
+// whitespace or an unusual format, is handed to the slower stream-based
+// conversion to retain the behaviour of the stream operators.
+
+// Convert using the stream operator. Supports arbitrary types.
+template<typename T>
+inline void
+parse_stream(StringView str, T& value)
+{
+  common_impl::parse_stream(str.begin(), str.end(), value);
+}
+
+// Convert a plain decimal integer w/ optional minus sign.
+template<typename T>
+inline bool
+parse_integer(StringView str, T& value)
+{
+  return common_impl::parse_integer(str.begin(), str.end(), value);
+}
+
+#if defined(DFE_IO_DSV_USE_FROM_CHARS)
+template<typename T>
+inline bool
+parse_floating_point(StringView str, T& value)
+{
+  auto res = std::from_chars(str.begin(), str.end(), value);
+  return (res.ec == std::errc()) and (res.ptr == str.end());
+}
+#else
+inline bool
+parse_floating_point(StringView str, double& value)
+{
+  return common_impl::parse_double_exact(str.begin(), str.end(), value);
+}
+
+inline bool
+parse_floating_point(StringView str, float& value)
+{
+  return common_impl::parse_float_exact(str.begin(), str.end(), value);
+}
+#endif
+
+// integer types except bool and character types. (u)int8_t is usually a
+// character type as well and is written/read as a single character.
+template<typename T>
+inline std::enable_if_t<std::is_integral<T>::value and (1 < sizeof(T))>
+parse(StringView str, T& value)
+{
+  if (not parse_integer(str, value)) { parse_stream(str, value); }
+}
+
+// bool is written as 0/1 by default
+inline void
+parse(StringView str, bool& value)
+{
+  const char* c = str.data();
+  if ((str.size() == 1) and ((*c == '0') or (*c == '1'))) {
+    value = (*c == '1');
+  } else {
+    parse_stream(str, value);
+  }
+}
 
+inline void
+parse(StringView str, float& value)
+{
+  if (not parse_floating_point(str, value)) { parse_stream(str, value); }
+}
+
+inline void
+parse(StringView str, double& value)
+{
+  if (not parse_floating_point(str, value)) { parse_stream(str, value); }
+}
+
+// all other types use the generic stream conversion
 template<typename T>
-static void
-parse(const std::string& str, T& value)
+inline std::enable_if_t<
+  not(std::is_integral<T>::value and (1 < sizeof(T))) and
+  not std::is_same<T, bool>::value and not std::is_same<T, float>::value and
+  not std::is_same<T, double>::value>
+parse(StringView str, T& value)
 {
-  // TODO use somthing w/ lower overhead then stringstream e.g. std::from_chars
-  std::istringstream is(str);
-  is >> value;
+  parse_stream(str, value);
 }
 
 /// Read records as delimiter-separated values from a text file.
@@ -234,7 +528,8 @@ private:
   using Tuple = typename NamedTuple::Tuple;
 
   DsvReader<Delimiter> m_reader;
-  std::vector<std::string> m_columns;
+  // reference the reader-internal line buffer
+  std::vector<StringView> m_columns;
   // #columns is fixed to a reasonable value after reading the header
   std::size_t m_num_columns = SIZE_MAX;
   // map tuple index to column index in the file, SIZE_MAX for missing elements
@@ -242,23 +537,173 @@ private:
   // column indices that do not map to a tuple items
   std::vector<std::size_t> m_extra_columns;
 
+  // tuple indices ordered by the corresponding member names
+  static const std::array<std::size_t, std::tuple_size<Tuple>::value>&
+  sorted_members();
   void use_default_columns();
   void parse_header(const std::vector<std::string>& optional_columns);
+  void check_num_columns(std::size_t num_columns, std::size_t line) const;
+  // parsing only depends on the fixed column mapping and is thread-safe
+  void parse_record(
+    const std::vector<StringView>& columns, NamedTuple& record) const
+  {
+    parse_record(
+      columns, record,
+      std::make_index_sequence<std::tuple_size<Tuple>::value>{});
+  }
   template<std::size_t... I>
-  void parse_record(NamedTuple& record, std::index_sequence<I...>) const
+  void parse_record(
+    const std::vector<StringView>& columns, NamedTuple& record,
+    std::index_sequence<I...>) const
   {
     // see namedtuple_impl::print_tuple for explanation
     // allow different column ordering on file and optional columns
-    (void)(int[]){0, (parse_element<I>(record), 0)...};
+    (void)(int[]){0, (parse_element<I>(columns, record), 0)...};
   }
   template<std::size_t I>
-  void parse_element(NamedTuple& record) const
+  void parse_element(
+    const std::vector<StringView>& columns, NamedTuple& record) const
   {
     using std::get;
     if (m_tuple_column_map[I] != SIZE_MAX) {
-      parse(m_columns[m_tuple_column_map[I]], get<I>(record));
+      parse(columns[m_tuple_column_map[I]], get<I>(record));
+    }
+  }
+  template<typename T>
+  void parse_extra(const std::vector<StringView>& columns, T* extra) const
+  {
+    for (std::size_t i = 0; i < m_extra_columns.size(); ++i) {
+      parse(columns[m_extra_columns[i]], extra[i]);
     }
   }
+
+  template<char D, typename NT>
+  friend class NamedTupleDsvParallelReader;
+};
+
+/// A fixed set of worker threads that run one task concurrently.
+///
+/// Tasks are run fork-join style, i.e. running a task returns only after all
+/// workers have finished. The calling thread participates as the first worker.
+class WorkerPool {
+public:
+  using Task = std::function<void(std::size_t)>;
+
+  /// Start the given number of additional worker threads.
+  WorkerPool(std::size_t num_threads);
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool(WorkerPool&&) = delete;
+  /// Stop and join all worker threads.
+  ~WorkerPool();
+  WorkerPool& operator=(const WorkerPool&) = delete;
+  WorkerPool& operator=(WorkerPool&&) = delete;
+
+  /// Run `task(i)` for all `i` in `[0, n)` and wait until all are finished.
+  ///
+  /// `n` must be at most the number of worker threads plus one. The first
+  /// exception thrown by any of the tasks is rethrown afterwards.
+  void run(std::size_t n, const Task& task);
+
+private:
+  void work(std::size_t index);
+
+  std::mutex m_mutex;
+  std::condition_variable m_wakeup;
+  std::condition_variable m_finished;
+  // state of the current task; only modified while holding the mutex
+  const Task* m_task = nullptr;
+  std::size_t m_num_tasks = 0;
+  std::size_t m_num_pending = 0;
+  std::size_t m_generation = 0;
+  std::exception_ptr m_error;
+  bool m_stop = false;
+  std::vector<std::thread> m_threads;
+};
+
+/// Read records as delimiter-separated values from a text file in parallel.
+///
+/// The header is handled exactly as for the `NamedTupleDsvReader`, including
+/// optional and extra columns. The remaining file content is split into blocks
+/// of complete lines that are converted into records concurrently on multiple
+/// threads. Records are returned in batches in the same order as on file.
+template<char Delimiter, typename NamedTuple>
+class NamedTupleDsvParallelReader {
+public:
+  NamedTupleDsvParallelReader() = delete;
+  NamedTupleDsvParallelReader(const NamedTupleDsvParallelReader&) = delete;
+  NamedTupleDsvParallelReader(NamedTupleDsvParallelReader&&) = default;
+  ~NamedTupleDsvParallelReader() = default;
+  NamedTupleDsvParallelReader& operator=(const NamedTupleDsvParallelReader&) =
+    delete;
+  NamedTupleDsvParallelReader& operator=(NamedTupleDsvParallelReader&&) =
+    default;
+
+  /// Open a file at the given path.
+  ///
+  /// \param path              Path to the input file
+  /// \param optional_columns  Record columns that can be missing in the file
+  /// \param verify_header     true to check header column names, false to skip
+  /// \param num_threads       Number of threads, zero to use all available
+  /// \param block_size        Approximate number of bytes per thread and batch
+  NamedTupleDsvParallelReader(
+    const std::string& path,
+    const std::vector<std::string>& optional_columns = {},
+    bool verify_header = true, std::size_t num_threads = 0,
+    std::size_t block_size = 1u << 22);
+
+  /// Read the next batch of records from the file.
+  ///
+  /// Previous content of the output is replaced. Each batch contains the
+  /// records from up to one block per thread. Extra columns in the file will
+  /// be ignored. Elements of the record that correspond to missing, optional
+  /// columns are default-initialized.
+  ///
+  /// \returns true   if at least one record was successfully read
+  /// \returns false  if no more records are available
+  bool read(std::vector<NamedTuple>& records);
+  /// Read the next batch of records and any extra columns from the file.
+  ///
+  /// The extra columns are stored consecutively for each record, i.e. the
+  /// extra columns of record `i` start at index `i * num_extra_columns()`.
+  ///
+  /// \returns true   if at least one record was successfully read
+  /// \returns false  if no more records are available
+  template<typename T>
+  bool read(std::vector<NamedTuple>& records, std::vector<T>& extra);
+
+  /// Return the number of additional columns that are not part of the tuple.
+  std::size_t num_extra_columns() const { return m_reader.num_extra_columns(); }
+  /// Return the number of records read so far.
+  std::size_t num_records() const { return m_num_records; }
+  /// Return the number of threads used for decoding.
+  std::size_t num_threads() const { return m_buffers.size(); }
+
+private:
+  // the result of decoding a single block on one thread
+  template<typename T>
+  struct Batch {
+    std::vector<NamedTuple> records;
+    std::vector<T> extra;
+    // first line within the block w/ inconsistent number of columns
+    std::size_t invalid_line = SIZE_MAX;
+    std::size_t invalid_num_columns = 0;
+  };
+
+  NamedTupleDsvReader<Delimiter, NamedTuple> m_reader;
+  std::size_t m_block_size;
+  std::size_t m_num_records = 0;
+  // per-thread block storage; only used w/o memory-mapped input
+  std::vector<std::string> m_buffers;
+  // stored separately to keep the threads in place when the reader is moved
+  std::unique_ptr<WorkerPool> m_pool;
+
+  template<typename T>
+  bool read_impl(
+    std::vector<NamedTuple>& records, std::vector<T>& extra, bool with_extra);
+  template<typename T>
+  static Batch<T> decode(
+    const NamedTupleDsvReader<Delimiter, NamedTuple>& reader, StringView block,
+    bool with_extra);
 };
 
 // implementation writer
@@ -266,15 +711,16 @@ private:
 template<char Delimiter>
 inline DsvWriter<Delimiter>::DsvWriter(
   const std::vector<std::string>& columns, const std::string& path,
-  int precision)
+  int precision, std::size_t flush_threshold)
   : m_file(
       path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc)
   , m_num_columns(columns.size())
+  , m_precision(precision)
+  , m_flush_threshold(flush_threshold)
 {
   if (not m_file.is_open() or m_file.fail()) {
     throw std::runtime_error("Could not open file '" + path + "'");
   }
-  m_file.precision(precision);
   if (m_num_columns == 0) {
     throw std::invalid_argument("No columns were specified");
   }
@@ -282,41 +728,76 @@ inline DsvWriter<Delimiter>::DsvWriter(
   append(columns);
 }
 
+template<char Delimiter>
+inline DsvWriter<Delimiter>::~DsvWriter()
+{
+  // destructor can not throw; write w/o checking for errors
+  if (m_file.is_open() and not m_buffer.empty()) {
+    m_file.write(m_buffer.data(), m_buffer.size());
+  }
+}
+
+template<char Delimiter>
+inline DsvWriter<Delimiter>&
+DsvWriter<Delimiter>::operator=(DsvWriter&& other)
+{
+  // buffered data must not be lost when replacing the file
+  if ((this != &other) and m_file.is_open()) { flush(); }
+  m_file = std::move(other.m_file);
+  m_num_columns = other.m_num_columns;
+  m_precision = other.m_precision;
+  m_buffer = std::move(other.m_buffer);
+  m_flush_threshold = other.m_flush_threshold;
+  other.m_buffer.clear();
+  return *this;
+}
+
 template<char Delimiter>
 template<typename Arg0, typename... Args>
 inline void
 DsvWriter<Delimiter>::append(Arg0&& arg0, Args&&... args)
 {
   // we can only check how many columns were written after they have been
-  // written. write to temporary first to prevent bad data on file.
-  std::stringstream line;
-  // ensure consistent formatting
-  line.precision(m_file.precision());
+  // written. format into the buffer first and remove the row again on error
+  // to prevent bad data on file.
+  auto row_start = m_buffer.size();
   unsigned written_columns[] = {
     // write the first item without a delimiter and store columns written
-    write(std::forward<Arg0>(arg0), line),
+    write(std::forward<Arg0>(arg0)),
     // for all other items, write the delimiter followed by the item itself
     // (<expr1>, <expr2>) use the comma operator (yep, ',' in c++ is a weird
     // but helpful operator) to execute both expression and return the return
     // value of the last one, i.e. here thats the number of columns written.
     // the ... pack expansion creates this expression for all arguments
-    (line << Delimiter, write(std::forward<Args>(args), line))...,
+    (m_buffer += Delimiter, write(std::forward<Args>(args)))...,
   };
-  line << '\n';
+  m_buffer += '\n';
   // validate that the total number of written columns matches the specs.
   unsigned total_columns = 0;
   for (auto nc : written_columns) { total_columns += nc; }
   if (total_columns < m_num_columns) {
+    m_buffer.resize(row_start);
     throw std::invalid_argument("Not enough columns");
   }
   if (m_num_columns < total_columns) {
+    m_buffer.resize(row_start);
     throw std::invalid_argument("Too many columns");
   }
-  // write the line to disk and check that it actually happened
-  m_file << line.rdbuf();
+  if (m_flush_threshold <= m_buffer.size()) { flush(); }
+}
+
+template<char Delimiter>
+inline void
+DsvWriter<Delimiter>::flush()
+{
+  // write the buffer to disk and check that it actually happened
+  m_file.write(m_buffer.data(), m_buffer.size());
+  m_file.flush();
   if (not m_file.good()) {
     throw std::runtime_error("Could not write data to file");
   }
+  // keeps the allocated memory for the next rows
+  m_buffer.clear();
 }
 
 template<char Delimiter>
@@ -325,22 +806,21 @@ inline std::enable_if_t<
   std::is_arithmetic<std::decay_t<T>>::value or
     std::is_convertible<T, std::string>::value,
   unsigned>
-DsvWriter<Delimiter>::write(T&& x, std::ostream& os)
+DsvWriter<Delimiter>::write(T&& x)
 {
-  os << x;
+  format(m_buffer, std::forward<T>(x), m_precision);
   return 1u;
 }
 
 template<char Delimiter>
 template<typename T, typename Allocator>
 inline unsigned
-DsvWriter<Delimiter>::write(
-  const std::vector<T, Allocator>& xs, std::ostream& os)
+DsvWriter<Delimiter>::write(const std::vector<T, Allocator>& xs)
 {
   unsigned n = 0;
   for (const auto& x : xs) {
-    if (0 < n) { os << Delimiter; }
-    os << x;
+    if (0 < n) { m_buffer += Delimiter; }
+    format(m_buffer, x, m_precision);
     n += 1;
   }
   return n;
@@ -348,10 +828,31 @@ DsvWriter<Delimiter>::write(
 
 // implementation reader
 
+// Split the line into columns that reference the same memory as the line.
+//
+// Clearing the columns keeps the allocated storage.
+template<char Delimiter>
+inline void
+split_columns(StringView line, std::vector<StringView>& columns)
+{
+  columns.clear();
+  const char* pos = line.begin();
+  const char* end = line.end();
+  while (pos < end) {
+    auto del = std::find(pos, end, Delimiter);
+    // reached the end of the line also determines the last column
+    columns.emplace_back(pos, del - pos);
+    // start next column search after the delimiter
+    pos = del + 1;
+  }
+}
+
 template<char Delimiter>
 inline DsvReader<Delimiter>::DsvReader(const std::string& path)
-  : m_file(path, std::ios_base::binary | std::ios_base::in)
 {
+  if (m_map.open(path)) { return; }
+  // fall back to regular stream-based i/o
+  m_file.open(path, std::ios_base::binary | std::ios_base::in);
   if (not m_file.is_open() or m_file.fail()) {
     throw std::runtime_error("Could not open file '" + path + "'");
   }
@@ -361,29 +862,92 @@ template<char Delimiter>
 inline bool
 DsvReader<Delimiter>::read(std::vector<std::string>& columns)
 {
+  std::vector<StringView> views;
+  if (not read(views)) { return false; }
+  // re-use existing strings to avoid unnecessary allocations
+  columns.resize(views.size());
+  for (std::size_t i = 0; i < views.size(); ++i) {
+    columns[i].assign(views[i].data(), views[i].size());
+  }
+  return true;
+}
+
+template<char Delimiter>
+inline bool
+DsvReader<Delimiter>::read(std::vector<StringView>& columns)
+{
+  StringView line;
+  if (not read_line(line)) { return false; }
+  m_num_lines += 1;
+  split_columns<Delimiter>(line, columns);
+  return true;
+}
+
+template<char Delimiter>
+inline bool
+DsvReader<Delimiter>::read_line(StringView& line)
+{
+  if (m_map.is_open()) {
+    // the line references the mapped memory directly w/o any copies
+    if (m_map.size() <= m_map_pos) { return false; }
+    const char* begin = m_map.data() + m_map_pos;
+    const char* end = m_map.data() + m_map.size();
+    const char* eol = std::find(begin, end, '\n');
+    line = StringView(begin, eol - begin);
+    // continue after the newline, if there is one
+    m_map_pos += line.size() + ((eol != end) ? 1 : 0);
+    return true;
+  }
   // read the next line and check for both end-of-file and errors
-  std::getline(m_file, m_line);
-  if (m_file.eof()) { return false; }
-  if (m_file.fail()) {
+  // the line buffer is re-used and only grows when needed
+  if (not std::getline(m_file, m_line)) {
+    if (m_file.eof()) { return false; }
     throw std::runtime_error(
       "Could not read line " + std::to_string(m_num_lines));
   }
-  m_num_lines += 1;
+  line = StringView(m_line.data(), m_line.size());
+  return true;
+}
 
-  // split the line into columns
-  columns.clear();
-  for (std::string::size_type pos = 0; pos < m_line.size();) {
-    auto del = m_line.find_first_of(Delimiter, pos);
-    if (del == std::string::npos) {
-      // reached the end of the line; also determines the last column
-      columns.emplace_back(m_line, pos);
-      break;
-    } else {
-      columns.emplace_back(m_line, pos, del - pos);
-      // start next column search after the delimiter
-      pos = del + 1;
+// Read complete lines w/ a total size of a least the given number of bytes.
+//
+// If the complete file is mapped, the output references the mapped memory
+// directly and the buffer is not used. Otherwise, the data is read into the
+// given buffer. The output contains the line terminators.
+template<char Delimiter>
+inline bool
+DsvReader<Delimiter>::read_lines(
+  std::size_t nbytes, std::string& buffer, StringView& lines)
+{
+  // ensure we always make progress
+  nbytes = std::max<std::size_t>(nbytes, 1u);
+  if (m_map.is_open()) {
+    if (m_map.size() <= m_map_pos) { return false; }
+    const char* begin = m_map.data() + m_map_pos;
+    const char* end = m_map.data() + m_map.size();
+    const char* last = begin + std::min(nbytes, m_map.size() - m_map_pos);
+    // extend to the end of the current line
+    if (last != end) {
+      last = std::find(last - 1, end, '\n');
+      last += (last != end) ? 1 : 0;
     }
+    lines = StringView(begin, last - begin);
+    m_map_pos += lines.size();
+    return true;
   }
+  buffer.resize(nbytes);
+  m_file.read(&buffer[0], nbytes);
+  buffer.resize(m_file.gcount());
+  if (m_file.bad()) { throw std::runtime_error("Could not read data"); }
+  if (buffer.empty()) { return false; }
+  // extend to the end of the current line
+  if (not m_file.eof() and (buffer.back() != '\n')) {
+    std::getline(m_file, m_line);
+    if (m_file.bad()) { throw std::runtime_error("Could not read data"); }
+    buffer += m_line;
+    buffer += '\n';
+  }
+  lines = StringView(buffer.data(), buffer.size());
   return true;
 }
 
@@ -417,17 +981,9 @@ NamedTupleDsvReader<Delimiter, NamedTuple>::read(NamedTuple& record)
 {
   if (not m_reader.read(m_columns)) { return false; }
   // check for consistent entries per-line
-  if (m_columns.size() < m_num_columns) {
-    throw std::runtime_error(
-      "Too few columns in line " + std::to_string(m_reader.num_lines()));
-  }
-  if (m_num_columns < m_columns.size()) {
-    throw std::runtime_error(
-      "Too many columns in line " + std::to_string(m_reader.num_lines()));
-  }
+  check_num_columns(m_columns.size(), m_reader.num_lines());
   // convert to tuple
-  parse_record(
-    record, std::make_index_sequence<std::tuple_size<Tuple>::value>{});
+  parse_record(m_columns, record);
   return true;
 }
 
@@ -441,12 +997,24 @@ NamedTupleDsvReader<Delimiter, NamedTuple>::read(
   if (not read(record)) { return false; }
   // parse extra columns
   extra.resize(m_extra_columns.size());
-  for (std::size_t i = 0; i < m_extra_columns.size(); ++i) {
-    parse(m_columns[m_extra_columns[i]], extra[i]);
-  }
+  parse_extra(m_columns, extra.data());
   return true;
 }
 
+template<char Delimiter, typename NamedTuple>
+inline void
+NamedTupleDsvReader<Delimiter, NamedTuple>::check_num_columns(
+  std::size_t num_columns, std::size_t line) const
+{
+  if (num_columns < m_num_columns) {
+    throw std::runtime_error("Too few columns in line " + std::to_string(line));
+  }
+  if (m_num_columns < num_columns) {
+    throw std::runtime_error(
+      "Too many columns in line " + std::to_string(line));
+  }
+}
+
 template<char Delimiter, typename NamedTuple>
 inline void
 NamedTupleDsvReader<Delimiter, NamedTuple>::use_default_columns()
@@ -460,44 +1028,260 @@ NamedTupleDsvReader<Delimiter, NamedTuple>::use_default_columns()
   m_extra_columns.clear();
 }
 
+template<char Delimiter, typename NamedTuple>
+inline const std::array<std::size_t, std::tuple_size<
+                                       typename NamedTuple::Tuple>::value>&
+NamedTupleDsvReader<Delimiter, NamedTuple>::sorted_members()
+{
+  static const auto s_sorted = []() {
+    const auto& names = NamedTuple::names();
+    std::array<std::size_t, std::tuple_size<Tuple>::value> sorted;
+    for (std::size_t i = 0; i < sorted.size(); ++i) { sorted[i] = i; }
+    std::sort(sorted.begin(), sorted.end(), [&](std::size_t a, std::size_t b) {
+      return names[a] < names[b];
+    });
+    return sorted;
+  }();
+  return s_sorted;
+}
+
 template<char Delimiter, typename NamedTuple>
 inline void
 NamedTupleDsvReader<Delimiter, NamedTuple>::parse_header(
   const std::vector<std::string>& optional_columns)
 {
   const auto& names = NamedTuple::names();
+  const auto& sorted = sorted_members();
 
   // the number of header columns fixes the expected number of data columns
   m_num_columns = m_columns.size();
 
-  // check that all non-optional columns are available
-  for (const auto& name : names) {
-    // no need to for availability if the column is optional
-    auto o = std::find(optional_columns.begin(), optional_columns.end(), name);
-    if (o != optional_columns.end()) { continue; }
-    // missing, non-optional column mean we can not continue
-    auto c = std::find(m_columns.begin(), m_columns.end(), name);
-    if (c == m_columns.end()) {
-      throw std::runtime_error("Missing header column '" + name + "'");
-    }
-  }
-
   // ensure missing columns are correctly marked as such
   m_tuple_column_map.fill(SIZE_MAX);
 
   // determine column-tuple mapping and extra column indices
   m_extra_columns.clear();
   for (std::size_t i = 0; i < m_columns.size(); ++i) {
-    // find the position of the column in the tuple.
-    auto it = std::find(names.begin(), names.end(), m_columns[i]);
-    if (it != names.end()) {
+    StringView column = m_columns[i];
+    // find the position of the column in the tuple using the sorted names
+    auto it = std::lower_bound(
+      sorted.begin(), sorted.end(), column,
+      [&](std::size_t member, StringView col) {
+        const auto& name = names[member];
+        return std::lexicographical_compare(
+          name.begin(), name.end(), col.begin(), col.end());
+      });
+    if ((it != sorted.end()) and (names[*it] == column)) {
       // establish mapping between column and tuple item position
-      m_tuple_column_map[std::distance(names.begin(), it)] = i;
+      m_tuple_column_map[*it] = i;
     } else {
       // record non-tuple columns
       m_extra_columns.push_back(i);
     }
   }
+
+  // check that all non-optional columns are available
+  for (std::size_t i = 0; i < names.size(); ++i) {
+    if (m_tuple_column_map[i] != SIZE_MAX) { continue; }
+    // no need to for availability if the column is optional
+    auto o =
+      std::find(optional_columns.begin(), optional_columns.end(), names[i]);
+    if (o != optional_columns.end()) { continue; }
+    // missing, non-optional column mean we can not continue
+    throw std::runtime_error("Missing header column '" + names[i] + "'");
+  }
+}
+
+// implementation worker pool
+
+inline WorkerPool::WorkerPool(std::size_t num_threads)
+{
+  m_threads.reserve(num_threads);
+  for (std::size_t i = 0; i < num_threads; ++i) {
+    // the calling thread always runs the first task
+    m_threads.emplace_back(&WorkerPool::work, this, i + 1);
+  }
+}
+
+inline WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wakeup.notify_all();
+  for (auto& thread : m_threads) { thread.join(); }
+}
+
+inline void
+WorkerPool::run(std::size_t n, const Task& task)
+{
+  if (n == 0) { return; }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_task = &task;
+    m_num_tasks = n;
+    m_num_pending = n - 1;
+    m_error = nullptr;
+    m_generation += 1;
+  }
+  m_wakeup.notify_all();
+  std::exception_ptr error;
+  try {
+    task(0);
+  } catch (...) { error = std::current_exception(); }
+  // the task must stay valid until all workers are finished
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_finished.wait(lock, [&]() { return (m_num_pending == 0); });
+  m_task = nullptr;
+  if (not error) { error = m_error; }
+  lock.unlock();
+  if (error) { std::rethrow_exception(error); }
+}
+
+inline void
+WorkerPool::work(std::size_t index)
+{
+  std::size_t generation = 0;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_wakeup.wait(
+      lock, [&]() { return m_stop or (generation != m_generation); });
+    if (m_stop) { return; }
+    // a new task can only be started once all active workers are finished.
+    // inactive workers might miss a task but never one they need to run.
+    generation = m_generation;
+    if (m_num_tasks <= index) { continue; }
+    const Task& task = *m_task;
+    lock.unlock();
+    std::exception_ptr error;
+    try {
+      task(index);
+    } catch (...) { error = std::current_exception(); }
+    lock.lock();
+    if (error and not m_error) { m_error = error; }
+    m_num_pending -= 1;
+    if (m_num_pending == 0) { m_finished.notify_one(); }
+  }
+}
+
+// implementation parallel named tuple reader
+
+template<char Delimiter, typename NamedTuple>
+inline NamedTupleDsvParallelReader<Delimiter, NamedTuple>::
+  NamedTupleDsvParallelReader(
+    const std::string& path, const std::vector<std::string>& optional_columns,
+    bool verify_header, std::size_t num_threads, std::size_t block_size)
+  : m_reader(path, optional_columns, verify_header)
+  , m_block_size(block_size)
+{
+  if (num_threads == 0) { num_threads = std::thread::hardware_concurrency(); }
+  // hardware concurrency can be unknown
+  m_buffers.resize(std::max<std::size_t>(num_threads, 1u));
+  m_pool.reset(new WorkerPool(m_buffers.size() - 1));
+}
+
+template<char Delimiter, typename NamedTuple>
+inline bool
+NamedTupleDsvParallelReader<Delimiter, NamedTuple>::read(
+  std::vector<NamedTuple>& records)
+{
+  std::vector<char> unused;
+  return read_impl(records, unused, false);
+}
+
+template<char Delimiter, typename NamedTuple>
+template<typename T>
+inline bool
+NamedTupleDsvParallelReader<Delimiter, NamedTuple>::read(
+  std::vector<NamedTuple>& records, std::vector<T>& extra)
+{
+  return read_impl(records, extra, true);
+}
+
+template<char Delimiter, typename NamedTuple>
+template<typename T>
+inline bool
+NamedTupleDsvParallelReader<Delimiter, NamedTuple>::read_impl(
+  std::vector<NamedTuple>& records, std::vector<T>& extra, bool with_extra)
+{
+  records.clear();
+  extra.clear();
+
+  // split the next part of the file into one block per thread
+  std::vector<StringView> blocks;
+  for (auto& buffer : m_buffers) {
+    StringView block;
+    if (not m_reader.m_reader.read_lines(m_block_size, buffer, block)) {
+      break;
+    }
+    blocks.push_back(block);
+  }
+  if (blocks.empty()) { return false; }
+
+  // decode one block per worker w/o copying the blocks or the reader state
+  const auto& reader = m_reader;
+  std::vector<Batch<T>> batches(blocks.size());
+  m_pool->run(blocks.size(), [&](std::size_t i) {
+    batches[i] = decode<T>(reader, blocks[i], with_extra);
+  });
+
+  // collect the results in file order
+  for (auto& batch : batches) {
+    if (batch.invalid_line != SIZE_MAX) {
+      // line numbers start at one and the header is the first line
+      auto line = 2u + m_num_records + records.size() + batch.invalid_line;
+      m_reader.check_num_columns(batch.invalid_num_columns, line);
+    }
+    if (records.empty()) {
+      records = std::move(batch.records);
+      extra = std::move(batch.extra);
+    } else {
+      records.insert(
+        records.end(), std::make_move_iterator(batch.records.begin()),
+        std::make_move_iterator(batch.records.end()));
+      extra.insert(
+        extra.end(), std::make_move_iterator(batch.extra.begin()),
+        std::make_move_iterator(batch.extra.end()));
+    }
+  }
+  m_num_records += records.size();
+  return not records.empty();
+}
+
+template<char Delimiter, typename NamedTuple>
+template<typename T>
+inline auto
+NamedTupleDsvParallelReader<Delimiter, NamedTuple>::decode(
+  const NamedTupleDsvReader<Delimiter, NamedTuple>& reader, StringView block,
+  bool with_extra) -> Batch<T>
+{
+  const auto num_extra = reader.num_extra_columns();
+
+  Batch<T> batch;
+  std::vector<StringView> columns;
+  const char* pos = block.begin();
+  const char* end = block.end();
+  while (pos < end) {
+    const char* eol = std::find(pos, end, '\n');
+    split_columns<Delimiter>(StringView(pos, eol - pos), columns);
+    pos = eol + 1;
+    // stop at the first invalid line; it is reported by the caller since only
+    // the caller knows the position of the block within the file.
+    if (columns.size() != reader.m_num_columns) {
+      batch.invalid_line = batch.records.size();
+      batch.invalid_num_columns = columns.size();
+      break;
+    }
+    batch.records.emplace_back();
+    reader.parse_record(columns, batch.records.back());
+    if (with_extra) {
+      batch.extra.resize(batch.extra.size() + num_extra);
+      reader.parse_extra(
+        columns, batch.extra.data() + (batch.extra.size() - num_extra));
+    }
+  }
+  return batch;
 }
 
 } // namespace io_dsv_impl
@@ -516,6 +1300,11 @@ using NamedTupleCsvWriter = io_dsv_impl::NamedTupleDsvWriter<',', T>;
 template<typename T>
 using NamedTupleCsvReader = io_dsv_impl::NamedTupleDsvReader<',', T>;
 
+/// Read tuple-like records from a comma-separated file using multiple threads.
+template<typename T>
+using NamedTupleCsvParallelReader =
+  io_dsv_impl::NamedTupleDsvParallelReader<',', T>;
+
 /// Write tuple-like records as tab-separated values into a text file.
 template<typename T>
 using NamedTupleTsvWriter = io_dsv_impl::NamedTupleDsvWriter<'\t', T>;
@@ -524,4 +1313,9 @@ using NamedTupleTsvWriter = io_dsv_impl::NamedTupleDsvWriter<'\t', T>;
 template<typename T>
 using NamedTupleTsvReader = io_dsv_impl::NamedTupleDsvReader<'\t', T>;
 
+/// Read tuple-like records from a tab-separated file using multiple threads.
+template<typename T>
+using NamedTupleTsvParallelReader =
+  io_dsv_impl::NamedTupleDsvParallelReader<'\t', T>;
+
 } // namespace dfe
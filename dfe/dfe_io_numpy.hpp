@@ -19,18 +19,27 @@
 // SOFTWARE.
 
 /// \file
-/// \brief   Write numpy-compatible .npy binary files
+/// \brief   Read/write numpy-compatible .npy/.npz binary files
 /// \author  Moritz Kiehn <msmk@cern.ch>
 /// \date    2019-09-08, Split numpy i/o from the namedtuple library
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#include "dfe_common_impl.hpp"
 
 namespace dfe {
 
@@ -47,13 +56,32 @@ public:
   NamedTupleNumpyWriter(NamedTupleNumpyWriter&&) = default;
   ~NamedTupleNumpyWriter();
   NamedTupleNumpyWriter& operator=(const NamedTupleNumpyWriter&) = delete;
-  NamedTupleNumpyWriter& operator=(NamedTupleNumpyWriter&&) = default;
+  /// Close the current file before taking over the other one.
+  NamedTupleNumpyWriter& operator=(NamedTupleNumpyWriter&& other);
 
   /// Create a npy file at the given path. Overwrites existing data.
-  NamedTupleNumpyWriter(const std::string& path);
+  ///
+  /// \param path         Path to the output file
+  /// \param buffer_size  Buffered bytes before they are written to file
+  NamedTupleNumpyWriter(
+    const std::string& path, std::size_t buffer_size = 1u << 20);
 
   /// Append a record to the end of the file.
   void append(const NamedTuple& record);
+  /// Append multiple records stored contiguously in memory.
+  void append(const NamedTuple* first, std::size_t n);
+  /// Append all records in the range `[first, last)`.
+  ///
+  /// Requires at least forward iterators.
+  template<typename Iterator>
+  void append(Iterator first, Iterator last);
+  /// Write all buffered records to the file.
+  void flush();
+  /// Write all buffered records and the final header and close the file.
+  ///
+  /// Throws on i/o errors. No records can be appended afterwards. Does nothing
+  /// if already closed.
+  void close();
 
 private:
   // the equivalent std::tuple-like type
@@ -62,14 +90,187 @@ private:
   std::ofstream m_file;
   std::size_t m_fixed_header_length;
   std::size_t m_num_tuples;
+  // packed records that have not yet been written
+  std::vector<char> m_buffer;
+  std::size_t m_buffer_size;
 
   void write_header(std::size_t num_tuples);
+  template<typename Iterator>
+  void append_n(Iterator first, std::size_t n);
+};
+
+namespace io_npy_impl {
+
+/// Write an uncompressed zip archive, e.g. as used by `.npz` files.
+///
+/// Entries are written sequentially and their size must be known in advance.
+/// Zip64 extensions are only used if required.
+class ZipWriter {
+public:
+  ZipWriter() = default;
+  ZipWriter(const ZipWriter&) = delete;
+  ZipWriter(ZipWriter&&) = default;
+  ZipWriter& operator=(const ZipWriter&) = delete;
+  ZipWriter& operator=(ZipWriter&&) = default;
+
+  /// Create an archive at the given path. Overwrites existing data.
+  ZipWriter(const std::string& path);
+
+  /// Start a new entry with the given name and total size.
+  void begin_entry(const std::string& name, std::uint64_t size);
+  /// Append data to the current entry.
+  void write(const char* data, std::size_t size);
+  /// Finish the current entry.
+  void end_entry();
+  /// Write the central directory and close the archive.
+  void close();
+
+private:
+  struct Entry {
+    std::string name;
+    std::uint64_t size;
+    std::uint64_t offset;
+    std::uint32_t crc;
+  };
+
+  std::ofstream m_file;
+  std::vector<Entry> m_entries;
+  std::uint64_t m_offset = 0;
+  std::uint64_t m_written = 0;
+  std::uint32_t m_crc = 0;
+};
+
+} // namespace io_npy_impl
+
+/// Write records into a NumPy-compatible `.npz` archive with one array per
+/// member.
+///
+/// Each member of the named tuple is stored as a separate, contiguous
+/// one-dimensional array using the member name, i.e. as a struct-of-arrays.
+/// Records are buffered in fixed-size chunks and written to one temporary
+/// file per member next to the output file. The final archive is assembled
+/// by `close()`. Errors can only be reported by an explicit `close()`; if the
+/// writer is destroyed without it, the archive is assembled on a best-effort
+/// basis and errors are ignored.
+template<typename NamedTuple>
+class NamedTupleNumpyColumnWriter {
+public:
+  NamedTupleNumpyColumnWriter() = delete;
+  NamedTupleNumpyColumnWriter(const NamedTupleNumpyColumnWriter&) = delete;
+  NamedTupleNumpyColumnWriter(NamedTupleNumpyColumnWriter&&) = default;
+  ~NamedTupleNumpyColumnWriter();
+  NamedTupleNumpyColumnWriter&
+  operator=(const NamedTupleNumpyColumnWriter&) = delete;
+  NamedTupleNumpyColumnWriter&
+  operator=(NamedTupleNumpyColumnWriter&&) = delete;
+
+  /// Create a npz file at the given path. Overwrites existing data.
+  ///
+  /// \param path        Path to the output file
+  /// \param chunk_size  Buffered records before they are written to file
+  NamedTupleNumpyColumnWriter(
+    const std::string& path, std::size_t chunk_size = 1u << 16);
+
+  /// Append a record to the end of the file.
+  void append(const NamedTuple& record);
+  /// Write all remaining records and assemble the archive.
+  ///
+  /// Throws on i/o errors. The temporary files are always removed and no
+  /// records can be appended afterwards. Does nothing if already closed.
+  void close();
+
+private:
+  // the equivalent std::tuple-like type
+  using Tuple = typename NamedTuple::Tuple;
+  static constexpr std::size_t kNumColumns = std::tuple_size<Tuple>::value;
+
+  std::string m_path;
+  std::array<std::string, kNumColumns> m_column_paths;
+  std::array<std::ofstream, kNumColumns> m_column_files;
+  // buffered data for each column
+  std::array<std::vector<char>, kNumColumns> m_columns;
+  std::size_t m_chunk_size;
+  std::size_t m_num_buffered;
+  std::size_t m_num_tuples;
+
   template<std::size_t... I>
-  void write_record(const NamedTuple& record, std::index_sequence<I...>);
-  template<typename T>
-  void write_bytes(const T* ptr);
+  void append_impl(const NamedTuple& record, std::index_sequence<I...>);
+  void flush();
+  void write_archive();
+  void discard() noexcept;
+};
+
+/// Read records from a binary NumPy-compatible `.npy` file.
+///
+/// The file must contain a one-dimensional array with a structured data type
+/// that matches the named tuple, e.g. as written by `NamedTupleNumpyWriter`.
+/// The file is memory-mapped if possible and records are decoded directly
+/// from the mapped memory.
+template<typename NamedTuple>
+class NamedTupleNumpyReader {
+public:
+  NamedTupleNumpyReader() = delete;
+  NamedTupleNumpyReader(const NamedTupleNumpyReader&) = delete;
+  NamedTupleNumpyReader(NamedTupleNumpyReader&&) = default;
+  ~NamedTupleNumpyReader() = default;
+  NamedTupleNumpyReader& operator=(const NamedTupleNumpyReader&) = delete;
+  NamedTupleNumpyReader& operator=(NamedTupleNumpyReader&&) = default;
+
+  /// Open a npy file at the given path.
+  ///
+  /// \exception std::runtime_error  If the file can not be read or the data
+  ///                                type does not match the named tuple
+  NamedTupleNumpyReader(const std::string& path);
+
+  /// Read the next record from the file.
+  ///
+  /// \returns true   if a record was successfully read
+  /// \returns false  if no more records are available
+  bool read(NamedTuple& record);
+
+  /// Return the total number of records in the file.
+  std::size_t size() const { return m_size; }
+  /// Return the number of records read so far.
+  std::size_t num_records() const { return m_num_records; }
+  /// Return the record at the given index.
+  ///
+  /// \exception std::out_of_range  If the index is invalid
+  NamedTuple at(std::size_t idx) const;
+  /// Return the record at the given index w/o bounds checks.
+  NamedTuple operator[](std::size_t idx) const;
+
+  /// Return the number of bytes of a single packed record on file.
+  static constexpr std::size_t record_size();
+  /// Return a pointer to the packed records.
+  ///
+  /// Records are stored back-to-back w/o any padding and can not be accessed
+  /// as NamedTuple objects directly.
+  const char* data() const { return m_data; }
+
+private:
+  // the equivalent std::tuple-like type
+  using Tuple = typename NamedTuple::Tuple;
+
+  common_impl::MappedFile m_map;
+  // file content if memory-mapping is not available
+  std::vector<char> m_buffer;
+  const char* m_data;
+  std::size_t m_size;
+  std::size_t m_num_records;
 };
 
+/// Write a histogram into a NumPy-compatible `.npz` archive.
+///
+/// \param path       Path to the output file. Overwrites existing data.
+/// \param histogram  Histogram with dense storage, e.g. `dfe::Histogram`
+///
+/// The archive contains the entry values of all bins, including under/overflow
+/// bins, as one n-dimensional array `values` and the bin edges of each axis
+/// as one-dimensional arrays `edges0`, `edges1`, and so on. The bin values
+/// are written directly from the histogram storage in a single block.
+template<typename Histogram>
+void write_histogram_npz(const std::string& path, const Histogram& histogram);
+
 // implementation helpers
 namespace io_npy_impl {
 
@@ -98,12 +299,16 @@ constexpr const char* kNumpyDtypeCode<double> = "f8";
 template<>
 constexpr const char* kNumpyDtypeCode<bool> = "?";
 
+// Dtype codes for all elements of a std::tuple-like type.
+template<typename Tuple>
+struct DtypesCodes;
 template<typename... Types>
-constexpr std::array<const char*, sizeof...(Types)>
-dtypes_codes(const std::tuple<Types...>& t)
-{
-  return {kNumpyDtypeCode<typename std::decay<Types>::type>...};
-}
+struct DtypesCodes<std::tuple<Types...>> {
+  static constexpr std::array<const char*, sizeof...(Types)> value()
+  {
+    return {kNumpyDtypeCode<typename std::decay<Types>::type>...};
+  }
+};
 
 // Determines endianness and return the corresponding dtype code modifier.
 //
@@ -123,14 +328,150 @@ dtype_endianness_modifier()
   return is_little_endian ? '<' : '>';
 }
 
+// Size of a record w/o any padding between the members.
+template<typename Tuple>
+struct PackedSize;
+template<typename... Types>
+struct PackedSize<std::tuple<Types...>> {
+  static constexpr std::size_t value()
+  {
+    std::size_t sizes[] = {0, sizeof(Types)...};
+    std::size_t total = 0;
+    for (auto size : sizes) { total += size; }
+    return total;
+  }
+};
+
+// Write the record members into the output w/o any padding.
+template<typename NamedTuple, std::size_t... I>
+inline void
+pack_record(const NamedTuple& record, char* out, std::index_sequence<I...>)
+{
+  using std::get;
+
+  // see namedtuple_impl::print_tuple for explanation
+  (void)(int[]){
+    0, (std::memcpy(out, &get<I>(record), sizeof(get<I>(record))),
+        out += sizeof(get<I>(record)), 0)...};
+}
+
+// Read the record members from the input w/o any padding.
+template<typename NamedTuple, std::size_t... I>
+inline void
+unpack_record(const char* in, NamedTuple& record, std::index_sequence<I...>)
+{
+  using std::get;
+
+  // see namedtuple_impl::print_tuple for explanation
+  (void)(int[]){
+    0, (std::memcpy(&get<I>(record), in, sizeof(get<I>(record))),
+        in += sizeof(get<I>(record)), 0)...};
+}
+
+// Check if the record members cover the record without any padding.
+//
+// This requires the members to be selected in the definition order and no
+// other members to exist. A packed record has the same memory layout as the
+// on-file data and can be copied as a single block. The member offsets are
+// identical for all records of the same type and are usually computed at
+// compile time after inlining; the record is only needed to compute them
+// without requiring a default constructor.
+template<typename NamedTuple, std::size_t... I>
+inline bool
+is_packed(const NamedTuple& record, std::index_sequence<I...>)
+{
+  using std::get;
+
+  if (not std::is_trivially_copyable<NamedTuple>::value) { return false; }
+  const char* base = reinterpret_cast<const char*>(&record);
+  // leading zero avoids an empty array
+  std::size_t offsets[] = {
+    0, static_cast<std::size_t>(
+         reinterpret_cast<const char*>(&get<I>(record)) - base)...};
+  std::size_t sizes[] = {0, sizeof(get<I>(record))...};
+  std::size_t expected = 0;
+  for (std::size_t i = 1; i <= sizeof...(I); ++i) {
+    if (offsets[i] != expected) { return false; }
+    expected += sizes[i];
+  }
+  return expected == sizeof(NamedTuple);
+}
+template<typename NamedTuple>
+inline bool
+is_packed(const NamedTuple& record)
+{
+  return is_packed(
+    record, std::make_index_sequence<
+              std::tuple_size<typename NamedTuple::Tuple>::value>{});
+}
+
+// Read a single record. Packed records are copied as a single block.
+template<typename NamedTuple>
+inline void
+unpack_record(const char* in, NamedTuple& record)
+{
+  using Tuple = typename NamedTuple::Tuple;
+
+  if (is_packed(record)) {
+    std::memcpy(static_cast<void*>(&record), in, sizeof(NamedTuple));
+  } else {
+    unpack_record(
+      in, record, std::make_index_sequence<std::tuple_size<Tuple>::value>{});
+  }
+}
+
+// Write multiple records one-by-one into the output.
+template<typename Iterator>
+inline Iterator
+pack_each_record(Iterator first, std::size_t n, char* out)
+{
+  using NamedTuple = typename std::decay<decltype(*first)>::type;
+  using Tuple = typename NamedTuple::Tuple;
+  constexpr auto kRecordSize = PackedSize<Tuple>::value();
+  constexpr auto kIndices =
+    std::make_index_sequence<std::tuple_size<Tuple>::value>{};
+
+  for (; 0 < n; --n, ++first, out += kRecordSize) {
+    pack_record(*first, out, kIndices);
+  }
+  return first;
+}
+
+// Write multiple records from a contiguous array into the output.
+//
+// If the record layout is already packed, the array has the same layout as
+// the output and can be copied as a single block.
+template<typename NamedTuple>
+inline const NamedTuple*
+pack_records(const NamedTuple* first, std::size_t n, char* out)
+{
+  using Tuple = typename NamedTuple::Tuple;
+  constexpr auto kRecordSize = PackedSize<Tuple>::value();
+
+  if ((0 < n) and is_packed(*first)) {
+    std::memcpy(out, first, n * kRecordSize);
+    return first + n;
+  }
+  return pack_each_record(first, n, out);
+}
+
+// Write multiple records from an arbitrary iterator into the output.
+template<typename Iterator>
+inline Iterator
+pack_records(Iterator first, std::size_t n, char* out)
+{
+  return pack_each_record(first, n, out);
+}
+
+// The description only depends on the type; no record is needed.
 template<typename NamedTuple>
 inline std::string
-dtypes_description(const NamedTuple& nt)
+dtypes_description()
 {
   std::string descr;
   std::size_t n = std::tuple_size<typename NamedTuple::Tuple>::value;
-  auto names = nt.names();
-  auto codes = dtypes_codes(nt.tuple());
+  const auto& names = NamedTuple::names();
+  auto codes = DtypesCodes<typename NamedTuple::Tuple>::value();
   auto endianness_modifier = dtype_endianness_modifier();
   descr += '[';
   for (decltype(n) i = 0; i < n; ++i) {
@@ -146,15 +487,173 @@ dtypes_description(const NamedTuple& nt)
   return descr;
 }
 
+// Build the file header for an array w/ arbitrary shape.
+//
+// The header is padded w/ spaces to have at least the given size.
+inline std::string
+make_header(
+  const std::string& descr, const std::vector<std::size_t>& shape,
+  bool fortran_order, std::size_t min_size)
+{
+  std::string header;
+  // magic
+  header += "\x93NUMPY";
+  // fixed version number (major, minor), 1byte unsigned each
+  header += static_cast<char>(0x1);
+  header += static_cast<char>(0x0);
+  // placeholder value for the header length, 2byte little endian unsigned
+  header += static_cast<char>(0xAF);
+  header += static_cast<char>(0xFE);
+  // python dict w/ data type and size information
+  header += "{'descr': ";
+  header += descr;
+  header += ", 'fortran_order': ";
+  header += fortran_order ? "True" : "False";
+  header += ", 'shape': (";
+  for (std::size_t i = 0; i < shape.size(); ++i) {
+    if (0 < i) { header += ", "; }
+    header += std::to_string(shape[i]);
+  }
+  // one-element python tuples require a trailing comma
+  if (shape.size() == 1) { header += ','; }
+  header += ")}";
+  // padd w/ spaces for 16 byte alignment of the whole header
+  while (((header.size() + 1) % 16) != 0) { header += ' '; }
+  while ((header.size() + 1) < min_size) { header += ' '; }
+  header += '\n';
+  // replace the header length place holder
+  std::size_t header_length = header.size() - 10;
+  header[8] = static_cast<char>(header_length >> 0);
+  header[9] = static_cast<char>(header_length >> 8);
+  return header;
+}
+
+// Build the file header for a one-dimensional array.
+inline std::string
+make_header(
+  const std::string& descr, std::size_t num_tuples, std::size_t min_size)
+{
+  return make_header(descr, {num_tuples}, false, min_size);
+}
+
+// Append the raw bytes of a value to the output.
+template<typename T>
+inline void
+append_bytes(std::vector<char>& out, const T& x)
+{
+  auto bytes = reinterpret_cast<const char*>(&x);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+// Append an unsigned integer as little endian with the given number of bytes.
+inline void
+append_little_endian(std::string& out, std::uint64_t value, unsigned size)
+{
+  for (unsigned i = 0; i < size; ++i) {
+    out += static_cast<char>((value >> (8 * i)) & 0xFF);
+  }
+}
+
+// Update a CRC-32 checksum, as used by zip, with additional data.
+inline std::uint32_t
+crc32(std::uint32_t crc, const char* data, std::size_t size)
+{
+  static const auto kTable = []() {
+    std::array<std::uint32_t, 256> table;
+    for (std::uint32_t i = 0; i < 256; ++i) {
+      std::uint32_t c = i;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+      }
+      table[i] = c;
+    }
+    return table;
+  }();
+
+  crc = ~crc;
+  for (std::size_t i = 0; i < size; ++i) {
+    crc = kTable[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+// Parse the file header and check the data type description.
+//
+// Only the subset of the format that is needed to store one-dimensional
+// arrays of structured data, e.g. as written by NamedTupleNumpyWriter, is
+// supported. Returns the offset of the array data in the file.
+inline std::size_t
+parse_header(
+  const char* data, std::size_t size, const std::string& descr,
+  std::size_t& num_tuples)
+{
+  // magic and version number are followed by the header length
+  if ((size < 10) or (std::memcmp(data, "\x93NUMPY", 6) != 0)) {
+    throw std::runtime_error("Missing numpy file signature");
+  }
+  auto byte = [=](std::size_t i) {
+    return static_cast<std::size_t>(static_cast<uint8_t>(data[i]));
+  };
+  std::size_t header_start = 0;
+  std::size_t header_length = 0;
+  if (byte(6) == 0x1) {
+    // version 1.0 uses a 2byte little endian unsigned header length
+    header_start = 10;
+    header_length = byte(8) | (byte(9) << 8);
+  } else if (((byte(6) == 0x2) or (byte(6) == 0x3)) and (12 <= size)) {
+    // version 2.0 and 3.0 use a 4byte little endian unsigned header length
+    header_start = 12;
+    header_length =
+      byte(8) | (byte(9) << 8) | (byte(10) << 16) | (byte(11) << 24);
+  } else {
+    throw std::runtime_error(
+      "Unsupported numpy file version " + std::to_string(byte(6)));
+  }
+  if (size < (header_start + header_length)) {
+    throw std::runtime_error("Truncated numpy file header");
+  }
+  std::string header(data + header_start, header_length);
+
+  // the dict keys are always written in this order
+  auto value_of = [&](const char* key) -> std::size_t {
+    auto pos = header.find(key);
+    if (pos == std::string::npos) {
+      throw std::runtime_error(
+        std::string("Missing ") + key + " in numpy file header");
+    }
+    return pos + std::strlen(key);
+  };
+  if (header.compare(value_of("'descr': "), descr.size(), descr) != 0) {
+    throw std::runtime_error("Inconsistent data type in numpy file header");
+  }
+  if (header.compare(value_of("'fortran_order': "), 5, "False") != 0) {
+    throw std::runtime_error("Unsupported fortran order in numpy file");
+  }
+  // only one-dimensional shapes of the form '(<n>,)' are supported
+  auto pos = value_of("'shape': (");
+  auto end = pos;
+  num_tuples = 0;
+  while ((end < header.size()) and ('0' <= header[end]) and
+         (header[end] <= '9')) {
+    num_tuples = 10 * num_tuples + (header[end] - '0');
+    end += 1;
+  }
+  if ((end == pos) or (header.compare(end, 2, ",)") != 0)) {
+    throw std::runtime_error("Unsupported array shape in numpy file");
+  }
+  return header_start + header_length;
+}
+
 } // namespace io_npy_impl
 
-// implementation
+// implementation writer
 
 template<typename NamedTuple>
 inline NamedTupleNumpyWriter<NamedTuple>::NamedTupleNumpyWriter(
-  const std::string& path)
+  const std::string& path, std::size_t buffer_size)
   : m_fixed_header_length(0)
   , m_num_tuples(0)
+  , m_buffer_size(buffer_size)
 {
   // make our life easier. always throw on error
   m_file.exceptions(std::ofstream::badbit | std::ofstream::failbit);
@@ -165,82 +664,564 @@ inline NamedTupleNumpyWriter<NamedTuple>::NamedTupleNumpyWriter(
   // overwrite it w/ the actual number of tuples at closing time.
   write_header(SIZE_MAX);
   write_header(0);
+  m_buffer.reserve(m_buffer_size);
 }
 
 template<typename NamedTuple>
 inline NamedTupleNumpyWriter<NamedTuple>::~NamedTupleNumpyWriter()
 {
-  if (!m_file.is_open()) { return; }
-  write_header(m_num_tuples);
-  m_file.close();
+  // errors can not be reported from here; use close() to see them
+  try {
+    close();
+  } catch (...) {
+  }
+}
+
+template<typename NamedTuple>
+inline NamedTupleNumpyWriter<NamedTuple>&
+NamedTupleNumpyWriter<NamedTuple>::operator=(NamedTupleNumpyWriter&& other)
+{
+  // buffered records must not be lost when replacing the file
+  if (this != &other) {
+    close();
+    m_file = std::move(other.m_file);
+    m_fixed_header_length = other.m_fixed_header_length;
+    m_num_tuples = other.m_num_tuples;
+    m_buffer = std::move(other.m_buffer);
+    m_buffer_size = other.m_buffer_size;
+    other.m_buffer.clear();
+  }
+  return *this;
+}
+
+template<typename NamedTuple>
+inline void
+NamedTupleNumpyWriter<NamedTuple>::close()
+{
+  // closed and moved-from writers have no open file
+  if (not m_file.is_open()) { return; }
+  try {
+    // header must only be updated after all records are on file
+    flush();
+    write_header(m_num_tuples);
+    m_file.close();
+  } catch (...) {
+    // closing must not throw again even if the stream is in a failed state
+    m_file.exceptions(std::ofstream::goodbit);
+    m_file.close();
+    m_buffer.clear();
+    throw;
+  }
 }
 
 template<typename NamedTuple>
 inline void
 NamedTupleNumpyWriter<NamedTuple>::append(const NamedTuple& record)
 {
-  write_record(
-    record, std::make_index_sequence<std::tuple_size<Tuple>::value>{});
-  m_num_tuples += 1;
+  append_n(&record, 1);
+}
+
+template<typename NamedTuple>
+inline void
+NamedTupleNumpyWriter<NamedTuple>::append(
+  const NamedTuple* first, std::size_t n)
+{
+  append_n(first, n);
+}
+
+template<typename NamedTuple>
+template<typename Iterator>
+inline void
+NamedTupleNumpyWriter<NamedTuple>::append(Iterator first, Iterator last)
+{
+  append_n(first, std::distance(first, last));
+}
+
+template<typename NamedTuple>
+inline void
+NamedTupleNumpyWriter<NamedTuple>::flush()
+{
+  m_file.write(m_buffer.data(), m_buffer.size());
+  // keeps the allocated memory for the next records
+  m_buffer.clear();
+}
+
+template<typename NamedTuple>
+template<typename Iterator>
+inline void
+NamedTupleNumpyWriter<NamedTuple>::append_n(Iterator first, std::size_t n)
+{
+  constexpr auto kRecordSize = io_npy_impl::PackedSize<Tuple>::value();
+
+  while (0 < n) {
+    // fill the buffer up to its nominal size but with at least one record
+    std::size_t available = 0;
+    if (m_buffer.size() < m_buffer_size) {
+      available = (m_buffer_size - m_buffer.size()) / kRecordSize;
+    }
+    std::size_t num_packed = std::min(n, std::max<std::size_t>(available, 1));
+    // resize only once for all packed records
+    std::size_t offset = m_buffer.size();
+    m_buffer.resize(offset + num_packed * kRecordSize);
+    first = io_npy_impl::pack_records(
+      first, num_packed, m_buffer.data() + offset);
+    m_num_tuples += num_packed;
+    n -= num_packed;
+    if (m_buffer_size <= m_buffer.size()) { flush(); }
+  }
 }
 
 template<typename NamedTuple>
 inline void
 NamedTupleNumpyWriter<NamedTuple>::write_header(std::size_t num_tuples)
 {
-  std::string header;
-  // magic
-  header += "\x93NUMPY";
-  // fixed version number (major, minor), 1byte unsigned each
-  header += static_cast<char>(0x1);
-  header += static_cast<char>(0x0);
-  // placeholder value for the header length, 2byte little endian unsigned
-  header += static_cast<char>(0xAF);
-  header += static_cast<char>(0xFE);
-  // python dict w/ data type and size information
-  header += "{'descr': ";
-  header += io_npy_impl::dtypes_description(NamedTuple());
-  header += ", 'fortran_order': False";
-  header += ", 'shape': (";
-  header += std::to_string(num_tuples);
-  header += ",)}";
-  // padd w/ spaces for 16 byte alignment of the whole header
-  while (((header.size() + 1) % 16) != 0) { header += ' '; }
   // the initial header fixes the available header size. updated headers
   // must always occupy the same space and might require additional
   // padding spaces
-  if (m_fixed_header_length == 0) {
-    m_fixed_header_length = header.size();
-  } else {
-    while (header.size() < m_fixed_header_length) { header += ' '; }
-  }
-  header += '\n';
-  // replace the header length place holder
-  std::size_t header_length = header.size() - 10;
-  header[8] = static_cast<char>(header_length >> 0);
-  header[9] = static_cast<char>(header_length >> 8);
+  auto header = io_npy_impl::make_header(
+    io_npy_impl::dtypes_description<NamedTuple>(), num_tuples,
+    m_fixed_header_length);
+  if (m_fixed_header_length == 0) { m_fixed_header_length = header.size(); }
   m_file.seekp(0);
   m_file.write(header.data(), header.size());
 }
 
+// implementation zip writer
+
+namespace io_npy_impl {
+
+// all sizes and offsets above this limit require zip64 extensions
+constexpr std::uint64_t kZipLimit = 0xFFFFFFFFu;
+
+inline ZipWriter::ZipWriter(const std::string& path)
+{
+  // make our life easier. always throw on error
+  m_file.exceptions(std::ofstream::badbit | std::ofstream::failbit);
+  m_file.open(
+    path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+}
+
+inline void
+ZipWriter::begin_entry(const std::string& name, std::uint64_t size)
+{
+  bool is_zip64 = (kZipLimit <= size);
+
+  m_entries.push_back({name, size, m_offset, 0});
+  m_written = 0;
+  m_crc = 0;
+
+  std::string header;
+  // local file header signature
+  append_little_endian(header, 0x04034b50u, 4);
+  // version needed to extract, general purpose flags
+  append_little_endian(header, is_zip64 ? 45 : 20, 2);
+  append_little_endian(header, 0, 2);
+  // compression method (stored), fixed modification time and date
+  append_little_endian(header, 0, 2);
+  append_little_endian(header, 0, 2);
+  append_little_endian(header, (1 << 5) | 1, 2);
+  // crc-32 placeholder, compressed and uncompressed size
+  append_little_endian(header, 0, 4);
+  append_little_endian(header, is_zip64 ? kZipLimit : size, 4);
+  append_little_endian(header, is_zip64 ? kZipLimit : size, 4);
+  // file name and extra field length
+  append_little_endian(header, name.size(), 2);
+  append_little_endian(header, is_zip64 ? 20 : 0, 2);
+  header += name;
+  if (is_zip64) {
+    // zip64 extended information w/ uncompressed and compressed size
+    append_little_endian(header, 0x0001, 2);
+    append_little_endian(header, 16, 2);
+    append_little_endian(header, size, 8);
+    append_little_endian(header, size, 8);
+  }
+  m_file.write(header.data(), header.size());
+  m_offset += header.size();
+}
+
+inline void
+ZipWriter::write(const char* data, std::size_t size)
+{
+  m_file.write(data, size);
+  m_crc = crc32(m_crc, data, size);
+  m_written += size;
+  m_offset += size;
+}
+
+inline void
+ZipWriter::end_entry()
+{
+  auto& entry = m_entries.back();
+  if (m_written != entry.size) {
+    throw std::runtime_error("Inconsistent size for zip entry " + entry.name);
+  }
+  entry.crc = m_crc;
+  // the checksum is only known now and must be updated in the local header
+  std::string crc;
+  append_little_endian(crc, entry.crc, 4);
+  m_file.seekp(entry.offset + 14);
+  m_file.write(crc.data(), crc.size());
+  m_file.seekp(m_offset);
+}
+
+inline void
+ZipWriter::close()
+{
+  std::string directory;
+  for (const auto& entry : m_entries) {
+    bool large_size = (kZipLimit <= entry.size);
+    bool large_offset = (kZipLimit <= entry.offset);
+    unsigned extra_size = (large_size ? 16 : 0) + (large_offset ? 8 : 0);
+    unsigned version = (0 < extra_size) ? 45 : 20;
+    // central directory file header signature
+    append_little_endian(directory, 0x02014b50u, 4);
+    // version made by, version needed to extract, general purpose flags
+    append_little_endian(directory, version, 2);
+    append_little_endian(directory, version, 2);
+    append_little_endian(directory, 0, 2);
+    // compression method (stored), fixed modification time and date
+    append_little_endian(directory, 0, 2);
+    append_little_endian(directory, 0, 2);
+    append_little_endian(directory, (1 << 5) | 1, 2);
+    // crc-32, compressed and uncompressed size
+    append_little_endian(directory, entry.crc, 4);
+    append_little_endian(directory, large_size ? kZipLimit : entry.size, 4);
+    append_little_endian(directory, large_size ? kZipLimit : entry.size, 4);
+    // file name, extra field, and file comment length
+    append_little_endian(directory, entry.name.size(), 2);
+    append_little_endian(directory, (0 < extra_size) ? (4 + extra_size) : 0, 2);
+    append_little_endian(directory, 0, 2);
+    // disk number start, internal and external file attributes
+    append_little_endian(directory, 0, 2);
+    append_little_endian(directory, 0, 2);
+    append_little_endian(directory, 0, 4);
+    // relative offset of the local header
+    append_little_endian(
+      directory, large_offset ? kZipLimit : entry.offset, 4);
+    directory += entry.name;
+    if (0 < extra_size) {
+      // zip64 extended information w/ only the fields that overflow
+      append_little_endian(directory, 0x0001, 2);
+      append_little_endian(directory, extra_size, 2);
+      if (large_size) {
+        append_little_endian(directory, entry.size, 8);
+        append_little_endian(directory, entry.size, 8);
+      }
+      if (large_offset) { append_little_endian(directory, entry.offset, 8); }
+    }
+  }
+
+  std::uint64_t directory_offset = m_offset;
+  std::uint64_t directory_size = directory.size();
+  std::uint64_t num_entries = m_entries.size();
+  bool is_zip64 = (0xFFFF <= num_entries) or
+                  (kZipLimit <= directory_offset) or
+                  (kZipLimit <= directory_size);
+  if (is_zip64) {
+    std::uint64_t record_offset = directory_offset + directory_size;
+    // zip64 end of central directory record w/o the leading 12 bytes
+    append_little_endian(directory, 0x06064b50u, 4);
+    append_little_endian(directory, 44, 8);
+    append_little_endian(directory, 45, 2);
+    append_little_endian(directory, 45, 2);
+    append_little_endian(directory, 0, 4);
+    append_little_endian(directory, 0, 4);
+    append_little_endian(directory, num_entries, 8);
+    append_little_endian(directory, num_entries, 8);
+    append_little_endian(directory, directory_size, 8);
+    append_little_endian(directory, directory_offset, 8);
+    // zip64 end of central directory locator
+    append_little_endian(directory, 0x07064b50u, 4);
+    append_little_endian(directory, 0, 4);
+    append_little_endian(directory, record_offset, 8);
+    append_little_endian(directory, 1, 4);
+  }
+  // end of central directory record
+  append_little_endian(directory, 0x06054b50u, 4);
+  append_little_endian(directory, 0, 2);
+  append_little_endian(directory, 0, 2);
+  append_little_endian(directory, std::min<uint64_t>(num_entries, 0xFFFF), 2);
+  append_little_endian(directory, std::min<uint64_t>(num_entries, 0xFFFF), 2);
+  append_little_endian(directory, std::min(directory_size, kZipLimit), 4);
+  append_little_endian(directory, std::min(directory_offset, kZipLimit), 4);
+  append_little_endian(directory, 0, 2);
+  m_file.write(directory.data(), directory.size());
+  m_file.close();
+  m_entries.clear();
+  m_offset = 0;
+}
+
+} // namespace io_npy_impl
+
+// implementation column writer
+
+template<typename NamedTuple>
+inline NamedTupleNumpyColumnWriter<NamedTuple>::NamedTupleNumpyColumnWriter(
+  const std::string& path, std::size_t chunk_size)
+  : m_path(path)
+  , m_chunk_size(std::max<std::size_t>(chunk_size, 1))
+  , m_num_buffered(0)
+  , m_num_tuples(0)
+{
+  auto names = NamedTuple::names();
+  for (std::size_t i = 0; i < kNumColumns; ++i) {
+    m_column_paths[i] = m_path + '.' + names[i] + ".tmp";
+    // make our life easier. always throw on error
+    m_column_files[i].exceptions(
+      std::ofstream::badbit | std::ofstream::failbit);
+    m_column_files[i].open(
+      m_column_paths[i],
+      std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+  }
+  // ensure the output file is writable before data is added
+  std::ofstream file;
+  file.exceptions(std::ofstream::badbit | std::ofstream::failbit);
+  file.open(
+    path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+}
+
+template<typename NamedTuple>
+inline NamedTupleNumpyColumnWriter<NamedTuple>::~NamedTupleNumpyColumnWriter()
+{
+  // errors can not be reported from here; use close() to see them
+  try {
+    close();
+  } catch (...) {
+  }
+}
+
+template<typename NamedTuple>
+inline void
+NamedTupleNumpyColumnWriter<NamedTuple>::close()
+{
+  // closed and moved-from writers have no open files
+  if (not m_column_files[0].is_open()) { return; }
+  try {
+    flush();
+    write_archive();
+  } catch (...) {
+    discard();
+    throw;
+  }
+}
+
+template<typename NamedTuple>
+inline void
+NamedTupleNumpyColumnWriter<NamedTuple>::append(const NamedTuple& record)
+{
+  append_impl(record, std::make_index_sequence<kNumColumns>{});
+  m_num_buffered += 1;
+  m_num_tuples += 1;
+  if (m_chunk_size <= m_num_buffered) { flush(); }
+}
+
 template<typename NamedTuple>
 template<std::size_t... I>
 inline void
-NamedTupleNumpyWriter<NamedTuple>::write_record(
+NamedTupleNumpyColumnWriter<NamedTuple>::append_impl(
   const NamedTuple& record, std::index_sequence<I...>)
 {
   using std::get;
 
   // see namedtuple_impl::print_tuple for explanation
-  (void)(int[]){0, (write_bytes(&get<I>(record)), 0)...};
+  (void)(int[]){0, (io_npy_impl::append_bytes(m_columns[I], get<I>(record)),
+                    0)...};
+}
+
+template<typename NamedTuple>
+inline void
+NamedTupleNumpyColumnWriter<NamedTuple>::flush()
+{
+  for (std::size_t i = 0; i < kNumColumns; ++i) {
+    m_column_files[i].write(m_columns[i].data(), m_columns[i].size());
+    // keeps the allocated memory for the next records
+    m_columns[i].clear();
+  }
+  m_num_buffered = 0;
+}
+
+template<typename NamedTuple>
+inline void
+NamedTupleNumpyColumnWriter<NamedTuple>::write_archive()
+{
+  const auto& names = NamedTuple::names();
+  auto codes = io_npy_impl::DtypesCodes<Tuple>::value();
+  auto endianness_modifier = io_npy_impl::dtype_endianness_modifier();
+  std::vector<char> chunk(1u << 20);
+
+  io_npy_impl::ZipWriter archive(m_path);
+  for (std::size_t i = 0; i < kNumColumns; ++i) {
+    std::uint64_t data_size = m_column_files[i].tellp();
+    m_column_files[i].close();
+
+    std::string descr;
+    descr += '\'';
+    descr += endianness_modifier;
+    descr += codes[i];
+    descr += '\'';
+    auto header = io_npy_impl::make_header(descr, m_num_tuples, 0);
+
+    archive.begin_entry(names[i] + ".npy", header.size() + data_size);
+    archive.write(header.data(), header.size());
+    // copy the column data in fixed-size chunks
+    std::ifstream column;
+    column.exceptions(std::ifstream::badbit);
+    column.open(m_column_paths[i], std::ios_base::binary | std::ios_base::in);
+    while (column.read(chunk.data(), chunk.size()) or (0 < column.gcount())) {
+      archive.write(chunk.data(), column.gcount());
+    }
+    column.close();
+    archive.end_entry();
+    std::remove(m_column_paths[i].c_str());
+  }
+  archive.close();
+}
+
+template<typename NamedTuple>
+inline void
+NamedTupleNumpyColumnWriter<NamedTuple>::discard() noexcept
+{
+  for (std::size_t i = 0; i < kNumColumns; ++i) {
+    // closing must not throw even if the stream is in a failed state
+    m_column_files[i].exceptions(std::ofstream::goodbit);
+    m_column_files[i].close();
+    std::remove(m_column_paths[i].c_str());
+  }
+}
+
+// implementation reader
+
+template<typename NamedTuple>
+inline NamedTupleNumpyReader<NamedTuple>::NamedTupleNumpyReader(
+  const std::string& path)
+  : m_data(nullptr)
+  , m_size(0)
+  , m_num_records(0)
+{
+  const char* content = nullptr;
+  std::size_t content_size = 0;
+  if (m_map.open(path)) {
+    content = m_map.data();
+    content_size = m_map.size();
+  } else {
+    // fall back to reading the complete file into memory
+    std::ifstream file(path, std::ios_base::binary | std::ios_base::in);
+    if (not file.is_open() or file.fail()) {
+      throw std::runtime_error("Could not open file '" + path + "'");
+    }
+    m_buffer.assign(
+      std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    content = m_buffer.data();
+    content_size = m_buffer.size();
+  }
+  auto offset = io_npy_impl::parse_header(
+    content, content_size, io_npy_impl::dtypes_description<NamedTuple>(),
+    m_size);
+  if ((content_size - offset) < (m_size * record_size())) {
+    throw std::runtime_error("Truncated numpy file data in '" + path + "'");
+  }
+  m_data = content + offset;
+}
+
+template<typename NamedTuple>
+inline bool
+NamedTupleNumpyReader<NamedTuple>::read(NamedTuple& record)
+{
+  if (m_size <= m_num_records) { return false; }
+  io_npy_impl::unpack_record(m_data + m_num_records * record_size(), record);
+  m_num_records += 1;
+  return true;
+}
+
+template<typename NamedTuple>
+inline NamedTuple
+NamedTupleNumpyReader<NamedTuple>::at(std::size_t idx) const
+{
+  if (m_size <= idx) {
+    throw std::out_of_range("Invalid record index " + std::to_string(idx));
+  }
+  return (*this)[idx];
 }
 
 template<typename NamedTuple>
+inline NamedTuple
+NamedTupleNumpyReader<NamedTuple>::operator[](std::size_t idx) const
+{
+  NamedTuple record;
+  io_npy_impl::unpack_record(m_data + idx * record_size(), record);
+  return record;
+}
+
+template<typename NamedTuple>
+constexpr std::size_t
+NamedTupleNumpyReader<NamedTuple>::record_size()
+{
+  return io_npy_impl::PackedSize<Tuple>::value();
+}
+
+// implementation histogram writer
+
+namespace io_npy_impl {
+
+// Write a complete npy file for a plain array as a single archive entry.
 template<typename T>
 inline void
-NamedTupleNumpyWriter<NamedTuple>::write_bytes(const T* ptr)
+write_array_entry(
+  ZipWriter& archive, const std::string& name, const T* data,
+  const std::vector<std::size_t>& shape, bool fortran_order)
+{
+  std::string descr;
+  descr += '\'';
+  descr += dtype_endianness_modifier();
+  descr += kNumpyDtypeCode<T>;
+  descr += '\'';
+  auto header = make_header(descr, shape, fortran_order, 0);
+  std::size_t data_size = sizeof(T);
+  for (auto n : shape) { data_size *= n; }
+
+  archive.begin_entry(name + ".npy", header.size() + data_size);
+  archive.write(header.data(), header.size());
+  archive.write(reinterpret_cast<const char*>(data), data_size);
+  archive.end_entry();
+}
+
+template<typename T>
+inline void
+write_edges_entry(
+  ZipWriter& archive, std::size_t axis, const std::vector<T>& edges)
+{
+  write_array_entry(
+    archive, "edges" + std::to_string(axis), edges.data(), {edges.size()},
+    false);
+}
+
+template<typename Histogram, std::size_t... I>
+inline void
+write_histogram_entries(
+  ZipWriter& archive, const Histogram& histogram, std::index_sequence<I...>)
 {
-  m_file.write(reinterpret_cast<const char*>(ptr), sizeof(T));
+  const auto& size = histogram.size();
+  // histogram storage is column-major, i.e. the first index is contiguous
+  write_array_entry(
+    archive, "values", histogram.data(), {size.begin(), size.end()}, true);
+  // see namedtuple_impl::print_tuple for explanation
+  (void)(int[]){
+    0, (write_edges_entry(archive, I, histogram.template axis<I>().edges()),
+        0)...};
+}
+
+} // namespace io_npy_impl
+
+template<typename Histogram>
+inline void
+write_histogram_npz(const std::string& path, const Histogram& histogram)
+{
+  using Index = typename Histogram::Index;
+
+  io_npy_impl::ZipWriter archive(path);
+  io_npy_impl::write_histogram_entries(
+    archive, histogram, std::make_index_sequence<std::tuple_size<Index>{}>());
+  archive.close();
 }
 
 } // namespace dfe
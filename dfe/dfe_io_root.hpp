@@ -25,17 +25,52 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <stdexcept>
 #include <string>
 #include <tuple>
 #include <type_traits>
 
+#include <TBranch.h>
 #include <TFile.h>
+#include <TROOT.h>
 #include <TTree.h>
 
 namespace dfe {
 
+/// Storage options for the ROOT TTree writer.
+///
+/// Negative values for the compression settings keep the defaults defined by
+/// the output file or the ROOT installation.
+struct NamedTupleRootWriterOptions {
+  /// Size of the in-memory buffer (basket) for each branch in bytes.
+  ///
+  /// Very small values are increased to the minimum size supported by ROOT.
+  Int_t basket_size = 32000;
+  /// Cluster size; positive for number of entries, negative for bytes.
+  Long64_t auto_flush = -30000000;
+  /// Compression algorithm, e.g. ROOT::RCompressionSetting::EAlgorithm::kLZ4.
+  Int_t compression_algorithm = -1;
+  /// Compression level, zero disables compression.
+  Int_t compression_level = -1;
+};
+
+/// Read options for the ROOT TTree reader.
+struct NamedTupleRootReaderOptions {
+  /// First entry to read.
+  Long64_t entry_begin = 0;
+  /// One past the last entry to read; negative to read until the end.
+  Long64_t entry_end = -1;
+  /// Size of the read-ahead cache in bytes; negative for the ROOT default and
+  /// zero to disable the cache.
+  Long64_t cache_size = -1;
+  /// Decompress baskets of different branches in parallel.
+  ///
+  /// This enables ROOT implicit multi-threading for the whole process.
+  bool implicit_mt = false;
+};
+
 /// Write records into a ROOT TTree.
 template<typename NamedTuple>
 class NamedTupleRootWriter {
@@ -50,31 +85,55 @@ public:
   ///
   /// \param path       Path to the output file
   /// \param tree_name  Name of the output tree within the file
-  NamedTupleRootWriter(const std::string& path, const std::string& tree_name);
+  /// \param options    Basket, cluster, and compression settings
+  NamedTupleRootWriter(
+    const std::string& path, const std::string& tree_name,
+    const NamedTupleRootWriterOptions& options = {});
   /// Create a tree in a ROOT directory. Overwrites existing data.
   ///
   /// \param dir        Output directory for the tree
   /// \param tree_name  Name of the output tree relative to the directory
+  /// \param options    Basket, cluster, and compression settings
   ///
   /// When the writer is created with an existing ROOT directory, the user
   /// is responsible for ensuring the underlying file is closed.
-  NamedTupleRootWriter(TDirectory* dir, const std::string& tree_name);
+  NamedTupleRootWriter(
+    TDirectory* dir, const std::string& tree_name,
+    const NamedTupleRootWriterOptions& options = {});
   /// Write the tree and close the owned file.
   ~NamedTupleRootWriter();
 
   /// Append a record to the file.
   void append(const NamedTuple& record);
+  /// Append all records in the range `[first, last)`.
+  template<typename Iterator>
+  void append(Iterator first, Iterator last);
 
 private:
   // the equivalent std::tuple-like type
   using Tuple = typename NamedTuple::Tuple;
 
+  static constexpr std::size_t kNumBranches = std::tuple_size<Tuple>::value;
+
   TFile* m_file;
   TTree* m_tree;
+  // staging data for records that are not bound directly
   Tuple m_data;
+  std::array<TBranch*, kNumBranches> m_branches;
+  // data that the branches are currently pointing to
+  const void* m_bound;
+  // most recently appended record
+  const NamedTuple* m_last;
 
   template<std::size_t... I>
   void setup_branches(std::index_sequence<I...>);
+  void setup_options(const NamedTupleRootWriterOptions& options);
+  template<typename Values>
+  void bind(const Values& values);
+  template<typename Values, std::size_t... I>
+  void bind_branches(const Values& values, std::index_sequence<I...>);
+  void append_staged(const NamedTuple& record);
+  void fill_entry();
 };
 
 /// Read records from a ROOT TTree.
@@ -91,15 +150,21 @@ public:
   ///
   /// \param path       Path to the input file
   /// \param tree_name  Name of the input tree within the file
-  NamedTupleRootReader(const std::string& path, const std::string& tree_name);
+  /// \param options    Entry range, cache, and threading settings
+  NamedTupleRootReader(
+    const std::string& path, const std::string& tree_name,
+    const NamedTupleRootReaderOptions& options = {});
   /// Open a tree from a ROOT directory.
   ///
   /// \param dir        Input directory for the tree
   /// \param tree_name  Name of the input tree relative to the directory
+  /// \param options    Entry range, cache, and threading settings
   ///
   /// When the reader is created with an existing ROOT directory, the user
   /// is responsible for ensuring the underlying file is closed.
-  NamedTupleRootReader(TDirectory* dir, const std::string& tree_name);
+  NamedTupleRootReader(
+    TDirectory* dir, const std::string& tree_name,
+    const NamedTupleRootReaderOptions& options = {});
   /// Write the tree and close the owned file.
   ~NamedTupleRootReader();
 
@@ -107,44 +172,83 @@ public:
   ///
   /// \returns true   if a record was successfully read
   /// \returns false  if no more records are available
+  ///
+  /// The data is read directly into the given record w/o intermediate
+  /// copies. Reading repeatedly into the same record is the fastest option.
   bool read(NamedTuple& record);
+  /// Read up to n records into the given buffer.
+  ///
+  /// \returns Number of records that were read
+  std::size_t read(NamedTuple* records, std::size_t n);
+
+  /// Return the number of entries in the selected entry range.
+  std::size_t size() const { return m_end - m_begin; }
+  /// Return the number of records read so far.
+  std::size_t num_records() const { return m_next - m_begin; }
 
 private:
   // the equivalent std::tuple-like type
   using Tuple = typename NamedTuple::Tuple;
+  static constexpr std::size_t kNumBranches = std::tuple_size<Tuple>::value;
 
   TFile* m_file;
   TTree* m_tree;
+  int64_t m_begin;
+  int64_t m_end;
   int64_t m_next;
+  // staging data for batch reads; also used to check the branch types
   Tuple m_data;
+  std::array<TBranch*, kNumBranches> m_branches;
+  // data that the branches are currently pointing to
+  const void* m_bound;
 
   template<std::size_t... I>
   void setup_branches(std::index_sequence<I...>);
+  void setup_options(const NamedTupleRootReaderOptions& options);
+  template<typename Values, std::size_t... I>
+  void bind_branches(Values& values, std::index_sequence<I...>);
+  template<typename Values>
+  void read_entry(Values& values);
 };
 
 // implementation writer
 
 template<typename NamedTuple>
 inline NamedTupleRootWriter<NamedTuple>::NamedTupleRootWriter(
-  const std::string& path, const std::string& tree_name)
+  const std::string& path, const std::string& tree_name,
+  const NamedTupleRootWriterOptions& options)
   : m_file(new TFile(path.c_str(), "RECREATE"))
   , m_tree(new TTree(tree_name.c_str(), "", 99, m_file))
+  , m_bound(&m_data)
+  , m_last(nullptr)
 {
   if (not m_file) { throw std::runtime_error("Could not create file"); }
   if (not m_file->IsOpen()) { throw std::runtime_error("Could not open file"); }
   if (not m_tree) { throw std::runtime_error("Could not create tree"); }
-  setup_branches(std::make_index_sequence<std::tuple_size<Tuple>::value>());
+  // file-level settings apply to all other objects, e.g. the tree header
+  if (0 <= options.compression_algorithm) {
+    m_file->SetCompressionAlgorithm(options.compression_algorithm);
+  }
+  if (0 <= options.compression_level) {
+    m_file->SetCompressionLevel(options.compression_level);
+  }
+  setup_branches(std::make_index_sequence<kNumBranches>());
+  setup_options(options);
 }
 
 template<typename NamedTuple>
 inline NamedTupleRootWriter<NamedTuple>::NamedTupleRootWriter(
-  TDirectory* dir, const std::string& tree_name)
+  TDirectory* dir, const std::string& tree_name,
+  const NamedTupleRootWriterOptions& options)
   : m_file(nullptr) // no file since it is not owned by the writer
   , m_tree(new TTree(tree_name.c_str(), "", 99, dir))
+  , m_bound(&m_data)
+  , m_last(nullptr)
 {
   if (not dir) { throw std::runtime_error("Invalid output directory given"); }
   if (not m_tree) { throw std::runtime_error("Could not create tree"); }
-  setup_branches(std::make_index_sequence<std::tuple_size<Tuple>::value>());
+  setup_branches(std::make_index_sequence<kNumBranches>());
+  setup_options(options);
 }
 
 namespace namedtuple_root_impl {
@@ -215,10 +319,29 @@ NamedTupleRootWriter<NamedTuple>::setup_branches(std::index_sequence<I...>)
   // the documentation suggests that ROOT can figure out the branch types on
   // its own, but doing so seems to break for {u}int64_t. do it manually for
   // now.
-  (void)std::array<TBranch*, sizeof...(I)>{m_tree->Branch(
+  m_branches = {m_tree->Branch(
     names[I].c_str(), &std::get<I>(m_data), leafs[I].c_str())...};
 }
 
+template<typename NamedTuple>
+inline void
+NamedTupleRootWriter<NamedTuple>::setup_options(
+  const NamedTupleRootWriterOptions& options)
+{
+  // ROOT already enforces a minimum basket size
+  for (auto* branch : m_branches) {
+    if (not branch) { throw std::runtime_error("Could not create branch"); }
+    branch->SetBasketSize(options.basket_size);
+    if (0 <= options.compression_algorithm) {
+      branch->SetCompressionAlgorithm(options.compression_algorithm);
+    }
+    if (0 <= options.compression_level) {
+      branch->SetCompressionLevel(options.compression_level);
+    }
+  }
+  m_tree->SetAutoFlush(options.auto_flush);
+}
+
 template<typename NamedTuple>
 inline NamedTupleRootWriter<NamedTuple>::~NamedTupleRootWriter()
 {
@@ -235,39 +358,110 @@ template<typename NamedTuple>
 inline void
 NamedTupleRootWriter<NamedTuple>::append(const NamedTuple& record)
 {
-  m_data = record;
+  // rebinding all branches costs more than a copy. only records that are
+  // appended repeatedly from the same address, e.g. a record that is reused
+  // in a loop, are bound directly. all others go through the staging data.
+  if (&record == m_last) {
+    bind(record);
+    fill_entry();
+  } else {
+    append_staged(record);
+  }
+  m_last = &record;
+}
+
+template<typename NamedTuple>
+template<typename Iterator>
+inline void
+NamedTupleRootWriter<NamedTuple>::append(Iterator first, Iterator last)
+{
+  // every element has a different address; always use the staging data
+  for (; first != last; ++first) { append_staged(*first); }
+  m_last = nullptr;
+}
+
+template<typename NamedTuple>
+inline void
+NamedTupleRootWriter<NamedTuple>::append_staged(const NamedTuple& record)
+{
+  bind(m_data);
+  m_data = record.tie();
+  fill_entry();
+}
+
+template<typename NamedTuple>
+inline void
+NamedTupleRootWriter<NamedTuple>::fill_entry()
+{
   if (m_tree->Fill() == -1) {
     throw std::runtime_error("Could not fill an entry");
   }
 }
 
+template<typename NamedTuple>
+template<typename Values>
+inline void
+NamedTupleRootWriter<NamedTuple>::bind(const Values& values)
+{
+  // rebinding the branches is only required if the source changes
+  if (m_bound != &values) {
+    bind_branches(values, std::make_index_sequence<kNumBranches>());
+  }
+}
+
+template<typename NamedTuple>
+template<typename Values, std::size_t... I>
+inline void
+NamedTupleRootWriter<NamedTuple>::bind_branches(
+  const Values& values, std::index_sequence<I...>)
+{
+  using std::get;
+
+  // branches only read from the address when filling
+  (void)(int[]){
+    0, (m_branches[I]->SetAddress(const_cast<void*>(
+          static_cast<const void*>(&get<I>(values)))),
+        0)...};
+  m_bound = &values;
+}
+
 // implementation reader
 
 template<typename NamedTuple>
 inline NamedTupleRootReader<NamedTuple>::NamedTupleRootReader(
-  const std::string& path, const std::string& tree_name)
+  const std::string& path, const std::string& tree_name,
+  const NamedTupleRootReaderOptions& options)
   : m_file(new TFile(path.c_str(), "READ"))
   , m_tree(nullptr)
+  , m_begin(0)
+  , m_end(0)
   , m_next(0)
+  , m_bound(nullptr)
 {
   if (not m_file) { throw std::runtime_error("Could not open file"); }
   if (not m_file->IsOpen()) { throw std::runtime_error("Could not open file"); }
   m_tree = static_cast<TTree*>(m_file->Get(tree_name.c_str()));
   if (not m_tree) { throw std::runtime_error("Could not read tree"); }
-  setup_branches(std::make_index_sequence<std::tuple_size<Tuple>::value>());
+  setup_branches(std::make_index_sequence<kNumBranches>());
+  setup_options(options);
 }
 
 template<typename NamedTuple>
 inline NamedTupleRootReader<NamedTuple>::NamedTupleRootReader(
-  TDirectory* dir, const std::string& tree_name)
+  TDirectory* dir, const std::string& tree_name,
+  const NamedTupleRootReaderOptions& options)
   : m_file(nullptr) // no file since it is not owned by the writer
   , m_tree(nullptr)
+  , m_begin(0)
+  , m_end(0)
   , m_next(0)
+  , m_bound(nullptr)
 {
   if (not dir) { throw std::runtime_error("Invalid input directory given"); }
   m_tree = static_cast<TTree*>(dir->Get(tree_name.c_str()));
   if (not m_tree) { throw std::runtime_error("Could not read tree"); }
-  setup_branches(std::make_index_sequence<std::tuple_size<Tuple>::value>());
+  setup_branches(std::make_index_sequence<kNumBranches>());
+  setup_options(options);
 }
 
 namespace io_root_impl {
@@ -314,9 +508,51 @@ NamedTupleRootReader<NamedTuple>::setup_branches(std::index_sequence<I...>)
 
   // construct leaf names w/ type info
   std::array<std::string, sizeof...(I)> names = NamedTuple::names();
-  // construct branches
-  (void)std::array<Int_t, sizeof...(I)>{m_tree->SetBranchAddress(
-    names[I].c_str(), io_root_impl::get_address(get<I>(m_data)))...};
+  // only the selected branches should be read
+  m_tree->SetBranchStatus("*", false);
+  (void)(int[]){0, (m_tree->SetBranchStatus(names[I].c_str(), true), 0)...};
+  // bind branches to the staging data to check the types and to cache the
+  // branch pointers. single reads later bind directly to the user records.
+  m_branches.fill(nullptr);
+  std::array<Int_t, sizeof...(I)> status = {m_tree->SetBranchAddress(
+    names[I].c_str(), io_root_impl::get_address(get<I>(m_data)),
+    &m_branches[I])...};
+  m_bound = &m_data;
+  for (std::size_t i = 0; i < sizeof...(I); ++i) {
+    // negative values indicate missing branches or inconsistent types
+    if ((status[i] < 0) or (not m_branches[i])) {
+      throw std::runtime_error("Could not setup branch '" + names[i] + "'");
+    }
+  }
+}
+
+template<typename NamedTuple>
+inline void
+NamedTupleRootReader<NamedTuple>::setup_options(
+  const NamedTupleRootReaderOptions& options)
+{
+  Long64_t num_entries = m_tree->GetEntries();
+  m_begin = options.entry_begin;
+  m_end = (options.entry_end < 0) ? num_entries
+                                  : std::min(options.entry_end, num_entries);
+  if ((m_begin < 0) or (m_end < m_begin)) {
+    throw std::invalid_argument("Invalid entry range");
+  }
+  m_next = m_begin;
+
+  // the cache prefetches all selected branches for the full entry range
+  m_tree->SetCacheSize(options.cache_size);
+  if (options.cache_size != 0) {
+    m_tree->SetCacheEntryRange(m_begin, m_end);
+    std::array<std::string, kNumBranches> names = NamedTuple::names();
+    for (const auto& name : names) { m_tree->AddBranchToCache(name.c_str()); }
+    // all branches are known; no need to guess them from the first entries
+    m_tree->StopCacheLearningPhase();
+  }
+  if (options.implicit_mt) {
+    if (not ROOT::IsImplicitMTEnabled()) { ROOT::EnableImplicitMT(); }
+    m_tree->SetImplicitMT(true);
+  }
 }
 
 template<typename NamedTuple>
@@ -333,15 +569,55 @@ template<typename NamedTuple>
 inline bool
 NamedTupleRootReader<NamedTuple>::read(NamedTuple& record)
 {
+  if (m_end <= m_next) { return false; }
+  read_entry(record);
+  return true;
+}
+
+template<typename NamedTuple>
+inline std::size_t
+NamedTupleRootReader<NamedTuple>::read(NamedTuple* records, std::size_t n)
+{
+  // rebinding all branches for every record costs more than a copy. read
+  // into the staging data that stays bound and copy the members out.
+  std::size_t i = 0;
+  for (; (i < n) and (m_next < m_end); ++i) {
+    read_entry(m_data);
+    records[i] = m_data;
+  }
+  return i;
+}
+
+template<typename NamedTuple>
+template<typename Values, std::size_t... I>
+inline void
+NamedTupleRootReader<NamedTuple>::bind_branches(
+  Values& values, std::index_sequence<I...>)
+{
+  using std::get;
+
+  // types have already been checked during setup
+  (void)(int[]){
+    0, (m_branches[I]->SetAddress(io_root_impl::get_address(get<I>(values))),
+        0)...};
+  m_bound = &values;
+}
+
+template<typename NamedTuple>
+template<typename Values>
+inline void
+NamedTupleRootReader<NamedTuple>::read_entry(Values& values)
+{
+  // rebinding the branches is only required if the target changes
+  if (m_bound != &values) {
+    bind_branches(values, std::make_index_sequence<kNumBranches>());
+  }
   auto ret = m_tree->GetEntry(m_next);
   // i/o error occured
   if (ret < 0) { throw std::runtime_error("Could not read entry"); }
-  // the entry does not exist, probably end-of-file reached
-  if (ret == 0) { return false; }
-  // GetEntry(...) has already filled the local buffer
-  record = m_data;
+  // the entry does not exist even though it should
+  if (ret == 0) { throw std::runtime_error("Could not find entry"); }
   m_next += 1;
-  return true;
 }
 
 } // namespace dfe
@@ -40,37 +40,43 @@
 /// This allows access to the selected members via `.get<I>()` or `get<I>(...)`,
 /// conversion to equivalent `std::tuple<...>` via implicit conversion or
 /// explicitely via `.tuple()`,  and assignment from equivalent tuples.
-/// The names can be accessed via `::names()`.
+/// `.tie()` provides a tuple of references to the members without copying
+/// them. The names can be accessed via `::names()`. They are parsed only once
+/// per type on first use.
 #define DFE_NAMEDTUPLE(name, members...) \
   using Tuple = decltype(::std::make_tuple(members)); \
-  static ::std::array<::std::string, ::std::tuple_size<Tuple>::value> names() \
+  static const ::std::array<::std::string, ::std::tuple_size<Tuple>::value>& \
+  names() \
   { \
-    return ::dfe::namedtuple_impl::unstringify< \
+    static const auto s_names = ::dfe::namedtuple_impl::unstringify< \
       ::std::tuple_size<Tuple>::value>((#members)); \
+    return s_names; \
   } \
   template<typename... U> \
   name& operator=(const ::std::tuple<U...>& other) \
   { \
-    ::std::tie(members) = other; \
+    tie() = other; \
     return *this; \
   } \
   template<typename... U> \
   name& operator=(::std::tuple<U...>&& other) \
   { \
-    ::std::tie(members) = ::std::forward<std::tuple<U...>>(other); \
+    tie() = ::std::forward<std::tuple<U...>>(other); \
     return *this; \
   } \
   operator Tuple() const { return ::std::make_tuple(members); } \
   Tuple tuple() const { return ::std::make_tuple(members); } \
+  constexpr auto tie() { return ::std::tie(members); } \
+  constexpr auto tie() const { return ::std::tie(members); } \
   template<std::size_t I> \
   constexpr ::std::tuple_element_t<I, Tuple>& get() \
   { \
-    return ::std::get<I>(std::tie(members)); \
+    return ::std::get<I>(tie()); \
   } \
   template<::std::size_t I> \
   constexpr const ::std::tuple_element_t<I, Tuple>& get() const \
   { \
-    return ::std::get<I>(std::tie(members)); \
+    return ::std::get<I>(tie()); \
   } \
   template<::std::size_t I> \
   friend constexpr ::std::tuple_element_t<I, Tuple>& get(name& nt) \
@@ -85,7 +91,7 @@
   friend ::std::ostream& operator<<(::std::ostream& os, const name& nt) \
   { \
     return ::dfe::namedtuple_impl::print_tuple( \
-      os, nt.names(), nt.tuple(), \
+      os, nt.names(), nt.tie(), \
       ::std::make_index_sequence<::std::tuple_size<Tuple>::value>{}); \
   }
 
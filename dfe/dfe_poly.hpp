@@ -23,7 +23,9 @@
 /// \author  Moritz Kiehn <msmk@cern.ch>
 /// \date    2018-02-26
 
+#include <algorithm>
 #include <array>
+#include <cstddef>
 #include <iterator>
 #include <type_traits>
 #include <utility>
@@ -107,6 +109,86 @@ polynomial_der(const T& x, const Container& coeffs)
   return polynomial_valder(x, coeffs).second;
 }
 
+/// Evaluate a polynomial of arbitrary order using Estrin's scheme.
+///
+/// \param x      Where to evaluate the polynomial.
+/// \param coeffs RandomAccessContainer with n+1 coefficients.
+///
+/// Estrin's scheme requires additional multiplications compared to Horner's
+/// method but has a dependency chain of length O(log n) instead of O(n). This
+/// can be faster for single evaluations of high-order polynomials.
+template<typename T, typename Container>
+constexpr T
+polynomial_val_estrin(const T& x, const Container& coeffs);
+
+/// Evaluate a polynomial of arbitrary order for multiple values.
+///
+/// \param xs     Pointer to the values where to evaluate the polynomial.
+/// \param out    Pointer to the output values; can be the same as `xs`.
+/// \param n      Number of values.
+/// \param coeffs ReversibleContainer with coefficients in increasing order.
+///
+/// Values are processed in blocks such that computations for multiple values
+/// can run in parallel in SIMD registers.
+template<typename T, typename Container>
+void
+polynomial_val(const T* xs, T* out, std::size_t n, const Container& coeffs);
+
+/// Evaluate the value and the derivative of a polynomial for multiple values.
+///
+/// \param xs          Pointer to the values where to evaluate the polynomial.
+/// \param values      Pointer to the output values; can be the same as `xs`.
+/// \param derivatives Pointer to the output derivatives; can be `xs`.
+/// \param n           Number of values.
+/// \param coeffs      ReversibleContainer with coefficients, see above.
+template<typename T, typename Container>
+void polynomial_valder(
+  const T* xs, T* values, T* derivatives, std::size_t n,
+  const Container& coeffs);
+
+/// A polynomial with a number of coefficients fixed at compile time.
+///
+/// \tparam T Coefficient and value type
+/// \tparam N Number of coefficients, i.e. the order plus one
+///
+/// The evaluation is fully unrolled at compile time. The coefficients of the
+/// derivative are precomputed on construction such that value and derivative
+/// can be evaluated independently with the minimal number of operations.
+template<typename T, std::size_t N>
+class Polynomial {
+public:
+  /// Number of coefficients of the derivative.
+  static constexpr std::size_t kDerivativeSize = (0 < N) ? (N - 1) : 0;
+
+  /// Construct from coefficients in increasing order.
+  constexpr Polynomial(const std::array<T, N>& coeffs);
+
+  constexpr const std::array<T, N>& coefficients() const { return m_coeffs; }
+  /// The derivative as a separate polynomial.
+  constexpr Polynomial<T, kDerivativeSize> derivative() const;
+
+  /// Evaluate the polynomial.
+  constexpr T operator()(const T& x) const { return val(x); }
+  /// Evaluate the polynomial.
+  constexpr T val(const T& x) const;
+  /// Evaluate the derivative.
+  constexpr T der(const T& x) const;
+  /// Evaluate the value and the derivative at the same time.
+  constexpr std::pair<T, T> valder(const T& x) const;
+
+private:
+  std::array<T, N> m_coeffs;
+  std::array<T, kDerivativeSize> m_deriv;
+};
+
+/// Construct a fixed-order polynomial from coefficients in increasing order.
+template<typename T, std::size_t N>
+constexpr Polynomial<T, N>
+make_polynomial(const std::array<T, N>& coeffs)
+{
+  return Polynomial<T, N>(coeffs);
+}
+
 /// Evaluate a polynomial with an order fixed at compile time.
 template<typename T, typename U>
 constexpr auto
@@ -131,4 +213,213 @@ polynomial_valder(const T& x, std::initializer_list<U> coeffs)
   return polynomial_valder<T, std::initializer_list<U>>(x, coeffs);
 }
 
+/// Evaluate a polynomial with an order fixed at compile time using Estrin.
+template<typename T, typename U>
+constexpr auto
+polynomial_val_estrin(const T& x, std::initializer_list<U> coeffs)
+{
+  return polynomial_val_estrin<T, std::initializer_list<U>>(x, coeffs);
+}
+
+/// Evaluate a polynomial with an order fixed at compile time for many values.
+template<typename T, typename U>
+inline void
+polynomial_val(
+  const T* xs, T* out, std::size_t n, std::initializer_list<U> coeffs)
+{
+  polynomial_val<T, std::initializer_list<U>>(xs, out, n, coeffs);
+}
+
+/// Evaluate the value and the derivative of a polynomial with an order fixed
+/// at compile time for many values.
+template<typename T, typename U>
+inline void
+polynomial_valder(
+  const T* xs, T* values, T* derivatives, std::size_t n,
+  std::initializer_list<U> coeffs)
+{
+  polynomial_valder<T, std::initializer_list<U>>(
+    xs, values, derivatives, n, coeffs);
+}
+
+// implementation
+
+namespace poly_impl {
+namespace {
+
+// number of values per block for the batch evaluation
+constexpr std::size_t kBlockSize = 16;
+
+// Evaluate the polynomial defined by n coefficients using Estrin's scheme.
+//
+// The coefficients are split into a lower part with a power-of-two size and
+// the remaining upper part, i.e. f(x) = low(x) + x^h * high(x). Both parts are
+// independent and can be computed in parallel.
+template<typename T, typename Iterator>
+constexpr T
+estrin(const T& x, Iterator coeffs, std::size_t n)
+{
+  if (n == 0) { return T(0); }
+  if (n == 1) { return coeffs[0]; }
+  if (n == 2) { return coeffs[0] + x * coeffs[1]; }
+  std::size_t h = 2;
+  T xh = x * x;
+  while ((2 * h) < n) {
+    h *= 2;
+    xh = xh * xh;
+  }
+  return estrin(x, coeffs, h) + xh * estrin(x, coeffs + h, n - h);
+}
+
+// Unrolled Horner's method for the last `Remaining` coefficients.
+template<std::size_t Remaining>
+struct Horner {
+  template<typename T, std::size_t N>
+  static constexpr T eval(const std::array<T, N>& coeffs, const T& x)
+  {
+    return coeffs[N - Remaining] + x * Horner<Remaining - 1>::eval(coeffs, x);
+  }
+};
+template<>
+struct Horner<1> {
+  template<typename T, std::size_t N>
+  static constexpr T eval(const std::array<T, N>& coeffs, const T&)
+  {
+    return coeffs[N - 1];
+  }
+};
+template<>
+struct Horner<0> {
+  template<typename T, std::size_t N>
+  static constexpr T eval(const std::array<T, N>&, const T&)
+  {
+    return T(0);
+  }
+};
+
+// Compute derivative coefficients, i.e. c'[i] = (i + 1) * c[i + 1].
+template<typename T, std::size_t N, std::size_t... I>
+constexpr std::array<T, sizeof...(I)>
+derivative_coefficients(
+  const std::array<T, N>& coeffs, std::index_sequence<I...>)
+{
+  return {{static_cast<T>(I + 1) * coeffs[I + 1]...}};
+}
+
+} // namespace
+} // namespace poly_impl
+
+template<typename T, std::size_t N>
+constexpr std::size_t Polynomial<T, N>::kDerivativeSize;
+
+template<typename T, std::size_t N>
+constexpr Polynomial<T, N>::Polynomial(const std::array<T, N>& coeffs)
+  : m_coeffs(coeffs)
+  , m_deriv(poly_impl::derivative_coefficients(
+      coeffs, std::make_index_sequence<kDerivativeSize>()))
+{
+}
+
+template<typename T, std::size_t N>
+constexpr Polynomial<T, Polynomial<T, N>::kDerivativeSize>
+Polynomial<T, N>::derivative() const
+{
+  return Polynomial<T, kDerivativeSize>(m_deriv);
+}
+
+template<typename T, std::size_t N>
+constexpr T
+Polynomial<T, N>::val(const T& x) const
+{
+  return poly_impl::Horner<N>::eval(m_coeffs, x);
+}
+
+template<typename T, std::size_t N>
+constexpr T
+Polynomial<T, N>::der(const T& x) const
+{
+  return poly_impl::Horner<kDerivativeSize>::eval(m_deriv, x);
+}
+
+template<typename T, std::size_t N>
+constexpr std::pair<T, T>
+Polynomial<T, N>::valder(const T& x) const
+{
+  // two independent evaluations can be computed in parallel
+  return {val(x), der(x)};
+}
+
+template<typename T, typename Container>
+constexpr T
+polynomial_val_estrin(const T& x, const Container& coeffs)
+{
+  auto n = std::distance(std::begin(coeffs), std::end(coeffs));
+  return poly_impl::estrin(x, std::begin(coeffs), static_cast<std::size_t>(n));
+}
+
+template<typename T, typename Container>
+inline void
+polynomial_val(const T* xs, T* out, std::size_t n, const Container& coeffs)
+{
+  using poly_impl::kBlockSize;
+
+  // Horner's method w/ the loops over coefficients and values interchanged.
+  // the inner loop has a fixed size and no dependencies between iterations.
+  std::size_t nfull = n - (n % kBlockSize);
+  for (std::size_t i = 0; i < nfull; i += kBlockSize) {
+    T x[kBlockSize];
+    T value[kBlockSize];
+    for (std::size_t j = 0; j < kBlockSize; ++j) {
+      x[j] = xs[i + j];
+      value[j] = 0;
+    }
+    for (auto c = std::rbegin(coeffs); c != std::rend(coeffs); ++c) {
+      T cj = *c;
+      for (std::size_t j = 0; j < kBlockSize; ++j) {
+        value[j] = cj + x[j] * value[j];
+      }
+    }
+    std::copy(value, value + kBlockSize, out + i);
+  }
+  for (std::size_t i = nfull; i < n; ++i) {
+    out[i] = polynomial_val(xs[i], coeffs);
+  }
+}
+
+template<typename T, typename Container>
+inline void
+polynomial_valder(
+  const T* xs, T* values, T* derivatives, std::size_t n,
+  const Container& coeffs)
+{
+  using poly_impl::kBlockSize;
+
+  // see polynomial_val above
+  std::size_t nfull = n - (n % kBlockSize);
+  for (std::size_t i = 0; i < nfull; i += kBlockSize) {
+    T x[kBlockSize];
+    T p[kBlockSize];
+    T q[kBlockSize];
+    for (std::size_t j = 0; j < kBlockSize; ++j) {
+      x[j] = xs[i + j];
+      p[j] = 0;
+      q[j] = 0;
+    }
+    for (auto c = std::rbegin(coeffs); c != std::rend(coeffs); ++c) {
+      T cj = *c;
+      for (std::size_t j = 0; j < kBlockSize; ++j) {
+        q[j] = p[j] + x[j] * q[j];
+        p[j] = cj + x[j] * p[j];
+      }
+    }
+    std::copy(p, p + kBlockSize, values + i);
+    std::copy(q, q + kBlockSize, derivatives + i);
+  }
+  for (std::size_t i = nfull; i < n; ++i) {
+    auto pq = polynomial_valder(xs[i], coeffs);
+    values[i] = pq.first;
+    derivatives[i] = pq.second;
+  }
+}
+
 } // namespace dfe
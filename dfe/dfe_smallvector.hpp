@@ -25,8 +25,12 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstring>
 #include <iterator>
 #include <memory>
+#include <type_traits>
+#include <utility>
 
 namespace dfe {
 
@@ -37,11 +41,16 @@ namespace dfe {
 /// \tparam Allocator Allocator for elements of type T
 ///
 /// If the vector contains less or equal than N elements, they are stored in
-/// the vector itself without the need to allocate additional memory.
+/// the vector itself without the need to allocate additional memory. Once
+/// memory is allocated it is kept until the vector is cleared, even if
+/// elements are removed again.
 ///
-/// Supports access by index, iteration over elements, deleting all existing
-/// elements from the vector, and adding elements at a specified location or at
-/// the back.
+/// Supports access by index, iteration over elements, adding elements at a
+/// specified location or at the back, and removing elements. Trivially
+/// copyable elements are relocated using plain memory copies.
+///
+/// The pointer to the active storage is always stored explicitly, i.e. element
+/// access does not depend on whether the elements are stored in-place or not.
 template<typename T, std::size_t N, typename Allocator = std::allocator<T>>
 class SmallVector {
 public:
@@ -51,189 +60,245 @@ public:
   using const_iterator = const T*;
 
   SmallVector() = default;
+  SmallVector(const SmallVector& other);
+  /// Move elements from the other vector.
+  ///
+  /// Heap-allocated storage is taken over w/o touching the elements.
+  SmallVector(SmallVector&& other) noexcept(
+    std::is_nothrow_move_constructible<T>::value);
   ~SmallVector() { clear(); }
 
-  value_type& operator[](size_type idx);
-  const value_type& operator[](size_type idx) const;
+  SmallVector& operator=(const SmallVector& other);
+  SmallVector& operator=(SmallVector&& other) noexcept(
+    std::is_nothrow_move_constructible<T>::value);
 
-  iterator begin();
-  iterator end() { return begin() + m_size; }
-  const_iterator begin() const;
-  const_iterator end() const { return begin() + m_size; }
+  value_type& operator[](size_type idx) { return m_data[idx]; }
+  const value_type& operator[](size_type idx) const { return m_data[idx]; }
+  value_type& back() { return m_data[m_size - 1]; }
+  const value_type& back() const { return m_data[m_size - 1]; }
+  value_type* data() { return m_data; }
+  const value_type* data() const { return m_data; }
+
+  iterator begin() { return m_data; }
+  iterator end() { return m_data + m_size; }
+  const_iterator begin() const { return m_data; }
+  const_iterator end() const { return m_data + m_size; }
 
   /// Return true if there are no elements in the vector.
   bool empty() const { return (m_size == 0); }
   /// Return the number of elements in the vector.
   size_type size() const { return m_size; }
   /// Return the number of elements that can be stored in the available memory.
-  size_type capacity() const { return (m_size <= N) ? N : m_onheap.capacity; }
+  size_type capacity() const { return m_capacity; }
 
   /// Remove all elements.
   ///
   /// This will release allocated memory if the vector contains more elements
   /// than can be stored in-place.
   void clear();
+  /// Ensure that at least the given number of elements can be stored.
+  void reserve(size_type capacity);
+  /// Change the number of elements and default-construct additional elements.
+  void resize(size_type size);
+  /// Change the number of elements and copy-construct additional elements.
+  void resize(size_type size, const T& value);
   /// Construct an element directly before the given position in the vector.
   template<typename... Args>
   iterator emplace(const_iterator pos, Args&&... args);
   /// Construct an element at the back of the vector and return its reference.
   template<typename... Args>
   T& emplace_back(Args&&... args);
+  /// Remove the last element.
+  void pop_back();
+  /// Remove the element at the given position.
+  iterator erase(const_iterator pos) { return erase(pos, std::next(pos)); }
+  /// Remove all elements in the given range.
+  iterator erase(const_iterator first, const_iterator last);
 
 private:
-  struct AllocatedStorage {
-    size_type capacity;
-    T* data;
-  };
-
-  AllocatedStorage allocate_storage(size_type capacity);
-  void destruct_inplace();
-  void destruct_deallocate_onheap();
-
+  using AllocatorTraits = std::allocator_traits<Allocator>;
+  using IsTrivial = std::is_trivially_copyable<T>;
+
+  bool is_inplace() const { return m_data == inplace(); }
+  T* inplace() { return reinterpret_cast<T*>(m_inplace); }
+  const T* inplace() const { return reinterpret_cast<const T*>(m_inplace); }
+  /// Move to heap-allocated storage with the given capacity.
+  void reallocate(size_type capacity);
+  /// Release the heap-allocated storage w/o touching any elements.
+  void deallocate();
+  /// Take over all elements from the other vector and leave it empty.
+  void steal(SmallVector& other);
+  /// Copy all elements from the other vector into empty, sufficient storage.
+  void copy_from(const SmallVector& other);
+  void destruct(T* first, T* last);
+  // move-construct elements into uninitialized memory and destruct the source
+  void relocate(T* first, T* last, T* target, std::true_type);
+  void relocate(T* first, T* last, T* target, std::false_type);
+  // move elements within the storage by one position to the right
+  void shift_right(T* first, T* last, std::true_type);
+  void shift_right(T* first, T* last, std::false_type);
+
+  // active storage, either in-place or heap-allocated
+  T* m_data = inplace();
   size_type m_size = 0;
-  union {
-    AllocatedStorage m_onheap;
-    // use 'raw' memory to have full control over constructor/destructor calls
-    alignas(T) char m_inplace[N * sizeof(T)];
-  };
+  size_type m_capacity = N;
   Allocator m_alloc;
+  // use 'raw' memory to have full control over constructor/destructor calls
+  alignas(T) char m_inplace[N * sizeof(T)];
 };
 
 // implementation
 
 template<typename T, std::size_t N, typename Allocator>
-inline typename SmallVector<T, N, Allocator>::AllocatedStorage
-SmallVector<T, N, Allocator>::allocate_storage(size_type capacity)
+inline SmallVector<T, N, Allocator>::SmallVector(const SmallVector& other)
+  : m_alloc(AllocatorTraits::select_on_container_copy_construction(
+      other.m_alloc))
 {
-  AllocatedStorage s;
-  s.capacity = capacity;
-  s.data = std::allocator_traits<Allocator>::allocate(m_alloc, capacity);
-  return s;
+  copy_from(other);
 }
 
-// Destruct elements in in-place storage assuming they are valid.
 template<typename T, std::size_t N, typename Allocator>
-inline void
-SmallVector<T, N, Allocator>::destruct_inplace()
+inline SmallVector<T, N, Allocator>::SmallVector(SmallVector&& other) noexcept(
+  std::is_nothrow_move_constructible<T>::value)
+  : m_alloc(std::move(other.m_alloc))
 {
-  T* ptr = reinterpret_cast<T*>(m_inplace);
-  for (T* end = ptr + m_size; ptr != end; ++ptr) { ptr->~T(); }
+  steal(other);
 }
 
-// Destruct and deallocate elements in heap-allocated storage.
 template<typename T, std::size_t N, typename Allocator>
-inline void
-SmallVector<T, N, Allocator>::destruct_deallocate_onheap()
+inline SmallVector<T, N, Allocator>&
+SmallVector<T, N, Allocator>::operator=(const SmallVector& other)
 {
-  T* ptr = m_onheap.data;
-  for (T* end = ptr + m_size; ptr != end; ++ptr) {
-    std::allocator_traits<Allocator>::destroy(m_alloc, ptr);
+  if (this != &other) {
+    // keep existing storage if possible to avoid repeated allocations
+    destruct(begin(), end());
+    m_size = 0;
+    if (m_capacity < other.m_size) {
+      deallocate();
+      reallocate(other.m_size);
+    }
+    copy_from(other);
   }
-  std::allocator_traits<Allocator>::deallocate(
-    m_alloc, m_onheap.data, m_onheap.capacity);
-  m_onheap.capacity = 0;
-  m_onheap.data = nullptr;
+  return *this;
 }
 
 template<typename T, std::size_t N, typename Allocator>
-inline T& SmallVector<T, N, Allocator>::operator[](size_type idx)
+inline SmallVector<T, N, Allocator>&
+SmallVector<T, N, Allocator>::operator=(SmallVector&& other) noexcept(
+  std::is_nothrow_move_constructible<T>::value)
 {
-  if (m_size <= N) {
-    return *(reinterpret_cast<T*>(m_inplace) + idx);
-  } else {
-    return m_onheap.data[idx];
+  if (this != &other) {
+    clear();
+    m_alloc = std::move(other.m_alloc);
+    steal(other);
   }
+  return *this;
 }
 
 template<typename T, std::size_t N, typename Allocator>
-inline const T& SmallVector<T, N, Allocator>::operator[](size_type idx) const
+inline void
+SmallVector<T, N, Allocator>::clear()
 {
-  if (m_size <= N) {
-    return *(reinterpret_cast<const T*>(m_inplace) + idx);
-  } else {
-    return m_onheap.data[idx];
-  }
+  destruct(begin(), end());
+  deallocate();
+  m_size = 0;
 }
 
 template<typename T, std::size_t N, typename Allocator>
-inline typename SmallVector<T, N, Allocator>::iterator
-SmallVector<T, N, Allocator>::begin()
+inline void
+SmallVector<T, N, Allocator>::reserve(size_type capacity)
 {
-  return (m_size <= N) ? reinterpret_cast<T*>(m_inplace) : m_onheap.data;
+  if (m_capacity < capacity) { reallocate(capacity); }
 }
 
 template<typename T, std::size_t N, typename Allocator>
-inline typename SmallVector<T, N, Allocator>::const_iterator
-SmallVector<T, N, Allocator>::begin() const
+inline void
+SmallVector<T, N, Allocator>::resize(size_type size)
 {
-  return (m_size <= N) ? reinterpret_cast<const T*>(m_inplace) : m_onheap.data;
+  if (size < m_size) {
+    destruct(begin() + size, end());
+  } else {
+    reserve(size);
+    for (T* e = begin() + size; end() != e; ++m_size) {
+      AllocatorTraits::construct(m_alloc, end());
+    }
+  }
+  m_size = size;
 }
 
 template<typename T, std::size_t N, typename Allocator>
 inline void
-SmallVector<T, N, Allocator>::clear()
+SmallVector<T, N, Allocator>::resize(size_type size, const T& value)
 {
-  if (m_size <= N) {
-    destruct_inplace();
-  } else {
-    destruct_deallocate_onheap();
+  if (size < m_size) {
+    destruct(begin() + size, end());
+    m_size = size;
+  } else if (m_size < size) {
+    // value might be an existing element that is invalidated by reallocation
+    if (m_capacity < size) {
+      T copy(value);
+      reserve(size);
+      resize(size, copy);
+      return;
+    }
+    for (T* e = begin() + size; end() != e; ++m_size) {
+      AllocatorTraits::construct(m_alloc, end(), value);
+    }
   }
-  m_size = 0;
 }
 
 template<typename T, std::size_t N, typename Allocator>
 template<typename... Args>
-typename SmallVector<T, N, Allocator>::iterator
+inline typename SmallVector<T, N, Allocator>::iterator
 SmallVector<T, N, Allocator>::emplace(const_iterator pos, Args&&... args)
 {
-  using AllocatorTraits = std::allocator_traits<Allocator>;
-
   // TODO how, when to check iterator validity?
 
+  size_type idx = pos - begin();
+
   // available storage is sufficient to hold one extra element.
-  // existing data after the insertion point needs to be shifted by 1 to the
-  // right so the new element can be constructed at the given position.
-  if (size() < capacity()) {
-    T* i = const_cast<T*>(pos);
+  if (m_size < m_capacity) {
+    T* i = begin() + idx;
     T* e = end();
 
-    // the underlying storage is raw memory. in order for the move assignment
-    // to be well-defined, the memory for the additiona element needs to be
-    // (default-)initialized using placement-new first.
-    (void)new (e) T();
-    std::move_backward(i, e, std::next(e));
-    // insertion points contains moved-from object. move-assignment should be
-    // valid. placement-new construction would double-initialize.
-    *i = T(std::forward<Args>(args)...);
-
+    if (i == e) {
+      AllocatorTraits::construct(m_alloc, e, std::forward<Args>(args)...);
+    } else {
+      // arguments could reference existing elements that are about to move
+      T element(std::forward<Args>(args)...);
+      // existing data after the insertion point is shifted by one to the
+      // right. the last element is move-constructed into uninitialized memory
+      // so the insertion point contains a moved-from object that can be
+      // move-assigned w/o any additional default construction.
+      shift_right(i, e, IsTrivial());
+      *i = std::move(element);
+    }
     m_size += 1;
     return i;
   }
 
-  // available storage is in-sufficient. move to larger heap-allocated storage.
-  auto storage = allocate_storage(1.3f * (m_size + 1));
+  // available storage is in-sufficient. move to larger heap-allocated storage
+  // using geometric growth for amortized constant time insertion at the back.
+  size_type capacity = std::max<size_type>(2 * m_capacity, 1);
+  T* storage = AllocatorTraits::allocate(m_alloc, capacity);
   T* source = begin();
-  T* target = storage.data;
-
-  // move data before insertion point to the new storage
-  for (T* e = const_cast<T*>(pos); source != e; ++source, ++target) {
-    AllocatorTraits::construct(m_alloc, target, std::move(*source));
-  }
-  // construct element directly in the new storage
-  T* insert = target++;
-  AllocatorTraits::construct(m_alloc, insert, std::forward<Args>(args)...);
-  // move data after the insertion point to the new storage
-  for (T* e = end(); source != e; ++source, ++target) {
-    AllocatorTraits::construct(m_alloc, target, std::move(*source));
+  T* insert = storage + idx;
+
+  // construct element first in case the arguments reference existing elements
+  try {
+    AllocatorTraits::construct(m_alloc, insert, std::forward<Args>(args)...);
+  } catch (...) {
+    AllocatorTraits::deallocate(m_alloc, storage, capacity);
+    throw;
   }
+  // move data before and after the insertion point to the new storage
+  relocate(source, source + idx, storage, IsTrivial());
+  relocate(source + idx, source + m_size, insert + 1, IsTrivial());
 
-  // clear previous data before replacing it with the next storage
-  if (m_size == N) {
-    destruct_inplace();
-  } else {
-    destruct_deallocate_onheap();
-  }
-  m_onheap = storage;
+  // release previous storage before replacing it with the next storage
+  deallocate();
+  m_data = storage;
+  m_capacity = capacity;
 
   m_size += 1;
   return insert;
@@ -244,7 +309,135 @@ template<typename... Args>
 inline typename SmallVector<T, N, Allocator>::value_type&
 SmallVector<T, N, Allocator>::emplace_back(Args&&... args)
 {
+  if (m_size < m_capacity) {
+    T* e = end();
+    AllocatorTraits::construct(m_alloc, e, std::forward<Args>(args)...);
+    m_size += 1;
+    return *e;
+  }
   return *emplace(end(), std::forward<Args>(args)...);
 }
 
+template<typename T, std::size_t N, typename Allocator>
+inline void
+SmallVector<T, N, Allocator>::pop_back()
+{
+  AllocatorTraits::destroy(m_alloc, end() - 1);
+  m_size -= 1;
+}
+
+template<typename T, std::size_t N, typename Allocator>
+inline typename SmallVector<T, N, Allocator>::iterator
+SmallVector<T, N, Allocator>::erase(const_iterator first, const_iterator last)
+{
+  T* i = const_cast<T*>(first);
+  if (first != last) {
+    T* e = std::move(const_cast<T*>(last), end(), i);
+    destruct(e, end());
+    m_size = e - begin();
+  }
+  return i;
+}
+
+template<typename T, std::size_t N, typename Allocator>
+inline void
+SmallVector<T, N, Allocator>::reallocate(size_type capacity)
+{
+  T* storage = AllocatorTraits::allocate(m_alloc, capacity);
+  relocate(begin(), end(), storage, IsTrivial());
+  deallocate();
+  m_data = storage;
+  m_capacity = capacity;
+}
+
+template<typename T, std::size_t N, typename Allocator>
+inline void
+SmallVector<T, N, Allocator>::deallocate()
+{
+  if (not is_inplace()) {
+    AllocatorTraits::deallocate(m_alloc, m_data, m_capacity);
+    m_data = inplace();
+    m_capacity = N;
+  }
+}
+
+template<typename T, std::size_t N, typename Allocator>
+inline void
+SmallVector<T, N, Allocator>::steal(SmallVector& other)
+{
+  if (other.is_inplace()) {
+    relocate(other.begin(), other.end(), inplace(), IsTrivial());
+  } else {
+    m_data = other.m_data;
+    m_capacity = other.m_capacity;
+    other.m_data = other.inplace();
+    other.m_capacity = N;
+  }
+  m_size = other.m_size;
+  other.m_size = 0;
+}
+
+template<typename T, std::size_t N, typename Allocator>
+inline void
+SmallVector<T, N, Allocator>::copy_from(const SmallVector& other)
+{
+  reserve(other.m_size);
+  if (IsTrivial::value) {
+    if (0 < other.m_size) {
+      std::memcpy(
+        static_cast<void*>(begin()), other.begin(), other.m_size * sizeof(T));
+    }
+    m_size = other.m_size;
+  } else {
+    for (const T& element : other) {
+      AllocatorTraits::construct(m_alloc, end(), element);
+      m_size += 1;
+    }
+  }
+}
+
+template<typename T, std::size_t N, typename Allocator>
+inline void
+SmallVector<T, N, Allocator>::destruct(T* first, T* last)
+{
+  for (; first != last; ++first) { AllocatorTraits::destroy(m_alloc, first); }
+}
+
+template<typename T, std::size_t N, typename Allocator>
+inline void
+SmallVector<T, N, Allocator>::relocate(
+  T* first, T* last, T* target, std::true_type)
+{
+  if (first != last) {
+    std::memcpy(static_cast<void*>(target), first, (last - first) * sizeof(T));
+  }
+}
+
+template<typename T, std::size_t N, typename Allocator>
+inline void
+SmallVector<T, N, Allocator>::relocate(
+  T* first, T* last, T* target, std::false_type)
+{
+  for (; first != last; ++first, ++target) {
+    AllocatorTraits::construct(m_alloc, target, std::move_if_noexcept(*first));
+    AllocatorTraits::destroy(m_alloc, first);
+  }
+}
+
+template<typename T, std::size_t N, typename Allocator>
+inline void
+SmallVector<T, N, Allocator>::shift_right(T* first, T* last, std::true_type)
+{
+  std::memmove(
+    static_cast<void*>(first + 1), first, (last - first) * sizeof(T));
+}
+
+template<typename T, std::size_t N, typename Allocator>
+inline void
+SmallVector<T, N, Allocator>::shift_right(T* first, T* last, std::false_type)
+{
+  AllocatorTraits::construct(m_alloc, last, std::move(*(last - 1)));
+  std::move_backward(first, last - 1, last);
+}
+
 } // namespace dfe
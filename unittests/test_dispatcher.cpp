@@ -3,6 +3,8 @@
 
 #include <boost/test/unit_test.hpp>
 #include <iostream>
+#include <limits>
+#include <thread>
 
 #include "dfe/dfe_dispatcher.hpp"
 
@@ -118,6 +120,38 @@ BOOST_AUTO_TEST_CASE(dispatcher_variable_string)
   BOOST_CHECK_THROW(vs.as<int>(), std::invalid_argument); // wrong type
 }
 
+BOOST_AUTO_TEST_CASE(dispatcher_variable_copy_move)
+{
+  // numeric values and the type fit into two words
+  BOOST_TEST(sizeof(Variable) <= 16u);
+
+  Variable s("a string that is long enough to require allocated storage");
+  Variable i(42);
+  // copies share the same string
+  Variable c(s);
+  BOOST_TEST(&c.as<std::string>() == &s.as<std::string>());
+  c = i;
+  BOOST_CHECK(c.type() == Type::Integer);
+  BOOST_TEST(c.as<int>() == 42);
+  c = s;
+  // self-assignment keeps the string alive
+  const Variable& self = c;
+  c = self;
+  BOOST_TEST(c.as<std::string>() == s.as<std::string>());
+  // moved-from variables are empty
+  Variable m(std::move(c));
+  BOOST_CHECK(c.type() == Type::Empty);
+  BOOST_TEST(&m.as<std::string>() == &s.as<std::string>());
+  i = std::move(m);
+  BOOST_CHECK(m.type() == Type::Empty);
+  BOOST_TEST(i.as<std::string>() == s.as<std::string>());
+  // the string outlives the original variable
+  s = Variable(1.5);
+  BOOST_TEST(
+    i.as<std::string>() ==
+    "a string that is long enough to require allocated storage");
+}
+
 // basic sanity checks
 
 BOOST_AUTO_TEST_CASE(dispatcher_add)
@@ -239,3 +273,219 @@ BOOST_AUTO_TEST_CASE(dispatcher_member)
   BOOST_TEST(!dp.call_parsed("noreturn", {"2.6"}));
   BOOST_TEST(!dp.call_parsed("noreturn", {"1.25"}));
 }
+
+// pre-resolved commands
+
+std::size_t
+func_length(const std::string& s)
+{
+  return s.size();
+}
+
+BOOST_AUTO_TEST_CASE(dispatcher_handle)
+{
+  dfe::Dispatcher dp;
+  FuncStruct f = {4};
+  BOOST_REQUIRE_NO_THROW(dp.add("func", &FuncStruct::func, &f));
+  BOOST_REQUIRE_NO_THROW(dp.add("length", func_length));
+  BOOST_REQUIRE_NO_THROW(
+    dp.add("native3", native, {Type::String, Type::String, Type::String}));
+  BOOST_CHECK_THROW(dp.find("does-not-exist"), std::invalid_argument);
+
+  auto func = dp.find("func");
+  auto length = dp.find("length");
+  auto native3 = dp.find("native3");
+  // handles stay valid when more commands are added
+  for (int i = 0; i < 64; ++i) {
+    dp.add("noreturn" + std::to_string(i), &FuncStruct::noreturn, &f);
+  }
+  BOOST_TEST(func(2.75).as<double>() == 11.0);
+  BOOST_TEST(func.call_native({Variable(1.25)}).as<double>() == 5.0);
+  BOOST_CHECK_THROW(func(), std::invalid_argument);         // nargs
+  BOOST_CHECK_THROW(func(1.0, 2.0), std::invalid_argument); // nargs
+  BOOST_CHECK_THROW(func("x"), std::invalid_argument);      // type
+  BOOST_TEST(length("abcdef").as<int>() == 6);
+  BOOST_TEST(native3("x", "y", "z").as<std::string>() == "xyz");
+  BOOST_TEST(
+    native3.call_native({Variable("a"), Variable("b"), Variable("c")})
+      .as<std::string>() == "abc");
+}
+
+BOOST_AUTO_TEST_CASE(dispatcher_string_reference)
+{
+  std::string str("a long string that does not fit into small string storage");
+  Variable v(str);
+  // strings are accessed by reference w/o copies
+  const std::string& ref = v.as<std::string>();
+  BOOST_TEST(&ref == &v.as<std::string>());
+  BOOST_TEST(ref == str);
+}
+
+BOOST_AUTO_TEST_CASE(dispatcher_variable_parse)
+{
+  using Type = Variable::Type;
+  Variable v;
+  BOOST_TEST(Variable::parse_as("-123", 4, Type::Integer, v));
+  BOOST_TEST(v.as<int>() == -123);
+  BOOST_TEST(Variable::parse_as("-9223372036854775808", 20, Type::Integer, v));
+  BOOST_TEST(v.as<int64_t>() == INT64_MIN);
+  BOOST_TEST(Variable::parse_as("0.25", 4, Type::Float, v));
+  BOOST_TEST(v.as<double>() == 0.25);
+  BOOST_TEST(Variable::parse_as("true", 4, Type::Boolean, v));
+  BOOST_TEST(v.as<bool>());
+  // only the given size is parsed
+  BOOST_TEST(Variable::parse_as("12abc", 2, Type::Integer, v));
+  BOOST_TEST(v.as<int>() == 12);
+  BOOST_TEST(Variable::parse_as("xyz", 2, Type::String, v));
+  BOOST_TEST(v.as<std::string>() == "xy");
+  // invalid input is reported w/o throwing and leaves the value untouched
+  BOOST_TEST(not Variable::parse_as("12abc", 5, Type::Integer, v));
+  BOOST_TEST(not Variable::parse_as("", 0, Type::Integer, v));
+  BOOST_TEST(
+    not Variable::parse_as("9223372036854775808", 19, Type::Integer, v));
+  BOOST_TEST(not Variable::parse_as("1.5x", 4, Type::Float, v));
+  BOOST_TEST(not Variable::parse_as("1e999", 5, Type::Float, v));
+  BOOST_TEST(not Variable::parse_as(" 1.5", 4, Type::Float, v));
+  BOOST_TEST(not Variable::parse_as("1.5e", 4, Type::Float, v));
+  BOOST_TEST(v.as<std::string>() == "xy");
+  // inputs w/o an exact fast path conversion and arbitrarily long inputs
+  BOOST_TEST(Variable::parse_as("1.7976931348623157e308", 22, Type::Float, v));
+  BOOST_TEST(v.as<double>() == 1.7976931348623157e308);
+  std::string digits = "0." + std::string(80, '0') + "125";
+  BOOST_TEST(
+    Variable::parse_as(digits.data(), digits.size(), Type::Float, v));
+  BOOST_TEST(v.as<double>() == 0.125e-80);
+  BOOST_TEST(Variable::parse_as("-inf", 4, Type::Float, v));
+  BOOST_TEST(v.as<double>() == -std::numeric_limits<double>::infinity());
+  BOOST_TEST(Variable::parse_as("4.9e-324", 8, Type::Float, v));
+  BOOST_TEST(v.as<double>() == std::numeric_limits<double>::denorm_min());
+  // the decimal point is always a dot and hexadecimal input is not supported
+  BOOST_TEST(not Variable::parse_as("1,5e100", 7, Type::Float, v));
+  BOOST_TEST(not Variable::parse_as("0x1p3", 5, Type::Float, v));
+  // throwing version
+  BOOST_TEST(
+    Variable::parse_as(std::string("42"), Type::Integer).as<int>() == 42);
+  BOOST_CHECK_THROW(
+    Variable::parse_as(std::string("42x"), Type::Integer),
+    std::invalid_argument);
+  // strings are moved into place
+  std::string str("a long string that does not fit into small string storage");
+  const char* data = str.data();
+  BOOST_TEST(Variable::parse_as(std::move(str), Type::String, v));
+  BOOST_TEST(v.as<std::string>().data() == data);
+}
+
+int
+func_sum9(int a, int b, int c, int d, int e, int f, int g, int h, int i)
+{
+  return a + b + c + d + e + f + g + h + i;
+}
+
+BOOST_AUTO_TEST_CASE(dispatcher_call_parsed_range)
+{
+  dfe::Dispatcher dp;
+  BOOST_REQUIRE_NO_THROW(dp.add("func", func));
+  BOOST_REQUIRE_NO_THROW(dp.add("length", func_length));
+  BOOST_REQUIRE_NO_THROW(dp.add("sum9", func_sum9));
+
+  std::vector<std::string> args = {"2", "2.6"};
+  BOOST_TEST(
+    dp.call_parsed("func", args.begin(), args.end()).as<float>() == 5.2f);
+  BOOST_TEST(dp.call_parsed("length", std::vector<std::string>{"abcd"})
+               .as<int>() == 4);
+  BOOST_CHECK_THROW(
+    dp.call_parsed("func", args.begin(), args.begin() + 1),
+    std::invalid_argument);
+  BOOST_CHECK_THROW(
+    dp.call_parsed("func", {"2x", "2.6"}), std::invalid_argument);
+  BOOST_CHECK_THROW(
+    dp.call_parsed("func", {"2", "2.6.1"}), std::invalid_argument);
+  // more arguments than fit into the stack storage
+  std::vector<std::string> many = {"1", "2", "3", "4", "5", "6", "7", "8", "9"};
+  BOOST_TEST(
+    dp.call_parsed("sum9", many.begin(), many.end()).as<int>() == 45);
+  BOOST_CHECK_THROW(
+    dp.call_parsed("sum9", many.begin(), many.end() - 1),
+    std::invalid_argument);
+#if 201703L <= __cplusplus
+  std::vector<std::string_view> views = {"3", "1.25"};
+  BOOST_TEST(
+    dp.call_parsed("func", views.begin(), views.end()).as<float>() == 3.75f);
+#endif
+}
+
+// batched and asynchronous calls
+
+BOOST_AUTO_TEST_CASE(dispatcher_call_parsed_batch)
+{
+  dfe::Dispatcher dp;
+  BOOST_REQUIRE_NO_THROW(dp.add("func", func));
+  BOOST_REQUIRE_NO_THROW(dp.add("length", func_length));
+
+  auto results = dp.call_parsed({
+    {"func", {"2", "2.6"}},
+    {"func", {"3", "1.25"}},
+    {"length", {"abc"}},
+    {"func", {"1", "0.5"}},
+  });
+  BOOST_REQUIRE(results.size() == 4u);
+  BOOST_TEST(results[0].as<float>() == 5.2f);
+  BOOST_TEST(results[1].as<float>() == 3.75f);
+  BOOST_TEST(results[2].as<int>() == 3);
+  BOOST_TEST(results[3].as<float>() == 0.5f);
+  BOOST_CHECK_THROW(
+    dp.call_parsed({{"func", {"2", "2.6"}}, {"does-not-exist", {}}}),
+    std::invalid_argument);
+  BOOST_CHECK_THROW(dp.call_parsed({{"func", {"2"}}}), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(dispatcher_async)
+{
+  static constexpr int kNThreads = 4;
+  static constexpr int kNCalls = 1000;
+
+  dfe::Dispatcher dp;
+  // executed on a single thread; no synchronization required
+  int64_t sum = 0;
+  std::function<int64_t(int64_t)> add = [&](int64_t x) { return sum += x; };
+  BOOST_REQUIRE_NO_THROW(dp.add("add", std::move(add)));
+  BOOST_REQUIRE_NO_THROW(dp.add("length", func_length));
+
+  {
+    dfe::AsyncDispatcher async(dp);
+    BOOST_CHECK_THROW(async.submit("does-not-exist"), std::invalid_argument);
+    // wrong arguments are reported via the future
+    BOOST_CHECK_THROW(async.submit("add", "x").get(), std::invalid_argument);
+    BOOST_CHECK_THROW(async.submit("add").get(), std::invalid_argument);
+    BOOST_TEST(async.submit_parsed("length", {"abcd"}).get().as<int>() == 4);
+    BOOST_TEST(
+      async.submit_native("length", {Variable("ab")}).get().as<int>() == 2);
+
+    // boost test is not thread-safe; check the results afterwards
+    std::vector<int> is_ordered(kNThreads, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNThreads; ++t) {
+      threads.emplace_back([&async, &is_ordered, t]() {
+        std::vector<std::future<Variable>> results;
+        for (int i = 0; i < kNCalls; ++i) {
+          results.push_back(async.submit("add", 1));
+        }
+        // results are always increasing since calls are executed in order
+        int64_t previous = 0;
+        is_ordered[t] = 1;
+        for (auto& result : results) {
+          auto current = result.get().as<int64_t>();
+          is_ordered[t] &= (previous < current);
+          previous = current;
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    BOOST_TEST(is_ordered == std::vector<int>(kNThreads, 1));
+    // remaining commands are executed before the async dispatcher is stopped
+    async.submit("add", 1);
+  }
+  BOOST_TEST(sum == (kNThreads * kNCalls + 1));
+}
@@ -5,6 +5,8 @@
 
 #include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "dfe/dfe_flat.hpp"
 
@@ -46,3 +48,198 @@ BOOST_AUTO_TEST_CASE(flatmap_string_string)
   BOOST_TEST(!m.contains("asdfasdgasdgadgs"));
   BOOST_TEST(!m.contains("0124"));
 }
+
+BOOST_AUTO_TEST_CASE(flatmap_range)
+{
+  std::vector<std::pair<int, std::string>> pairs = {
+    {3, "a"}, {-1, "b"}, {3, "c"}, {7, "d"}, {-1, "e"}};
+
+  // duplicate keys are resolved like with sequential emplace
+  dfe::FlatMap<int, std::string> m(pairs.begin(), pairs.end());
+  BOOST_TEST(m.size() == 3u);
+  BOOST_TEST(m.at(-1) == "e");
+  BOOST_TEST(m.at(3) == "c");
+  BOOST_TEST(m.at(7) == "d");
+
+  std::vector<std::pair<int, std::string>> more = {
+    {7, "f"}, {0, "g"}, {12, "h"}, {0, "i"}};
+  m.insert(more.begin(), more.end());
+  BOOST_TEST(m.size() == 5u);
+  BOOST_TEST(m.at(-1) == "e");
+  BOOST_TEST(m.at(0) == "i");
+  BOOST_TEST(m.at(3) == "c");
+  BOOST_TEST(m.at(7) == "f");
+  BOOST_TEST(m.at(12) == "h");
+}
+
+BOOST_AUTO_TEST_CASE(flatmap_merge)
+{
+  dfe::FlatMap<std::string, int> a = {{"abc", 1}, {"def", 2}, {"xyz", 3}};
+  dfe::FlatMap<std::string, int> b = {{"def", 4}, {"ghi", 5}, {"zzz", 6}};
+
+  a.merge(b);
+  BOOST_TEST(a.size() == 5u);
+  BOOST_TEST(a.at("abc") == 1);
+  BOOST_TEST(a.at("def") == 4);
+  BOOST_TEST(a.at("ghi") == 5);
+  BOOST_TEST(a.at("xyz") == 3);
+  BOOST_TEST(a.at("zzz") == 6);
+  // merging does not modify the source
+  BOOST_TEST(b.size() == 3u);
+  BOOST_TEST(b.at("def") == 4);
+}
+
+BOOST_AUTO_TEST_CASE(flatmap_erase)
+{
+  dfe::FlatMap<int, std::string> m;
+
+  for (int i = 0; i < 32; ++i) { m.emplace(i, std::to_string(i)); }
+  BOOST_TEST(m.erase(-1) == 0u);
+  BOOST_TEST(m.erase(32) == 0u);
+  BOOST_TEST(m.size() == 32u);
+  // remove all odd elements
+  for (int i = 1; i < 32; i += 2) { BOOST_TEST(m.erase(i) == 1u); }
+  BOOST_TEST(m.size() == 16u);
+  for (int i = 0; i < 32; ++i) {
+    if ((i % 2) == 0) {
+      BOOST_TEST(m.at(i) == std::to_string(i));
+    } else {
+      BOOST_TEST(not m.contains(i));
+      BOOST_CHECK_THROW(m.at(i), std::out_of_range);
+    }
+  }
+  // removed elements can be added again
+  m.emplace(3, "three");
+  BOOST_TEST(m.size() == 17u);
+  BOOST_TEST(m.at(3) == "three");
+  BOOST_TEST(m.at(2) == "2");
+  BOOST_TEST(m.at(4) == "4");
+  // modification through the writable access
+  m.at(4) += "x";
+  BOOST_TEST(m.at(4) == "4x");
+  // remove the remaining elements
+  BOOST_TEST(m.erase(3) == 1u);
+  for (int i = 0; i < 32; i += 2) { BOOST_TEST(m.erase(i) == 1u); }
+  BOOST_TEST(m.empty());
+}
+
+BOOST_AUTO_TEST_CASE(flatmap_heterogeneous)
+{
+  // transparent comparison allows lookups w/o temporary keys
+  dfe::FlatMap<std::string, int, std::less<>> m = {{"abc", 1}, {"xyz", 2}};
+  const char* key = "xyz";
+
+  BOOST_TEST(m.at(key) == 2);
+  BOOST_TEST(m.at("abc") == 1);
+  BOOST_TEST(m.contains(key));
+  BOOST_TEST(not m.contains("def"));
+  BOOST_CHECK_THROW(m.at("def"), std::out_of_range);
+  BOOST_TEST(m.erase(key) == 1u);
+  BOOST_TEST(not m.contains(std::string(key)));
+#if 201703L <= __cplusplus
+  BOOST_TEST(m.at(std::string_view("abc")) == 1);
+#endif
+}
+
+// hash map w/ the same interface
+
+BOOST_AUTO_TEST_CASE(flathashmap_int_int)
+{
+  dfe::FlatHashMap<int, int> m;
+
+  m.emplace(2, 12);
+  m.emplace(-2, 23);
+  m.emplace(54321, -2);
+  m.emplace(INT_MAX, INT_MAX);
+  m.emplace(INT_MAX, 0);
+
+  BOOST_TEST(m.size() == 4);
+  BOOST_TEST(m.at(2) == 12);
+  BOOST_TEST(m.at(-2) == 23);
+  BOOST_TEST(m.at(54321) == -2);
+  BOOST_TEST(m.at(INT_MAX) == 0);
+  BOOST_TEST(!m.contains(0));
+  BOOST_TEST(!m.contains(1));
+  BOOST_TEST(!m.contains(-1));
+  BOOST_TEST(!m.contains(INT_MIN));
+  BOOST_CHECK_THROW(m.at(1), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(flathashmap_erase_many)
+{
+  static constexpr int kNumElements = 4096;
+
+  dfe::FlatHashMap<int, std::string> m;
+  // multiples of the table size collide w/o proper hash mixing
+  for (int i = 0; i < kNumElements; ++i) {
+    m.emplace(256 * i, std::to_string(i));
+  }
+  BOOST_TEST(m.size() == kNumElements);
+  for (int i = 0; i < kNumElements; ++i) {
+    BOOST_TEST(m.at(256 * i) == std::to_string(i));
+    BOOST_TEST(not m.contains(256 * i + 1));
+  }
+  // remove every third element and check that all others remain accessible
+  for (int i = 0; i < kNumElements; i += 3) {
+    BOOST_TEST(m.erase(256 * i) == 1u);
+  }
+  BOOST_TEST(m.erase(256 * 3) == 0u);
+  for (int i = 0; i < kNumElements; ++i) {
+    if ((i % 3) == 0) {
+      BOOST_TEST(not m.contains(256 * i));
+    } else {
+      BOOST_TEST(m.at(256 * i) == std::to_string(i));
+    }
+  }
+  // re-add removed elements w/ new values
+  for (int i = 0; i < kNumElements; i += 3) { m.emplace(256 * i, "x"); }
+  BOOST_TEST(m.size() == kNumElements);
+  BOOST_TEST(m.at(0) == "x");
+  BOOST_TEST(m.at(256) == "1");
+  m.clear();
+  BOOST_TEST(m.empty());
+  BOOST_TEST(not m.contains(256));
+}
+
+BOOST_AUTO_TEST_CASE(flathashmap_range_merge)
+{
+  std::vector<std::pair<std::string, int>> pairs = {
+    {"abc", 1}, {"def", 2}, {"abc", 3}};
+
+  dfe::FlatHashMap<std::string, int> a(pairs.begin(), pairs.end());
+  BOOST_TEST(a.size() == 2u);
+  BOOST_TEST(a.at("abc") == 3);
+  BOOST_TEST(a.at("def") == 2);
+
+  dfe::FlatHashMap<std::string, int> b = {{"def", 4}, {"ghi", 5}};
+  a.merge(b);
+  BOOST_TEST(a.size() == 3u);
+  BOOST_TEST(a.at("abc") == 3);
+  BOOST_TEST(a.at("def") == 4);
+  BOOST_TEST(a.at("ghi") == 5);
+}
+
+// transparent hash and equality for string-like keys
+struct StringHash {
+  using is_transparent = void;
+  std::size_t operator()(const std::string& s) const
+  {
+    return std::hash<std::string>()(s);
+  }
+  std::size_t operator()(const char* s) const
+  {
+    return std::hash<std::string>()(s);
+  }
+};
+
+BOOST_AUTO_TEST_CASE(flathashmap_heterogeneous)
+{
+  dfe::FlatHashMap<std::string, int, StringHash, std::equal_to<>> m = {
+    {"abc", 1}, {"xyz", 2}};
+
+  BOOST_TEST(m.at("abc") == 1);
+  BOOST_TEST(m.contains("xyz"));
+  BOOST_TEST(not m.contains("def"));
+  BOOST_TEST(m.erase("xyz") == 1u);
+  BOOST_TEST(m.size() == 1u);
+}
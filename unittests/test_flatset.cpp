@@ -3,6 +3,9 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <vector>
+
 #include "dfe/dfe_flat.hpp"
 
 using dfe::FlatSet;
@@ -90,3 +93,55 @@ BOOST_AUTO_TEST_CASE(flatset_custom_compare)
   BOOST_CHECK(!set.contains(Thing{4, 1.45}));
   BOOST_CHECK(!set.contains(Thing{27, -1.23}));
 }
+
+BOOST_AUTO_TEST_CASE(flatset_range)
+{
+  std::vector<Thing> things = {{4, 0.5}, {-1, 1.5}, {4, 2.5}, {9, 3.5}};
+
+  // equivalent elements are resolved like with sequential insert_or_assign
+  FlatSet<Thing, ThingComparator> set(things.begin(), things.end());
+  FlatSet<Thing, ThingComparator> sequential;
+  for (const auto& thing : things) { sequential.insert_or_assign(thing); }
+  BOOST_TEST(set.size() == 3u);
+  BOOST_TEST(set.size() == sequential.size());
+  for (const auto& thing : sequential) {
+    BOOST_TEST(set.at(thing.index).value == thing.value);
+  }
+  BOOST_TEST(set.at(4).value == 2.5);
+
+  // new elements replace existing ones
+  std::vector<Thing> more = {{12, 0.25}, {-1, 0.75}, {-5, 1.25}, {12, 1.75}};
+  set.insert(more.begin(), more.end());
+  BOOST_TEST(set.size() == 5u);
+  BOOST_TEST(set.at(-5).value == 1.25);
+  BOOST_TEST(set.at(-1).value == 0.75);
+  BOOST_TEST(set.at(4).value == 2.5);
+  BOOST_TEST(set.at(9).value == 3.5);
+  BOOST_TEST(set.at(12).value == 1.75);
+  BOOST_TEST(std::is_sorted(set.begin(), set.end(), ThingComparator()));
+}
+
+BOOST_AUTO_TEST_CASE(flatset_merge)
+{
+  FlatSet<int> odd = {1, 3, 5, 7, 9, 11};
+  FlatSet<int> low = {0, 1, 2, 3, 4, 5};
+
+  odd.merge(low);
+  BOOST_TEST(odd.size() == 9u);
+  for (int x : {0, 1, 2, 3, 4, 5, 7, 9, 11}) { BOOST_TEST(odd.contains(x)); }
+  BOOST_TEST(std::is_sorted(odd.begin(), odd.end()));
+  // merging w/ empty sets
+  FlatSet<int> empty;
+  odd.merge(empty);
+  BOOST_TEST(odd.size() == 9u);
+  empty.merge(odd);
+  BOOST_TEST(empty.size() == 9u);
+  // equivalent elements from the merged set replace existing ones
+  FlatSet<Thing, ThingComparator> a = {{1, 0.5}, {2, 1.5}};
+  FlatSet<Thing, ThingComparator> b = {{2, 2.5}, {3, 3.5}};
+  a.merge(b);
+  BOOST_TEST(a.size() == 3u);
+  BOOST_TEST(a.at(1).value == 0.5);
+  BOOST_TEST(a.at(2).value == 2.5);
+  BOOST_TEST(a.at(3).value == 3.5);
+}
@@ -1,8 +1,12 @@
 /// \file
 /// \brief Unit tests for dfe::Histogram
 
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
 #include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
 
 #include "dfe/dfe_histogram.hpp"
 
@@ -186,3 +190,367 @@ BOOST_AUTO_TEST_CASE(histogram_variable1d)
   BOOST_TEST(h.value({1}) == 1);
   BOOST_TEST(h.value({2}) == 3);
 }
+
+BOOST_AUTO_TEST_CASE(histogram_variable_search)
+{
+  // compare w/ the standard search for all tree shapes up to five levels
+  for (size_t n = 1; n < 64; ++n) {
+    std::vector<double> edges;
+    for (size_t i = 0; i < n; ++i) {
+      edges.push_back(i * i);
+    }
+    dfe::histogram_impl::EdgeSearch<double> search(edges);
+    for (double x = -1.0; x < (n * n); x += 0.5) {
+      auto expected = std::upper_bound(edges.begin(), edges.end(), x);
+      BOOST_TEST(search.upper_bound(x) == (expected - edges.begin()));
+    }
+    BOOST_TEST(
+      search.upper_bound(std::numeric_limits<double>::quiet_NaN()) == n);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(histogram_overflow_variable1d)
+{
+  using H1 = dfe::Histogram<double, dfe::OverflowVariableAxis<double>>;
+
+  BOOST_CHECK_THROW(H1({1.0}), std::invalid_argument);
+  BOOST_CHECK_THROW(H1({1.0, -2.0, 3.0}), std::invalid_argument);
+
+  H1 h({1.0, 10.0, 100.0, 1000.0});
+  BOOST_TEST(h.size() == H1::Index{5});
+  BOOST_CHECK_NO_THROW(h.fill(0.0));
+  BOOST_CHECK_NO_THROW(h.fill(std::numeric_limits<double>::lowest()));
+  BOOST_CHECK_NO_THROW(h.fill(1));
+  BOOST_CHECK_NO_THROW(h.fill(5));
+  BOOST_CHECK_NO_THROW(h.fill(100));
+  BOOST_CHECK_NO_THROW(h.fill(999));
+  BOOST_CHECK_NO_THROW(h.fill(1000.0));
+  BOOST_CHECK_NO_THROW(h.fill(std::numeric_limits<double>::infinity()));
+  BOOST_CHECK_NO_THROW(h.fill(std::numeric_limits<double>::quiet_NaN()));
+  BOOST_TEST(h.value({0}) == 2);
+  BOOST_TEST(h.value({1}) == 2);
+  BOOST_TEST(h.value({2}) == 0);
+  BOOST_TEST(h.value({3}) == 2);
+  BOOST_TEST(h.value({4}) == 3);
+  // batch filling yields the same bins
+  std::vector<double> xs = {0.0, std::numeric_limits<double>::lowest(), 1,
+                            5, 100, 999, 1000.0,
+                            std::numeric_limits<double>::infinity(),
+                            std::numeric_limits<double>::quiet_NaN()};
+  H1 batch({1.0, 10.0, 100.0, 1000.0});
+  batch.fill_n(xs.size(), xs.data());
+  for (size_t i = 0; i < 5; ++i) {
+    BOOST_TEST(batch.value({i}) == h.value({i}));
+  }
+}
+
+// batch filling must be equivalent to filling each entry separately
+
+BOOST_AUTO_TEST_CASE(histogram_fill_n_overflow2)
+{
+  using H2 = dfe::Histogram<
+    double, dfe::OverflowAxis<double>, dfe::OverflowAxis<float>>;
+
+  // more entries than a single internal block
+  const size_t n = 1000;
+  std::vector<double> xs;
+  std::vector<float> ys;
+  std::vector<double> ws;
+  for (size_t i = 0; i < n; ++i) {
+    // covers under/overflow and exact bin edges
+    xs.push_back(-0.25 + 0.0015 * i);
+    ys.push_back(-10.0f + 0.03125f * (i % 750));
+    ws.push_back(0.5 * (i % 7));
+  }
+  xs[3] = std::numeric_limits<double>::quiet_NaN();
+  xs[5] = std::numeric_limits<double>::infinity();
+  xs[7] = -std::numeric_limits<double>::infinity();
+  ys[11] = std::numeric_limits<float>::quiet_NaN();
+
+  H2 scalar({0.0, 1.0, 8}, {-10.0f, 10.0f, 16});
+  H2 scalar_weighted({0.0, 1.0, 8}, {-10.0f, 10.0f, 16});
+  for (size_t i = 0; i < n; ++i) {
+    scalar.fill(xs[i], ys[i]);
+    scalar_weighted.fill(xs[i], ys[i], ws[i]);
+  }
+  H2 batch({0.0, 1.0, 8}, {-10.0f, 10.0f, 16});
+  H2 batch_weighted({0.0, 1.0, 8}, {-10.0f, 10.0f, 16});
+  batch.fill_n(n, xs.data(), ys.data());
+  batch_weighted.fill_n(n, xs.data(), ys.data(), ws.data());
+
+  // NaN and infinity end up in the overflow bin
+  BOOST_TEST(scalar.value({9, 1}) == 2);
+  for (size_t i = 0; i < 10; ++i) {
+    for (size_t j = 0; j < 18; ++j) {
+      BOOST_TEST(batch.value({i, j}) == scalar.value({i, j}));
+      BOOST_TEST(batch_weighted.value({i, j}) == scalar_weighted.value({i, j}));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(histogram_fill_n_uniform_nan)
+{
+  using H1 = dfe::Histogram<double, dfe::UniformAxis<double>>;
+  using S1 = dfe::StaticHistogram<double, dfe::StaticUniformAxis<double, 4>>;
+
+  // more entries than a single internal block w/ NaN in between
+  const size_t n = 600;
+  std::vector<double> xs;
+  for (size_t i = 0; i < n; ++i) {
+    xs.push_back(((i % 3) == 1) ? std::numeric_limits<double>::quiet_NaN()
+                                : 0.001 * (i % 1000));
+  }
+
+  H1 scalar({0.0, 1.0, 4});
+  S1 static_scalar({0.0, 1.0});
+  for (auto x : xs) {
+    scalar.fill(x);
+    static_scalar.fill(x);
+  }
+  H1 batch({0.0, 1.0, 4});
+  S1 static_batch({0.0, 1.0});
+  BOOST_CHECK_NO_THROW(batch.fill_n(n, xs.data()));
+  BOOST_CHECK_NO_THROW(static_batch.fill_n(n, xs.data()));
+
+  double total = 0;
+  for (size_t i = 0; i < 4; ++i) {
+    total += batch.value({i});
+    BOOST_TEST(batch.value({i}) == scalar.value({i}));
+    BOOST_TEST(static_batch.value({i}) == static_scalar.value({i}));
+  }
+  BOOST_TEST(total == n);
+}
+
+BOOST_AUTO_TEST_CASE(histogram_fill_n_out_of_range)
+{
+  using H2 =
+    dfe::Histogram<double, dfe::UniformAxis<double>, dfe::VariableAxis<double>>;
+
+  std::vector<double> xs = {0.1, 0.2, 0.3, 0.4, 0.5, 0.6};
+  std::vector<double> ys = {1.0, 10.0, 100.0, 1000.0, 10.0, 1.0};
+
+  H2 h({0.0, 1.0, 4}, {1.0, 10.0, 100.0, 1000.0});
+  BOOST_CHECK_NO_THROW(h.fill_n(3, xs.data(), ys.data()));
+  // the fourth entry is outside the variable axis
+  BOOST_CHECK_THROW(h.fill_n(6, xs.data(), ys.data()), std::out_of_range);
+  // entries before the invalid one are filled
+  BOOST_TEST(h.value({0, 0}) == 2);
+  BOOST_TEST(h.value({0, 1}) == 2);
+  BOOST_TEST(h.value({1, 2}) == 2);
+  BOOST_TEST(h.value({2, 1}) == 0);
+  // invalid entry on the uniform axis
+  xs[1] = 1.0;
+  BOOST_CHECK_THROW(h.fill_n(2, xs.data(), ys.data()), std::out_of_range);
+  BOOST_TEST(h.value({0, 0}) == 3);
+  BOOST_TEST(h.value({0, 1}) == 2);
+}
+
+BOOST_AUTO_TEST_CASE(histogram_add)
+{
+  dfe::Histogram1 a({0.0, 1.0, 4});
+  dfe::Histogram1 b({0.0, 1.0, 4});
+  a.fill(0.1);
+  b.fill(0.1, 2.0);
+  b.fill(2.0);
+  a += b;
+  BOOST_TEST(a.value({1}) == 3);
+  BOOST_TEST(a.value({5}) == 1);
+  BOOST_TEST(a.index(0.1) == (dfe::Histogram1::Index{1}));
+  dfe::Histogram1 c({0.0, 1.0, 3});
+  BOOST_CHECK_THROW(a += c, std::invalid_argument);
+}
+
+static constexpr size_t kNThreads = 4;
+static constexpr size_t kNFillsPerThread = 10000;
+
+BOOST_AUTO_TEST_CASE(histogram_concurrent_fill)
+{
+  using H = dfe::ConcurrentHistogram<
+    double, dfe::OverflowAxis<double>, dfe::UniformAxis<int>>;
+
+  H h({0.0, 1.0, 10}, {0, 4, 4});
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNThreads; ++t) {
+    threads.emplace_back([&h, t]() {
+      for (size_t i = 0; i < kNFillsPerThread; ++i) {
+        h.fill(0.05 + 0.1 * (i % 10), t);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  BOOST_TEST(h.num_shards() == kNThreads);
+
+  auto total = h.snapshot();
+  BOOST_TEST(total.size() == h.size());
+  BOOST_TEST(total.axis<0>().nbins() == 12u);
+  for (size_t i = 1; i < 11; ++i) {
+    for (size_t t = 0; t < kNThreads; ++t) {
+      BOOST_TEST(total.value({i, t}) == kNFillsPerThread / 10);
+    }
+  }
+  BOOST_TEST(total.value({0, 0}) == 0);
+  BOOST_TEST(total.value({11, 0}) == 0);
+  // merging resets the shards
+  auto merged = h.merge();
+  BOOST_TEST(merged.value({1, 0}) == kNFillsPerThread / 10);
+  BOOST_TEST(h.snapshot().value({1, 0}) == 0);
+  // the shards of the calling thread are not shared between instances
+  H other({0.0, 1.0, 10}, {0, 4, 4});
+  h.fill(0.15, 1);
+  other.fill_n(1, std::vector<double>{0.25}.data(), std::vector<int>{2}.data());
+  BOOST_TEST(h.snapshot().value({2, 1}) == 1);
+  BOOST_TEST(h.snapshot().value({3, 2}) == 0);
+  BOOST_TEST(other.snapshot().value({3, 2}) == 1);
+  BOOST_TEST(other.snapshot().value({2, 1}) == 0);
+  // alternating between instances reuses the shards of the calling thread
+  for (size_t i = 0; i < 100; ++i) {
+    h.fill(0.15, 1);
+    other.fill(0.15, 1);
+  }
+  BOOST_TEST(&h.local() == &h.local());
+  BOOST_TEST(&h.local() != &other.local());
+  BOOST_TEST(h.num_shards() == kNThreads + 1);
+  BOOST_TEST(other.num_shards() == 1u);
+  BOOST_TEST(h.snapshot().value({2, 1}) == 101);
+  BOOST_TEST(other.snapshot().value({2, 1}) == 100);
+  // shard bins start on a separate cache line
+  auto address = reinterpret_cast<std::uintptr_t>(h.local().data());
+  BOOST_TEST(address % 64 == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(histogram_atomic_fill)
+{
+  using H = dfe::AtomicHistogram<
+    double, dfe::OverflowAxis<double>, dfe::UniformAxis<int>>;
+
+  H h({0.0, 1.0, 10}, {0, 4, 4});
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNThreads; ++t) {
+    threads.emplace_back([&h]() {
+      for (size_t i = 0; i < kNFillsPerThread; ++i) {
+        h.fill(0.05 + 0.1 * (i % 10), 1, 0.5);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto total = h.snapshot();
+  for (size_t i = 1; i < 11; ++i) {
+    BOOST_TEST(h.value({i, 1}) == 0.5 * kNThreads * kNFillsPerThread / 10);
+    BOOST_TEST(total.value({i, 1}) == h.value({i, 1}));
+    BOOST_TEST(total.value({i, 0}) == 0);
+  }
+  BOOST_CHECK_THROW(h.value({12, 0}), std::out_of_range);
+  BOOST_CHECK_THROW(h.fill(0.5, 4), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(histogram_sparse)
+{
+  using Axis = dfe::OverflowAxis<double>;
+  using Sparse = dfe::SparseHistogram<double, Axis, Axis, Axis, Axis>;
+  using Dense = dfe::Histogram<double, Axis, Axis, Axis, Axis>;
+
+  // 1e8 bins only need a few stored ones
+  Sparse sparse({0.0, 1.0, 98}, {0.0, 1.0, 98}, {0.0, 1.0, 98}, {0.0, 1.0, 98});
+  Dense dense({0.0, 1.0, 8}, {0.0, 1.0, 8}, {0.0, 1.0, 8}, {0.0, 1.0, 8});
+  std::vector<double> xs;
+  std::vector<double> ys;
+  for (size_t i = 0; i < 1000; ++i) {
+    xs.push_back(-0.1 + 0.0012 * i);
+    ys.push_back(0.5);
+    sparse.fill(xs.back(), 0.25, 0.5, 1.5, 0.5);
+  }
+  sparse.fill_n(xs.size(), xs.data(), ys.data(), ys.data(), ys.data());
+  BOOST_TEST(sparse.value({0, 25, 50, 99}) == 84 * 0.5);
+  BOOST_TEST(sparse.value({0, 50, 50, 50}) == 84);
+  BOOST_TEST(sparse.value({1, 50, 50, 50}) == 8);
+  BOOST_TEST(sparse.value({1, 1, 1, 1}) == 0);
+  BOOST_CHECK_THROW(sparse.value({100, 1, 1, 1}), std::out_of_range);
+
+  // conversion to dense storage keeps all bins
+  Sparse small({0.0, 1.0, 8}, {0.0, 1.0, 8}, {0.0, 1.0, 8}, {0.0, 1.0, 8});
+  for (size_t i = 0; i < xs.size(); ++i) {
+    small.fill(xs[i], xs[i], 0.5, 1 - xs[i], 0.5 * i);
+    dense.fill(xs[i], xs[i], 0.5, 1 - xs[i], 0.5 * i);
+  }
+  small += small;
+  dense += dense;
+  auto converted = small.dense();
+  for (size_t i = 0; i < 10; ++i) {
+    for (size_t j = 0; j < 10; ++j) {
+      BOOST_TEST(converted.value({i, i, 5, j}) == dense.value({i, i, 5, j}));
+      BOOST_TEST(small.value({i, i, 5, j}) == dense.value({i, i, 5, j}));
+    }
+  }
+  Sparse other({0.0, 1.0, 8}, {0.0, 1.0, 8}, {0.0, 1.0, 8}, {0.0, 1.0, 7});
+  BOOST_CHECK_THROW(small += other, std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(histogram_edges_data)
+{
+  using H2 =
+    dfe::Histogram<double, dfe::UniformAxis<int>, dfe::OverflowAxis<double>>;
+
+  H2 h({0, 8, 4}, {-1.0, 1.0, 2});
+  BOOST_TEST(h.axis<0>().edges() == (std::vector<int>{0, 2, 4, 6, 8}));
+  BOOST_TEST(h.axis<1>().edges() == (std::vector<double>{-1.0, 0.0, 1.0}));
+  BOOST_TEST(
+    dfe::VariableAxis<float>({1.0f, 2.0f, 4.0f}).edges() ==
+    (std::vector<float>{1.0f, 2.0f, 4.0f}));
+  BOOST_TEST(
+    dfe::OverflowVariableAxis<float>({1.0f, 2.0f}).edges() ==
+    (std::vector<float>{1.0f, 2.0f}));
+  // raw data is column-major
+  h.fill(3, 0.5, 2.0);
+  h.fill(7, -2.0, 3.0);
+  BOOST_TEST(h.data()[1 + 2 * 4] == 2.0);
+  BOOST_TEST(h.data()[3 + 0 * 4] == 3.0);
+}
+
+BOOST_AUTO_TEST_CASE(histogram_static)
+{
+  using XAxis = dfe::StaticOverflowAxis<double, 8>;
+  using YAxis = dfe::StaticUniformAxis<int, 4>;
+  using Static = dfe::StaticHistogram<double, XAxis, YAxis>;
+  using Dynamic =
+    dfe::Histogram<double, dfe::OverflowAxis<double>, dfe::UniformAxis<int>>;
+
+  // axes can be used at compile time
+  constexpr XAxis x(0.0, 1.0);
+  static_assert(XAxis::nbins() == 10, "Inconsistent number of bins");
+  static_assert(x.index(-1.0) == 0, "Inconsistent underflow bin");
+  static_assert(x.index(0.3) == 3, "Inconsistent data bin");
+  static_assert(x.index(1.0) == 9, "Inconsistent overflow bin");
+  // all bins are stored within the histogram
+  static_assert(
+    (10 * 4 * sizeof(double)) <= sizeof(Static), "Bins are not stored inline");
+
+  Static h({0.0, 1.0}, {0, 4});
+  Dynamic expected({0.0, 1.0, 8}, {0, 4, 4});
+  BOOST_TEST(h.size() == expected.size());
+  BOOST_TEST(h.axis<0>().edges() == expected.axis<0>().edges());
+  BOOST_TEST(h.axis<1>().edges() == expected.axis<1>().edges());
+  std::vector<double> xs;
+  std::vector<int> ys;
+  for (size_t i = 0; i < 100; ++i) {
+    xs.push_back(-0.2 + 0.014 * i);
+    ys.push_back(i % 4);
+    h.fill(xs.back(), ys.back(), 0.5);
+    expected.fill(xs.back(), ys.back(), 0.5);
+  }
+  h.fill_n(xs.size(), xs.data(), ys.data());
+  expected.fill_n(xs.size(), xs.data(), ys.data());
+  BOOST_CHECK_THROW(h.fill(0.5, 4), std::out_of_range);
+  BOOST_CHECK_THROW(h.value({10, 0}), std::out_of_range);
+  auto dense = h.dense();
+  for (size_t i = 0; i < 10; ++i) {
+    for (size_t j = 0; j < 4; ++j) {
+      BOOST_TEST(h.value({i, j}) == expected.value({i, j}));
+      BOOST_TEST(dense.value({i, j}) == expected.value({i, j}));
+    }
+  }
+}
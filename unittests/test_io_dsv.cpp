@@ -3,6 +3,9 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <fstream>
+#include <sstream>
+
 #include "dfe/dfe_io_dsv.hpp"
 #include "dfe/dfe_namedtuple.hpp"
 #include "record.hpp"
@@ -100,6 +103,65 @@ BOOST_AUTO_TEST_CASE(tsv_untyped_write)
     writer.append(1, 2, false, true, 123.2), std::invalid_argument);
 }
 
+BOOST_AUTO_TEST_CASE(csv_untyped_write_buffered)
+{
+  auto read_file = [](const char* path) {
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+  };
+
+  {
+    // tiny flush threshold to write to the file after every row
+    dfe::CsvWriter writer({"a", "b", "c"}, "buffered.csv", 4, 1);
+    BOOST_CHECK_NO_THROW(writer.append(-12, 0.125, "x"));
+    BOOST_CHECK_EQUAL(read_file("buffered.csv"), "a,b,c\n-12,0.125,x\n");
+    // rejected rows must not leave partial output behind
+    BOOST_CHECK_THROW(writer.append(1, 2), std::invalid_argument);
+    BOOST_CHECK_THROW(writer.append(1, 2, 3, 4), std::invalid_argument);
+    BOOST_CHECK_NO_THROW(writer.append(true, 3.14159265, 'y'));
+    BOOST_CHECK_EQUAL(
+      read_file("buffered.csv"), "a,b,c\n-12,0.125,x\n1,3.142,y\n");
+  }
+  {
+    // large flush threshold keeps all rows, including the header, in memory
+    dfe::CsvWriter writer({"a", "b", "c"}, "buffered.csv", 6, 1u << 20);
+    BOOST_CHECK_NO_THROW(writer.append(1u, 1.0 / 3.0, std::string("z")));
+    BOOST_CHECK_EQUAL(read_file("buffered.csv"), "");
+    BOOST_CHECK_NO_THROW(writer.flush());
+    BOOST_CHECK_EQUAL(read_file("buffered.csv"), "a,b,c\n1,0.333333,z\n");
+    BOOST_CHECK_NO_THROW(writer.append(2u, 1e-12, "w"));
+  }
+  BOOST_CHECK_EQUAL(
+    read_file("buffered.csv"), "a,b,c\n1,0.333333,z\n2,1e-12,w\n");
+}
+
+BOOST_AUTO_TEST_CASE(dsv_write_large_precision)
+{
+  const double x = -1e-300 / 3.0;
+  {
+    dfe::CsvWriter writer({"x"}, "precision.csv", 80);
+    BOOST_CHECK_NO_THROW(writer.append(x));
+  }
+  std::ifstream file("precision.csv");
+  std::string header, line;
+  BOOST_REQUIRE(std::getline(file, header));
+  BOOST_REQUIRE(std::getline(file, line));
+  // large precision must not truncate the output, e.g. the exponent
+  std::istringstream is(line);
+  double y = 0;
+  is >> y;
+  BOOST_TEST(y == x);
+  BOOST_TEST(is.eof());
+#if not defined(DFE_IO_DSV_USE_FROM_CHARS)
+  std::ostringstream os;
+  os.precision(80);
+  os << x;
+  BOOST_TEST(line == os.str());
+#endif
+}
+
 // construct a path to an example data file
 std::string
 make_data_path(const char* filename)
@@ -211,6 +273,99 @@ BOOST_AUTO_TEST_CASE(csv_namedtuple_read_missing_optionals)
   }
 }
 
+// parallel readers
+
+BOOST_AUTO_TEST_CASE(csv_namedtuple_parallel_read)
+{
+  {
+    dfe::NamedTupleCsvWriter<Record> writer("test_parallel.csv");
+    for (size_t i = 0; i < kNRecords; ++i) { writer.append(make_record(i)); }
+  }
+  // small blocks to ensure multiple batches w/ multiple blocks each
+  for (size_t block_size : {1u, 97u, 1024u, 1u << 20}) {
+    BOOST_TEST_CONTEXT("block size " << block_size)
+    {
+      dfe::NamedTupleCsvParallelReader<Record> reader(
+        "test_parallel.csv", {}, true, 3, block_size);
+      std::vector<Record> records;
+      size_t i = 0;
+
+      BOOST_TEST(reader.num_threads() == 3u);
+      while (reader.read(records)) {
+        for (const auto& record : records) {
+          BOOST_TEST(record.tuple() == make_record(i).tuple());
+          i += 1;
+        }
+      }
+      BOOST_TEST(i == kNRecords);
+      BOOST_TEST(reader.num_records() == kNRecords);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(csv_namedtuple_parallel_read_moved)
+{
+  {
+    dfe::NamedTupleCsvWriter<Record> writer("test_parallel_moved.csv");
+    for (size_t i = 0; i < kNRecords; ++i) { writer.append(make_record(i)); }
+  }
+  // the worker threads must survive moving the reader between batches
+  dfe::NamedTupleCsvParallelReader<Record> first(
+    "test_parallel_moved.csv", {}, true, 4, 64);
+  std::vector<Record> records;
+  size_t i = 0;
+
+  BOOST_TEST(first.read(records));
+  i += records.size();
+  auto second = std::move(first);
+  while (second.read(records)) {
+    for (const auto& record : records) {
+      BOOST_TEST(record.tuple() == make_record(i).tuple());
+      i += 1;
+    }
+  }
+  BOOST_TEST(i == kNRecords);
+  BOOST_TEST(second.num_records() == kNRecords);
+}
+
+BOOST_AUTO_TEST_CASE(tsv_namedtuple_parallel_read_extra_columns)
+{
+  dfe::NamedTupleTsvParallelReader<Record> reader(
+    make_data_path("extra_columns.tsv"), {}, true, 2, 64);
+  std::vector<Record> records;
+  std::vector<int> extra;
+  size_t i = 0;
+
+  while (reader.read(records, extra)) {
+    BOOST_TEST(extra.size() == 3 * records.size());
+    for (size_t j = 0; j < records.size(); ++j, ++i) {
+      BOOST_TEST(records[j].tuple() == make_record(i).tuple());
+      BOOST_TEST(extra[3 * j + 0] == i);
+      BOOST_TEST(extra[3 * j + 1] == i);
+      BOOST_TEST(extra[3 * j + 2] == i);
+    }
+  }
+  BOOST_TEST(i == kNOnfile);
+  BOOST_TEST(reader.num_records() == kNOnfile);
+  BOOST_TEST(reader.num_extra_columns() == 3);
+}
+
+BOOST_AUTO_TEST_CASE(csv_namedtuple_parallel_read_bad_files)
+{
+  using Reader = dfe::NamedTupleCsvParallelReader<Record>;
+
+  std::vector<Record> records;
+  BOOST_CHECK_THROW(Reader("does/not/exist.csv"), std::runtime_error);
+  BOOST_CHECK_THROW(
+    Reader(make_data_path("too_few_columns.csv"), {}, true, 2, 16)
+      .read(records),
+    std::runtime_error);
+  BOOST_CHECK_THROW(
+    Reader(make_data_path("too_many_columns.csv"), {}, true, 2, 16)
+      .read(records),
+    std::runtime_error);
+}
+
 // failure tests for readers
 
 BOOST_AUTO_TEST_CASE(tsv_namedtuple_read_bad_files)
@@ -240,3 +395,118 @@ BOOST_AUTO_TEST_CASE(tsv_namedtuple_read_bad_files)
   BOOST_CHECK_THROW(
     Reader(make_data_path("too_many_columns.tsv")).read(r), std::runtime_error);
 }
+
+BOOST_AUTO_TEST_CASE(csv_untyped_read_views)
+{
+  {
+    dfe::CsvWriter writer({"col0", "col1", "col2"}, "untyped.csv");
+    writer.append(1, "xy", 2.5);
+    writer.append(-2, "", 0.25);
+  }
+
+  dfe::io_dsv_impl::DsvReader<','> reader("untyped.csv");
+  std::vector<dfe::io_dsv_impl::StringView> views;
+  std::vector<std::string> columns;
+
+  BOOST_TEST(reader.read(columns));
+  BOOST_TEST(columns == (std::vector<std::string>{"col0", "col1", "col2"}));
+  BOOST_TEST(reader.read(views));
+  BOOST_TEST(views.size() == 3u);
+  BOOST_TEST(views[0].str() == "1");
+  BOOST_TEST(views[1].str() == "xy");
+  BOOST_TEST(views[2].str() == "2.5");
+  BOOST_TEST(reader.read(views));
+  BOOST_TEST(views.size() == 3u);
+  BOOST_TEST(views[0].str() == "-2");
+  BOOST_TEST(views[1].empty());
+  BOOST_TEST(views[2].str() == "0.25");
+  BOOST_TEST(not reader.read(views));
+  BOOST_TEST(reader.num_lines() == 3u);
+}
+
+BOOST_AUTO_TEST_CASE(csv_namedtuple_read_unterminated)
+{
+  // last line without a trailing newline must still be read
+  {
+    std::ofstream file("unterminated.csv", std::ios_base::binary);
+    file << "x,y,z,a,b,c,d\n";
+    file << "0,0,0,0,0,-0,0\n";
+    file << "1,-2,4,8,0.23126120865345001,-42.53425,1";
+  }
+
+  dfe::NamedTupleCsvReader<Record> reader("unterminated.csv");
+
+  TEST_READER_RECORDS(reader);
+  BOOST_TEST(reader.num_records() == 2u);
+}
+
+// string conversion
+
+template<typename T>
+static T
+parse_with_stream(const std::string& str)
+{
+  T value = T();
+  std::istringstream is(str);
+  is >> value;
+  return value;
+}
+
+template<typename T>
+static T
+parse_with_dsv(const std::string& str)
+{
+  T value = T();
+  dfe::io_dsv_impl::parse(
+    dfe::io_dsv_impl::StringView(str.data(), str.size()), value);
+  return value;
+}
+
+#define TEST_PARSE_CONSISTENT(type, str) \
+  BOOST_TEST( \
+    parse_with_dsv<type>(str) == parse_with_stream<type>(str), \
+    "inconsistent conversion of '" << str << "' to " #type)
+
+BOOST_AUTO_TEST_CASE(dsv_parse_integer)
+{
+  for (auto str : {"0", "1", "-1", "12", "+12", " 12", "-32768", "32767",
+                   "-32769", "32768", "1e3", "abc", ""}) {
+    TEST_PARSE_CONSISTENT(int16_t, str);
+  }
+  for (auto str : {"0", "-0", "1", "255", "256", "-1", "x"}) {
+    TEST_PARSE_CONSISTENT(uint8_t, str);
+  }
+  for (auto str : {"0", "-9223372036854775808", "9223372036854775807",
+                   "-9223372036854775809", "9223372036854775808"}) {
+    TEST_PARSE_CONSISTENT(int64_t, str);
+  }
+  for (auto str : {"0", "18446744073709551615", "18446744073709551616"}) {
+    TEST_PARSE_CONSISTENT(uint64_t, str);
+  }
+  for (auto str : {"0", "1", "2", "true", "-1"}) {
+    TEST_PARSE_CONSISTENT(bool, str);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(dsv_parse_floating_point)
+{
+  for (auto str :
+       {"0", "-0", "1", "-1", "1.", ".5", "0.1", "-42.53425", "1.25e-3",
+        "1.25E+3", "12345678901234567890", "0.23126120865345001",
+        "-42.5342500000000001", "1e308", "4.9e-324", "1e400", "1e", "-", "."}) {
+    TEST_PARSE_CONSISTENT(double, str);
+    TEST_PARSE_CONSISTENT(float, str);
+  }
+  // rounding behaviour for random values w/ different number of digits
+  std::ostringstream os;
+  for (int precision = 1; precision <= 17; ++precision) {
+    for (int i = 0; i < 1024; ++i) {
+      double x = std::ldexp(1.0 + (0.61803398875 * i), (i % 64) - 32);
+      os.str("");
+      os.precision(precision);
+      os << x;
+      TEST_PARSE_CONSISTENT(double, os.str());
+      TEST_PARSE_CONSISTENT(float, os.str());
+    }
+  }
+}
@@ -3,10 +3,24 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "dfe/dfe_histogram.hpp"
 #include "dfe/dfe_io_numpy.hpp"
 #include "dfe/dfe_namedtuple.hpp"
 #include "record.hpp"
 
+#if defined(__unix__) or defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 static constexpr size_t kNRecords = 1024;
 
 BOOST_TEST_DONT_PRINT_LOG_VALUE(Record::Tuple)
@@ -22,3 +36,385 @@ BOOST_AUTO_TEST_CASE(numpy_namedtuple_write)
     }
   }
 }
+
+static std::string
+read_file(const char* path)
+{
+  std::ifstream file(path, std::ios_base::binary);
+  std::stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+BOOST_AUTO_TEST_CASE(numpy_namedtuple_write_batch)
+{
+  std::vector<Record> records;
+  for (size_t i = 0; i < kNRecords; ++i) {
+    records.push_back(make_record(i));
+  }
+  // small buffer size to write to file multiple times
+  {
+    dfe::NamedTupleNumpyWriter<Record> writer("test_single.npy", 100);
+    for (const auto& record : records) {
+      BOOST_CHECK_NO_THROW(writer.append(record));
+    }
+  }
+  {
+    dfe::NamedTupleNumpyWriter<Record> writer("test_pointer.npy", 100);
+    BOOST_CHECK_NO_THROW(writer.append(records.data(), 10));
+    BOOST_CHECK_NO_THROW(
+      writer.append(records.data() + 10, records.size() - 10));
+  }
+  {
+    dfe::NamedTupleNumpyWriter<Record> writer("test_range.npy");
+    BOOST_CHECK_NO_THROW(writer.append(records.begin(), records.end()));
+  }
+
+  auto expected = read_file("test.npy");
+  // header length is stored at bytes 8,9 as 2byte little endian unsigned
+  std::size_t header_size = 10 + static_cast<uint8_t>(expected[8]) +
+                            (static_cast<uint8_t>(expected[9]) << 8);
+  // members are stored w/o padding
+  std::size_t record_size = sizeof(Record::x) + sizeof(Record::y) +
+                            sizeof(Record::z) + sizeof(Record::a) +
+                            sizeof(Record::b) + sizeof(Record::c) +
+                            sizeof(Record::d);
+  BOOST_TEST(expected.size() == header_size + kNRecords * record_size);
+  BOOST_TEST(read_file("test_single.npy") == expected);
+  BOOST_TEST(read_file("test_pointer.npy") == expected);
+  BOOST_TEST(read_file("test_range.npy") == expected);
+}
+
+BOOST_AUTO_TEST_CASE(numpy_namedtuple_write_close)
+{
+  auto expected = read_file("test.npy");
+  {
+    dfe::NamedTupleNumpyWriter<Record> writer("test_close.npy");
+    for (size_t i = 0; i < kNRecords; ++i) {
+      writer.append(make_record(i));
+    }
+    // the file is complete after an explicit close
+    BOOST_CHECK_NO_THROW(writer.close());
+    BOOST_TEST(read_file("test_close.npy") == expected);
+    // closing again does nothing
+    BOOST_CHECK_NO_THROW(writer.close());
+  }
+  BOOST_TEST(read_file("test_close.npy") == expected);
+  {
+    // buffered records of the target are written before it is replaced
+    dfe::NamedTupleNumpyWriter<Record> writer("test_move_first.npy");
+    dfe::NamedTupleNumpyWriter<Record> other("test_move_second.npy");
+    for (size_t i = 0; i < kNRecords; ++i) {
+      writer.append(make_record(i));
+      other.append(make_record(i));
+    }
+    writer = std::move(other);
+    BOOST_TEST(read_file("test_move_first.npy") == expected);
+  }
+  BOOST_TEST(read_file("test_move_second.npy") == expected);
+}
+
+#if defined(__unix__) or defined(__APPLE__)
+BOOST_AUTO_TEST_CASE(numpy_namedtuple_write_close_error)
+{
+  // limit the file size to provoke write errors w/o terminating the process
+  auto handler = std::signal(SIGXFSZ, SIG_IGN);
+  struct rlimit previous;
+  BOOST_REQUIRE(::getrlimit(RLIMIT_FSIZE, &previous) == 0);
+  struct rlimit limited = previous;
+  limited.rlim_cur = 4096;
+  BOOST_REQUIRE(::setrlimit(RLIMIT_FSIZE, &limited) == 0);
+  {
+    dfe::NamedTupleNumpyWriter<Record> writer("test_close_error.npy");
+    for (size_t i = 0; i < kNRecords; ++i) {
+      writer.append(make_record(i));
+    }
+    BOOST_CHECK_THROW(writer.close(), std::exception);
+    BOOST_CHECK_NO_THROW(writer.close());
+  }
+  {
+    // the destructor swallows the error instead of terminating
+    dfe::NamedTupleNumpyWriter<Record> writer("test_close_error.npy");
+    for (size_t i = 0; i < kNRecords; ++i) {
+      writer.append(make_record(i));
+    }
+  }
+  ::setrlimit(RLIMIT_FSIZE, &previous);
+  std::signal(SIGXFSZ, handler);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(numpy_namedtuple_write_read)
+{
+  // write some data
+  {
+    dfe::NamedTupleNumpyWriter<Record> writer("test_read.npy");
+
+    for (size_t i = 0; i < kNRecords; ++i) {
+      BOOST_CHECK_NO_THROW(writer.append(make_record(i)));
+    }
+  }
+  // read the data back sequentially
+  {
+    dfe::NamedTupleNumpyReader<Record> reader("test_read.npy");
+    Record record;
+
+    BOOST_TEST(reader.size() == kNRecords);
+    for (size_t i = 0; reader.read(record); ++i) {
+      auto expected = make_record(i);
+      BOOST_TEST(record.tuple() == expected.tuple());
+      BOOST_TEST(record.THIS_IS_UNUSED == Record().THIS_IS_UNUSED);
+    }
+    BOOST_TEST(reader.num_records() == kNRecords);
+  }
+  // read the data back in random order
+  {
+    dfe::NamedTupleNumpyReader<Record> reader("test_read.npy");
+
+    for (size_t i = kNRecords; 0 < i; --i) {
+      BOOST_TEST(reader.at(i - 1).tuple() == make_record(i - 1).tuple());
+      BOOST_TEST(reader[i - 1].tuple() == make_record(i - 1).tuple());
+    }
+    BOOST_CHECK_THROW(reader.at(kNRecords), std::out_of_range);
+    BOOST_TEST(reader.num_records() == 0);
+    // records are packed back-to-back
+    int64_t z;
+    std::memcpy(
+      &z, reader.data() + 7 * reader.record_size() + sizeof(Record::x) +
+            sizeof(Record::y),
+      sizeof(z));
+    BOOST_TEST(z == make_record(7).z);
+  }
+}
+
+struct Packed {
+  double a = 0;
+  int32_t b = 0;
+  float c = 0;
+
+  DFE_NAMEDTUPLE(Packed, a, b, c)
+};
+
+BOOST_TEST_DONT_PRINT_LOG_VALUE(Packed::Tuple)
+
+BOOST_AUTO_TEST_CASE(numpy_namedtuple_write_read_packed)
+{
+  std::vector<Packed> records(kNRecords);
+  for (size_t i = 0; i < records.size(); ++i) {
+    records[i].a = 0.5 * i;
+    records[i].b = -3 * i;
+    records[i].c = 0.25f * i;
+  }
+  // only records w/o padding or unused members can be copied as a block
+  BOOST_TEST(dfe::io_npy_impl::is_packed(records[0]));
+  BOOST_TEST(not dfe::io_npy_impl::is_packed(make_record(0)));
+  // write some data w/ the contiguous and the generic iterator code paths
+  {
+    dfe::NamedTupleNumpyWriter<Packed> writer("test_packed.npy", 1000);
+
+    BOOST_CHECK_NO_THROW(writer.append(records.data(), kNRecords / 2));
+    BOOST_CHECK_NO_THROW(
+      writer.append(records.begin() + kNRecords / 2, records.end()));
+  }
+  // read the data back
+  {
+    dfe::NamedTupleNumpyReader<Packed> reader("test_packed.npy");
+    Packed record;
+
+    BOOST_TEST(reader.size() == kNRecords);
+    BOOST_TEST(reader.record_size() == sizeof(Packed));
+    BOOST_TEST(
+      std::memcmp(
+        reader.data(), records.data(), kNRecords * sizeof(Packed)) == 0);
+    for (size_t i = 0; reader.read(record); ++i) {
+      BOOST_TEST(record.tuple() == records[i].tuple());
+    }
+    BOOST_TEST(reader[7].tuple() == records[7].tuple());
+  }
+}
+
+struct Other {
+  int16_t x = 0;
+  float y = 0;
+
+  DFE_NAMEDTUPLE(Other, x, y)
+};
+
+BOOST_AUTO_TEST_CASE(numpy_namedtuple_read_bad_files)
+{
+  using Reader = dfe::NamedTupleNumpyReader<Record>;
+
+  // missing file
+  BOOST_CHECK_THROW(Reader("does/not/exist.npy"), std::runtime_error);
+  // not a numpy file
+  {
+    std::ofstream("test_invalid.npy") << "x,y,z\n1,2,3\n";
+  }
+  BOOST_CHECK_THROW(Reader("test_invalid.npy"), std::runtime_error);
+  // inconsistent data type
+  {
+    dfe::NamedTupleNumpyWriter<Other> writer("test_other.npy");
+    writer.append(Other());
+  }
+  BOOST_CHECK_THROW(Reader("test_other.npy"), std::runtime_error);
+  // truncated data
+  {
+    auto content = read_file("test.npy");
+    content.resize(content.size() - 1);
+    std::ofstream("test_truncated.npy", std::ios_base::binary) << content;
+  }
+  BOOST_CHECK_THROW(Reader("test_truncated.npy"), std::runtime_error);
+}
+
+// read a little endian unsigned integer w/ the given number of bytes
+static uint64_t
+read_little_endian(const std::string& data, std::size_t pos, unsigned size)
+{
+  uint64_t value = 0;
+  for (unsigned i = 0; i < size; ++i) {
+    value |= uint64_t(static_cast<uint8_t>(data[pos + i])) << (8 * i);
+  }
+  return value;
+}
+
+BOOST_AUTO_TEST_CASE(numpy_namedtuple_write_columns)
+{
+  // small chunk size to write to the temporary files multiple times
+  {
+    dfe::NamedTupleNumpyColumnWriter<Record> writer("test.npz", 100);
+
+    for (size_t i = 0; i < kNRecords; ++i) {
+      BOOST_CHECK_NO_THROW(writer.append(make_record(i)));
+    }
+  }
+
+  // walk the local file headers of the uncompressed archive
+  auto archive = read_file("test.npz");
+  auto names = Record::names();
+  std::size_t pos = 0;
+  for (const auto& name : names) {
+    BOOST_TEST_CONTEXT("column " << name)
+    {
+      BOOST_TEST(read_little_endian(archive, pos, 4) == 0x04034b50u);
+      // stored w/o compression
+      BOOST_TEST(read_little_endian(archive, pos + 8, 2) == 0);
+      auto size = read_little_endian(archive, pos + 18, 4);
+      BOOST_TEST(read_little_endian(archive, pos + 22, 4) == size);
+      auto name_size = read_little_endian(archive, pos + 26, 2);
+      auto extra_size = read_little_endian(archive, pos + 28, 2);
+      BOOST_TEST(archive.substr(pos + 30, name_size) == name + ".npy");
+      pos += 30 + name_size + extra_size;
+      // each entry is a complete npy file w/ a one-dimensional array
+      auto header_size = 10 + read_little_endian(archive, pos + 8, 2);
+      auto header = archive.substr(pos, header_size);
+      BOOST_TEST(header.find("'shape': (1024,)") != std::string::npos);
+      BOOST_TEST(header.find("'descr': '<") != std::string::npos);
+      BOOST_TEST((size - header_size) % kNRecords == 0);
+      pos += size;
+    }
+  }
+  // column data is stored contiguously
+  {
+    auto z = archive.find("z.npy");
+    BOOST_REQUIRE(z != std::string::npos);
+    auto data = z + 5 + 10 + read_little_endian(archive, z + 5 + 8, 2);
+    for (size_t i = 0; i < kNRecords; ++i) {
+      auto value = read_little_endian(archive, data + i * 8, 8);
+      BOOST_TEST(static_cast<int64_t>(value) == make_record(i).z);
+    }
+  }
+  // central directory with one entry per column follows the entries
+  BOOST_TEST(read_little_endian(archive, pos, 4) == 0x02014b50u);
+  auto end = archive.size() - 22;
+  BOOST_TEST(read_little_endian(archive, end, 4) == 0x06054b50u);
+  BOOST_TEST(read_little_endian(archive, end + 10, 2) == names.size());
+  BOOST_TEST(read_little_endian(archive, end + 16, 4) == pos);
+  // temporary column files are removed
+  BOOST_TEST(not std::ifstream("test.npz.x.tmp").is_open());
+}
+
+BOOST_AUTO_TEST_CASE(numpy_namedtuple_write_columns_close)
+{
+  dfe::NamedTupleNumpyColumnWriter<Record> writer("test_close.npz", 100);
+  for (size_t i = 0; i < kNRecords; ++i) {
+    writer.append(make_record(i));
+  }
+  // the archive is complete after an explicit close
+  BOOST_CHECK_NO_THROW(writer.close());
+  auto archive = read_file("test_close.npz");
+  auto end = archive.size() - 22;
+  BOOST_TEST(read_little_endian(archive, end, 4) == 0x06054b50u);
+  BOOST_TEST(not std::ifstream("test_close.npz.x.tmp").is_open());
+  // closing again does nothing
+  BOOST_CHECK_NO_THROW(writer.close());
+  BOOST_TEST(read_file("test_close.npz") == archive);
+}
+
+#if defined(__unix__) or defined(__APPLE__)
+BOOST_AUTO_TEST_CASE(numpy_namedtuple_write_columns_close_error)
+{
+  dfe::NamedTupleNumpyColumnWriter<Record> writer("test_close_error.npz");
+  writer.append(make_record(0));
+  // the output can not be opened anymore if it is replaced by a directory
+  std::remove("test_close_error.npz");
+  BOOST_REQUIRE(::mkdir("test_close_error.npz", 0700) == 0);
+  BOOST_CHECK_THROW(writer.close(), std::exception);
+  ::rmdir("test_close_error.npz");
+  // temporary column files are removed even on error
+  BOOST_TEST(not std::ifstream("test_close_error.npz.x.tmp").is_open());
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(numpy_histogram_write)
+{
+  using H2 = dfe::Histogram<
+    double, dfe::OverflowAxis<double>, dfe::VariableAxis<float>>;
+
+  H2 h({0.0, 1.0, 8}, {1.0f, 10.0f, 100.0f, 1000.0f});
+  for (size_t i = 0; i < kNRecords; ++i) {
+    h.fill(-0.1 + 0.001 * i, 1.0f + 0.9f * i, 0.5 * i);
+  }
+  BOOST_CHECK_NO_THROW(dfe::write_histogram_npz("test_histogram.npz", h));
+
+  auto archive = read_file("test_histogram.npz");
+  // find the header that follows the entry name in the local file header
+  auto find_header = [&](const std::string& name) {
+    auto pos = archive.find(name);
+    BOOST_REQUIRE(pos != std::string::npos);
+    pos += name.size();
+    return archive.substr(pos, 10 + read_little_endian(archive, pos + 8, 2));
+  };
+  // bin values are stored w/ the first axis index varying fastest
+  {
+    auto header = find_header("values.npy");
+    BOOST_TEST(header.find("'descr': '<f8'") != std::string::npos);
+    BOOST_TEST(header.find("'fortran_order': True") != std::string::npos);
+    BOOST_TEST(header.find("'shape': (10, 3)") != std::string::npos);
+    auto data = archive.find("values.npy") + 10 + header.size();
+    for (size_t j = 0; j < 3; ++j) {
+      for (size_t i = 0; i < 10; ++i) {
+        double value;
+        std::memcpy(
+          &value, archive.data() + data + (i + j * 10) * sizeof(double),
+          sizeof(double));
+        BOOST_TEST(value == h.value({i, j}));
+      }
+    }
+  }
+  // edges of the data bins for each axis
+  {
+    auto header = find_header("edges0.npy");
+    BOOST_TEST(header.find("'descr': '<f8'") != std::string::npos);
+    BOOST_TEST(header.find("'shape': (9,)") != std::string::npos);
+    auto data = archive.find("edges0.npy") + 10 + header.size();
+    double upper;
+    std::memcpy(&upper, archive.data() + data + 8 * sizeof(double), 8);
+    BOOST_TEST(upper == 1.0);
+  }
+  {
+    auto header = find_header("edges1.npy");
+    BOOST_TEST(header.find("'descr': '<f4'") != std::string::npos);
+    BOOST_TEST(header.find("'shape': (4,)") != std::string::npos);
+  }
+  BOOST_TEST(archive.find("edges2.npy") == std::string::npos);
+}
@@ -48,12 +48,23 @@ def _check(name, records):
             raise ValueError('inconsistent column value', name, column)
         print('{} column {} matches'.format(name, column))
 
+def _load_columns(path):
+    """
+    Load a columnar npz archive into a structured records array.
+    """
+    columns = numpy.load(path)
+    records = numpy.empty(columns[DTYPE.names[0]].shape, dtype=DTYPE)
+    for column in DTYPE.names:
+        records[column] = columns[column]
+    return records
+
 def test(datadir='.'):
     _check('csv', numpy.loadtxt(os.path.join(datadir, 'test.csv'),
         dtype=DTYPE, delimiter=',', skiprows=1))
     _check('tsv', numpy.loadtxt(os.path.join(datadir, 'test.tsv'),
         dtype=DTYPE, delimiter='\t', skiprows=1))
     _check('npy', numpy.load(os.path.join(datadir, 'test.npy')))
+    _check('npz', _load_columns(os.path.join(datadir, 'test.npz')))
 
 if __name__ == '__main__':
     import sys
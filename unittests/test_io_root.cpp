@@ -4,6 +4,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <cstdint>
+#include <vector>
 
 #include "dfe/dfe_io_root.hpp"
 #include "dfe/dfe_namedtuple.hpp"
@@ -120,4 +121,141 @@ BOOST_AUTO_TEST_CASE(root_namedtuple_write_read)
   }
 }
 
+BOOST_AUTO_TEST_CASE(root_namedtuple_write_options)
+{
+  std::vector<Record> records;
+  for (size_t i = 0; i < kNRecords; ++i) {
+    records.push_back(make_record(i));
+  }
+  // write all records at once w/ non-default storage settings
+  {
+    dfe::NamedTupleRootWriterOptions options;
+    options.basket_size = 4096;
+    options.auto_flush = 1000;
+    options.compression_level = 0;
+    dfe::NamedTupleRootWriter<Record> writer(
+      "test_options.root", "records", options);
+
+    BOOST_CHECK_NO_THROW(writer.append(records.begin(), records.end()));
+  }
+  // read the data back
+  {
+    dfe::NamedTupleRootReader<Record> reader("test_options.root", "records");
+
+    Record record;
+    size_t n = 0;
+    while (reader.read(record)) {
+      BOOST_TEST(record.tuple() == records[n].tuple());
+      n += 1;
+    }
+    BOOST_TEST(n == kNRecords);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(root_namedtuple_write_read_range)
+{
+  std::vector<Record> records;
+  for (size_t i = 0; i < kNRecords; ++i) {
+    records.push_back(make_record(i));
+  }
+  // mix range appends w/ a single record that is reused
+  {
+    dfe::NamedTupleRootWriter<Record> writer("test_range.root", "records");
+
+    BOOST_CHECK_NO_THROW(
+      writer.append(records.begin(), records.begin() + kNRecords / 2));
+    Record reused;
+    for (size_t i = kNRecords / 2; i < (3 * kNRecords / 4); ++i) {
+      reused = records[i];
+      BOOST_CHECK_NO_THROW(writer.append(reused));
+    }
+    BOOST_CHECK_NO_THROW(
+      writer.append(records.begin() + (3 * kNRecords / 4), records.end()));
+  }
+  // mix batch reads w/ single reads
+  {
+    dfe::NamedTupleRootReader<Record> reader("test_range.root", "records");
+
+    std::vector<Record> batch(100);
+    Record record;
+    size_t n = 0;
+    while (n < kNRecords) {
+      size_t num_read = reader.read(batch.data(), batch.size());
+      for (size_t i = 0; i < num_read; ++i, ++n) {
+        BOOST_TEST(batch[i].tuple() == records[n].tuple());
+      }
+      if (reader.read(record)) {
+        BOOST_TEST(record.tuple() == records[n].tuple());
+        n += 1;
+      }
+      if (num_read == 0) { break; }
+    }
+    BOOST_TEST(n == kNRecords);
+    BOOST_TEST(reader.read(batch.data(), batch.size()) == 0u);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(root_namedtuple_read_options)
+{
+  // written by the write_read test
+  using Reader = dfe::NamedTupleRootReader<Record>;
+
+  // read a subset of the entries w/ the cache disabled
+  {
+    dfe::NamedTupleRootReaderOptions options;
+    options.entry_begin = 100;
+    options.entry_end = 200;
+    options.cache_size = 0;
+    Reader reader("test.root", "records", options);
+
+    BOOST_TEST(reader.size() == 100u);
+    Record record;
+    size_t n = 0;
+    while (reader.read(record)) {
+      BOOST_TEST(record.tuple() == make_record(100 + n).tuple());
+      n += 1;
+    }
+    BOOST_TEST(n == 100u);
+    BOOST_TEST(reader.num_records() == 100u);
+  }
+  // split the tree across multiple buffered readers
+  {
+    std::vector<Record> records(kNRecords / 3);
+    size_t n = 0;
+    for (size_t begin = 0; begin < kNRecords; begin += 1024) {
+      dfe::NamedTupleRootReaderOptions options;
+      options.entry_begin = begin;
+      options.entry_end = begin + 1024;
+      options.implicit_mt = true;
+      Reader reader("test.root", "records", options);
+
+      size_t num_read = 0;
+      while (0 < (num_read = reader.read(records.data(), records.size()))) {
+        for (size_t i = 0; i < num_read; ++i, ++n) {
+          BOOST_TEST(records[i].tuple() == make_record(n).tuple());
+        }
+      }
+    }
+    BOOST_TEST(n == kNRecords);
+  }
+  // the entry range is limited to the available entries
+  {
+    dfe::NamedTupleRootReaderOptions options;
+    options.entry_begin = kNRecords - 2;
+    options.entry_end = 2 * kNRecords;
+    BOOST_TEST(Reader("test.root", "records", options).size() == 2u);
+  }
+  // invalid entry ranges
+  {
+    dfe::NamedTupleRootReaderOptions options;
+    options.entry_begin = -1;
+    BOOST_CHECK_THROW(
+      Reader("test.root", "records", options), std::invalid_argument);
+    options.entry_begin = 10;
+    options.entry_end = 5;
+    BOOST_CHECK_THROW(
+      Reader("test.root", "records", options), std::invalid_argument);
+  }
+}
+
 // TODO failure tests
@@ -35,6 +35,8 @@ BOOST_AUTO_TEST_CASE(namedtuple_names)
   BOOST_TEST(example.names().at(4) == "b");
   BOOST_TEST(example.names().at(5) == "c");
   BOOST_TEST(example.names().at(6) == "d");
+  // names are only parsed once
+  BOOST_TEST(&example.names() == &Record::names());
 }
 
 BOOST_AUTO_TEST_CASE(nametuple_assign_from_tuple)
@@ -110,3 +112,18 @@ BOOST_AUTO_TEST_CASE(namedtuple_get_assign)
   BOOST_TEST(r.x == updated);
   BOOST_TEST(get<0>(r) == updated);
 }
+
+BOOST_AUTO_TEST_CASE(namedtuple_tie)
+{
+  using std::get;
+
+  auto r = make_record(42);
+  const auto& cr = r;
+  // references to the members; no copies
+  BOOST_TEST(&get<0>(r.tie()) == &r.x);
+  BOOST_TEST(&get<6>(r.tie()) == &r.d);
+  BOOST_TEST(&get<2>(cr.tie()) == &r.z);
+  BOOST_TEST((r.tie() == r.tuple()));
+  get<1>(r.tie()) = 23;
+  BOOST_TEST(r.y == 23);
+}
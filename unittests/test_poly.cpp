@@ -118,3 +118,109 @@ BOOST_AUTO_TEST_CASE(poly_cubic)
   BOOST_TEST(dfe::polynomial_val(+0.0, {42.0, 1.0, 0.5, -1.0}) == 42.0);
   BOOST_TEST(dfe::polynomial_val(+0.5, {42.0, 1.0, 0.5, -1.0}) == 42.5);
 }
+
+// evaluation using Estrin's scheme
+
+BOOST_AUTO_TEST_CASE(poly_estrin)
+{
+  BOOST_TEST(dfe::polynomial_val_estrin(X0, COEFFS) == Y0);
+  BOOST_TEST(dfe::polynomial_val_estrin(1.5, {42.0}) == 42.0);
+  BOOST_TEST(dfe::polynomial_val_estrin(1.5, std::array<double, 0>{}) == 0.0);
+
+  // compare w/ Horner's method for different orders
+  std::vector<double> coeffs;
+  for (int i = 0; i < 24; ++i) {
+    coeffs.push_back(1.0 / (1 + i));
+    for (double x : {-1.25, -0.5, 0.0, 0.75, 1.0}) {
+      BOOST_TEST(
+        dfe::polynomial_val_estrin(x, coeffs) ==
+          dfe::polynomial_val(x, coeffs),
+        boost::test_tools::tolerance(1e-12));
+    }
+  }
+}
+
+// evaluation for multiple values at once
+
+BOOST_AUTO_TEST_CASE(poly_batch, *boost::unit_test::tolerance(1e-12))
+{
+  std::vector<double> coeffs = COEFFS;
+
+  // sizes below, at, and above multiples of internal block sizes
+  for (std::size_t n : {0, 1, 7, 16, 31, 32, 33, 1000}) {
+    std::vector<double> xs(n);
+    for (std::size_t i = 0; i < n; ++i) { xs[i] = -2.0 + 0.01 * i; }
+    std::vector<double> val(n);
+    std::vector<double> der(n);
+
+    dfe::polynomial_val(xs.data(), val.data(), n, coeffs);
+    for (std::size_t i = 0; i < n; ++i) {
+      BOOST_TEST(val[i] == dfe::polynomial_val(xs[i], coeffs));
+    }
+    // values and derivatives at the same time
+    dfe::polynomial_valder(xs.data(), val.data(), der.data(), n, coeffs);
+    for (std::size_t i = 0; i < n; ++i) {
+      BOOST_TEST(val[i] == dfe::polynomial_val(xs[i], coeffs));
+      BOOST_TEST(der[i] == dfe::polynomial_der(xs[i], coeffs));
+    }
+    // in-place evaluation w/ fixed coefficients
+    std::vector<double> inplace = xs;
+    dfe::polynomial_val(inplace.data(), inplace.data(), n, COEFFS);
+    for (std::size_t i = 0; i < n; ++i) { BOOST_TEST(inplace[i] == val[i]); }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(poly_batch_float, *boost::unit_test::tolerance(1e-6))
+{
+  std::array<float, 3> coeffs = {0.5f, -1.0f, 2.0f};
+  std::vector<float> xs(100);
+  for (std::size_t i = 0; i < xs.size(); ++i) { xs[i] = 0.125f * i; }
+  std::vector<float> val(xs.size());
+  std::vector<float> der(xs.size());
+
+  dfe::polynomial_valder(xs.data(), val.data(), der.data(), xs.size(), coeffs);
+  for (std::size_t i = 0; i < xs.size(); ++i) {
+    BOOST_TEST(val[i] == dfe::polynomial_val(xs[i], coeffs));
+    BOOST_TEST(der[i] == dfe::polynomial_der(xs[i], coeffs));
+  }
+}
+
+// polynomial type w/ compile-time fixed order
+
+BOOST_AUTO_TEST_CASE(poly_fixed, *boost::unit_test::tolerance(1e-12))
+{
+  constexpr auto poly = dfe::make_polynomial(std::array<double, 4>(COEFFS));
+
+  BOOST_TEST(poly(X0) == Y0);
+  BOOST_TEST(poly.val(X0) == Y0);
+  BOOST_TEST(poly.der(X0) == D0);
+  BOOST_TEST(poly.valder(X0).first == Y0);
+  BOOST_TEST(poly.valder(X0).second == D0);
+  // consistent w/ the container-based evaluation
+  for (double x : {-1.25, -0.5, 0.0, 0.75, 1.0}) {
+    BOOST_TEST(poly(x) == dfe::polynomial_val(x, COEFFS));
+    BOOST_TEST(poly.der(x) == dfe::polynomial_der(x, COEFFS));
+  }
+  // derivative coefficients are precomputed
+  constexpr auto der = poly.derivative();
+  static_assert(der.coefficients().size() == 3, "Invalid derivative order");
+  BOOST_TEST(der.coefficients()[0] == 2.0);
+  BOOST_TEST(der.coefficients()[1] == 0.5);
+  BOOST_TEST(der.coefficients()[2] == 0.075);
+  BOOST_TEST(der(X0) == D0);
+  // evaluation at compile time
+  static_assert(poly(0.0) == 1.0, "Invalid compile-time evaluation");
+  static_assert(poly.der(0.0) == 2.0, "Invalid compile-time derivative");
+}
+
+BOOST_AUTO_TEST_CASE(poly_fixed_low_order)
+{
+  constexpr dfe::Polynomial<float, 1> constant({42.0f});
+  BOOST_TEST(constant(-1.0f) == 42.0f);
+  BOOST_TEST(constant.der(-1.0f) == 0.0f);
+  BOOST_TEST(constant.derivative()(2.0f) == 0.0f);
+
+  constexpr dfe::Polynomial<float, 0> empty({});
+  BOOST_TEST(empty(1.0f) == 0.0f);
+  BOOST_TEST(empty.der(1.0f) == 0.0f);
+}
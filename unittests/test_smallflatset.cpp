@@ -3,6 +3,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+
 #include "dfe/dfe_flat.hpp"
 #include "dfe/dfe_smallvector.hpp"
 
@@ -92,3 +94,18 @@ BOOST_AUTO_TEST_CASE(flatset_custom_compare)
   BOOST_CHECK(!set.contains(Thing{4, 1.45}));
   BOOST_CHECK(!set.contains(Thing{27, -1.23}));
 }
+
+BOOST_AUTO_TEST_CASE(flatset_range_merge)
+{
+  // exceeds the in-place storage
+  Set<int> set = {9, 3, 7, 1, 3, 5, 9, 11, 13};
+  Set<int> other = {0, 1, 2, 14};
+
+  BOOST_CHECK(set.size() == 7);
+  set.merge(other);
+  BOOST_CHECK(set.size() == 10);
+  BOOST_CHECK(std::is_sorted(set.begin(), set.end()));
+  for (int x : {0, 1, 2, 3, 5, 7, 9, 11, 13, 14}) {
+    BOOST_CHECK(set.contains(x));
+  }
+}
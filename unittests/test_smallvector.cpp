@@ -89,3 +89,196 @@ BOOST_AUTO_TEST_CASE(smallvector_simpleclass)
     BOOST_TEST(j == sm.size());
   }
 }
+
+BOOST_AUTO_TEST_CASE(smallvector_copy_move)
+{
+  using Vec = dfe::SmallVector<Simple, 4>;
+
+  for (int n : {0, 3, 4, 5, 32}) {
+    Vec original;
+    for (int i = 0; i < n; ++i) { original.emplace_back(i); }
+
+    Vec copy(original);
+    BOOST_TEST(copy.size() == original.size());
+    for (int i = 0; i < n; ++i) {
+      BOOST_TEST(copy[i].num() == original[i].num());
+      BOOST_TEST(copy[i].str() == original[i].str());
+    }
+    // heap-allocated storage is taken over w/o moving any elements
+    const Simple* data = original.data();
+    Vec moved(std::move(original));
+    BOOST_TEST(original.empty());
+    BOOST_TEST(moved.size() == copy.size());
+    if (4 < n) { BOOST_TEST(moved.data() == data); }
+    for (int i = 0; i < n; ++i) {
+      BOOST_TEST(moved[i].str() == copy[i].str());
+    }
+    // assignment replaces existing elements
+    Vec assigned;
+    for (int i = 0; i < 7; ++i) { assigned.emplace_back(100 + i); }
+    assigned = copy;
+    BOOST_TEST(assigned.size() == copy.size());
+    for (int i = 0; i < n; ++i) {
+      BOOST_TEST(assigned[i].str() == copy[i].str());
+    }
+    assigned = std::move(moved);
+    BOOST_TEST(moved.empty());
+    BOOST_TEST(assigned.size() == copy.size());
+    for (int i = 0; i < n; ++i) {
+      BOOST_TEST(assigned[i].str() == copy[i].str());
+    }
+    // moved-from vectors are still usable
+    moved.emplace_back(2);
+    BOOST_TEST(moved.size() == 1u);
+    BOOST_TEST(moved[0].num() == 4);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(smallvector_reserve_resize)
+{
+  dfe::SmallVector<int, 4> sm;
+
+  BOOST_TEST(sm.capacity() == 4u);
+  sm.reserve(2);
+  BOOST_TEST(sm.capacity() == 4u);
+  sm.emplace_back(1);
+  sm.reserve(100);
+  BOOST_TEST(sm.capacity() == 100u);
+  BOOST_TEST(sm.size() == 1u);
+  BOOST_TEST(sm[0] == 1);
+  // no reallocation is needed for reserved elements
+  const int* data = sm.data();
+  for (int i = 1; i < 100; ++i) { sm.emplace_back(i + 1); }
+  BOOST_TEST(sm.data() == data);
+  BOOST_TEST(sm.back() == 100);
+  // geometric growth
+  sm.emplace_back(101);
+  BOOST_TEST(sm.capacity() == 200u);
+
+  sm.resize(3);
+  BOOST_TEST(sm.size() == 3u);
+  BOOST_TEST(sm.back() == 3);
+  sm.resize(6, -1);
+  BOOST_TEST(sm.size() == 6u);
+  BOOST_TEST(sm[2] == 3);
+  BOOST_TEST(sm[3] == -1);
+  BOOST_TEST(sm[5] == -1);
+  sm.resize(8);
+  BOOST_TEST(sm[7] == 0);
+  // clear releases the allocated memory
+  sm.clear();
+  BOOST_TEST(sm.capacity() == 4u);
+  sm.resize(300, sm.capacity());
+  BOOST_TEST(sm.size() == 300u);
+  BOOST_TEST(sm[299] == 4);
+}
+
+BOOST_AUTO_TEST_CASE(smallvector_erase_pop_back)
+{
+  dfe::SmallVector<Simple, 4> sm;
+
+  for (int i = 0; i < 16; ++i) { sm.emplace_back(i); }
+  sm.pop_back();
+  BOOST_TEST(sm.size() == 15u);
+  BOOST_TEST(sm.back().num() == 28);
+  // remove the first element
+  auto it = sm.erase(sm.begin());
+  BOOST_TEST(it == sm.begin());
+  BOOST_TEST(sm.size() == 14u);
+  BOOST_TEST(sm[0].num() == 2);
+  // remove a range, i.e. elements 4 to 9
+  it = sm.erase(sm.begin() + 3, sm.begin() + 9);
+  BOOST_TEST(it->num() == 20);
+  BOOST_TEST(sm.size() == 8u);
+  for (int i : {1, 2, 3, 10, 11, 12, 13, 14}) {
+    BOOST_TEST(sm[i < 10 ? (i - 1) : (i - 7)].str() == Simple(i).str());
+  }
+  // remain usable after shrinking below the in-place size
+  sm.erase(sm.begin(), sm.end() - 2);
+  BOOST_TEST(sm.size() == 2u);
+  sm.emplace(sm.begin() + 1, 7);
+  BOOST_TEST(sm[0].num() == 26);
+  BOOST_TEST(sm[1].num() == 14);
+  BOOST_TEST(sm[2].num() == 28);
+}
+
+// type w/o default constructor that counts its copies and moves
+class Tracked {
+public:
+  Tracked(int i)
+    : m_value(i)
+  {
+  }
+  Tracked(const Tracked& other)
+    : m_value(other.m_value)
+  {
+    ++copies;
+  }
+  Tracked(Tracked&& other) noexcept
+    : m_value(other.m_value)
+  {
+    ++moves;
+  }
+  Tracked& operator=(const Tracked& other) = default;
+  Tracked& operator=(Tracked&& other) = default;
+
+  int value() const { return m_value; }
+
+  static int copies;
+  static int moves;
+
+private:
+  int m_value;
+};
+int Tracked::copies = 0;
+int Tracked::moves = 0;
+
+BOOST_AUTO_TEST_CASE(smallvector_no_default_construction)
+{
+  dfe::SmallVector<Tracked, 4> sm;
+
+  sm.emplace_back(1);
+  sm.emplace_back(3);
+  sm.emplace(sm.begin() + 1, 2);
+  sm.emplace(sm.begin(), 0);
+  BOOST_TEST(Tracked::copies == 0);
+  for (int i = 0; i < 4; ++i) { BOOST_TEST(sm[i].value() == i); }
+  // inserting an existing element that is relocated by the insertion
+  sm.emplace(sm.begin(), sm[3]);
+  sm.emplace(sm.begin(), sm[4]);
+  BOOST_TEST(Tracked::copies == 2);
+  BOOST_TEST(sm.size() == 6u);
+  BOOST_TEST(sm[0].value() == 3);
+  BOOST_TEST(sm[1].value() == 3);
+  BOOST_TEST(sm[5].value() == 3);
+  // moving a heap-allocated vector does not touch the elements
+  int moves = Tracked::moves;
+  dfe::SmallVector<Tracked, 4> moved(std::move(sm));
+  BOOST_TEST(Tracked::moves == moves);
+  BOOST_TEST(moved.size() == 6u);
+}
+
+BOOST_AUTO_TEST_CASE(smallvector_inplace_storage)
+{
+  using Vec = dfe::SmallVector<int, 4>;
+
+  auto is_inside = [](const Vec& v) {
+    auto first = reinterpret_cast<const char*>(&v);
+    auto data = reinterpret_cast<const char*>(v.data());
+    return (first <= data) and (data < (first + sizeof(Vec)));
+  };
+
+  Vec sm;
+  BOOST_TEST(is_inside(sm));
+  for (int i = 0; i < 4; ++i) { sm.emplace_back(i); }
+  BOOST_TEST(is_inside(sm));
+  // moved in-place elements must refer to the storage of the new vector
+  Vec moved(std::move(sm));
+  BOOST_TEST(is_inside(moved));
+  BOOST_TEST(is_inside(sm));
+  BOOST_TEST(moved[3] == 3);
+  moved.emplace_back(4);
+  BOOST_TEST(not is_inside(moved));
+  moved.clear();
+  BOOST_TEST(is_inside(moved));
+}